@@ -5,16 +5,43 @@
  *     10/26/22
  *
  *     This file takes in command line arguments to either compress or
- *     decompress a given image file.
+ *     decompress a given image file. "-j N" spreads the work over N
+ *     threads (0 for one per processor); the output is the same either way.
  */
 
 #include <string.h>
 #include <stdlib.h>
 #include <stdio.h>
+#include <unistd.h>
 #include "assert.h"
-#include "compress40.h"
+#include "compress.h"
+#include "decompress.h"
 
-static void (*compress_or_decompress)(FILE *input) = compress40;
+static void (*compress_or_decompress)(FILE *input, unsigned threads) =
+        compress;
+
+/* 
+ *      name: parse_threads
+ *   purpose: read the number of threads given with -j
+ *    inputs: prog - the program's name, for the error message
+ *             arg - the number, where 0 means one per online processor
+ *   outputs: the number of threads
+ *    errors: exits with status 1 if arg is not a number
+ */
+static unsigned parse_threads(const char *prog, const char *arg)
+{
+        char *end;
+        unsigned long threads = strtoul(arg, &end, 10);
+        if (*arg < '0' || *arg > '9' || *end != '\0' || threads > 1024) {
+                fprintf(stderr, "%s: bad thread count '%s'\n", prog, arg);
+                exit(1);
+        }
+        if (threads == 0) {
+                long online = sysconf(_SC_NPROCESSORS_ONLN);
+                threads = online > 0 ? online : 1;
+        }
+        return threads;
+}
 
 /* 
  *      name: main
@@ -28,19 +55,23 @@ static void (*compress_or_decompress)(FILE *input) = compress40;
 int main(int argc, char *argv[])
 {
         int i;
+        unsigned threads = 1;
 
         for (i = 1; i < argc; i++) {
                 if (strcmp(argv[i], "-c") == 0) {
-                        compress_or_decompress = compress40;
+                        compress_or_decompress = compress;
                 } else if (strcmp(argv[i], "-d") == 0) {
-                        compress_or_decompress = decompress40;
+                        compress_or_decompress = decompress;
+                } else if (strcmp(argv[i], "-j") == 0 && i + 1 < argc) {
+                        threads = parse_threads(argv[0], argv[++i]);
                 } else if (*argv[i] == '-') {
                         fprintf(stderr, "%s: unknown option '%s'\n",
                                 argv[0], argv[i]);
                         exit(1);
                 } else if (argc - i > 2) {
-                        fprintf(stderr, "Usage: %s -d [filename]\n"
-                                "       %s -c [filename]\n",
+                        fprintf(stderr, "Usage: %s -d [-j threads] "
+                                "[filename]\n"
+                                "       %s -c [-j threads] [filename]\n",
                                 argv[0], argv[0]);
                         exit(1);
                 } else {
@@ -51,10 +82,10 @@ int main(int argc, char *argv[])
         if (i < argc) {
                 FILE *fp = fopen(argv[i], "r");
                 assert(fp != NULL);
-                compress_or_decompress(fp);
+                compress_or_decompress(fp, threads);
                 fclose(fp);
         } else {
-                compress_or_decompress(stdin);
+                compress_or_decompress(stdin, threads);
         }
 
         return EXIT_SUCCESS; 
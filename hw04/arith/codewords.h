@@ -4,29 +4,27 @@
  *     arith
  *     10/26/22
  *
- *     This is the interface for codewords, where a user can take a quantized
- *     2D array of pixels and pack them into codewords, then print to standard
- *     output. The reverse can also be done, where a compressed image can be
- *     read in and codewords can be unpacked into quantized pixels in scaled
- *     integer representation.
- *     
+ *     This is the interface for codewords, where a user can pack the
+ *     quantized values of a 2x2 block into a codeword and lay it out the way
+ *     it is printed. The reverse can also be done: the header of a
+ *     compressed image can be read, and a codeword rebuilt from its
+ *     characters and unpacked into quantized values in scaled integer
+ *     representation.
  */
 
 #include <stdlib.h>
 #include <stdio.h>
+#include <stdint.h>
 #include <string.h>
 
 #include "assert.h"
-#include "a2methods.h"
-#include "a2plain.h"
 #include "transform.h"
 
 /* COMPRESSION FUNCTIONS */
-void codewords_compress(A2Methods_UArray2 quant_array);
-A2Methods_UArray2 codewords_pack(A2Methods_UArray2 quant_array);
-void codewords_print(A2Methods_UArray2 word_array);
+uint64_t codeword_pack(uint64_t word, const struct Quant_pix *curr);
+void codeword_chars(uint64_t word, char *chars);
 
 /* DECOMPRESSION FUNCTIONS */
-A2Methods_UArray2 codewords_decompress(FILE *fp);
-A2Methods_UArray2 codewords_read(FILE *fp);
-A2Methods_UArray2 codewords_unpack(A2Methods_UArray2 word_array);
+void codewords_read_header(FILE *fp, unsigned *width, unsigned *height);
+uint64_t codeword_of_chars(const unsigned char *chars);
+void codeword_unpack(uint64_t word, struct Quant_pix *pixel);
@@ -0,0 +1,514 @@
+/*
+ *     colorspace.c
+ *     by Helena Lowe (hlowe01) & Olivia Byun (obyun01)
+ *     arith
+ *     10/26/22
+ *
+ *     This is the implementation for colorspace, which converts planes of
+ *     pixels between floating-point RGB and component video color space.
+ *
+ *     rgb_to_video and video_to_rgb in transform multiply float values by
+ *     double constants, so their arithmetic is done in double and only the
+ *     results are rounded to float. The vector kernels do the same: they
+ *     widen each float to a double, apply the same operations in the same
+ *     order, and narrow the results, so they agree with the scalar code bit
+ *     for bit. x86 has no fused multiply-add without FMA, which these
+ *     kernels do not enable, so nothing is rounded differently. The SSE2
+ *     kernel handles 4 pixels per iteration and the AVX2 kernel 8; any
+ *     pixels left over go through the scalar kernel.
+ *
+ *     The kernel is chosen the first time one is needed, from what CPUID
+ *     says the processor supports, unless colorspace_use has picked one.
+ */
+
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "assert.h"
+#include "colorspace.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define HAVE_X86 1
+#else
+#define HAVE_X86 0
+#endif
+
+typedef void (*To_video)(const float *red, const float *green,
+                         const float *blue, float *y, float *pb, float *pr,
+                         size_t n);
+typedef void (*To_rgb)(const float *y, const float *pb, const float *pr,
+                       float *red, float *green, float *blue, size_t n);
+
+/*
+ * purpose: describe one implementation of the conversions
+ * members: name - what colorspace_kernel and colorspace_use call it
+ *          supported - says whether the processor can run it
+ *          to_video, to_rgb - the conversions
+ */
+struct Kernel {
+        const char *name;
+        bool (*supported)(void);
+        To_video to_video;
+        To_rgb to_rgb;
+};
+
+/*
+ *      name: scalar_to_video
+ *   purpose: convert planes of RGB pixels to component video one pixel at a
+ *            time, with the arithmetic of rgb_to_video
+ *    inputs: red, green, blue - the pixels' RGB values
+ *            y, pb, pr - where to store their Y, Pb and Pr values
+ *            n - the number of pixels
+ *   outputs: none
+ *    errors: none
+ */
+static void scalar_to_video(const float *red, const float *green,
+                            const float *blue, float *y, float *pb, float *pr,
+                            size_t n)
+{
+        for (size_t i = 0; i < n; i++) {
+                float r = red[i];
+                float g = green[i];
+                float b = blue[i];
+
+                y[i] = (0.299 * r) + (0.587 * g) + (0.114 * b);
+                pb[i] = (-0.168736 * r) - (0.331264 * g) + (0.5 * b);
+                pr[i] = (0.5 * r) - (0.418688 * g) - (0.081312 * b);
+        }
+}
+
+/*
+ *      name: clamp
+ *   purpose: force a floating-point RGB value into the range [0, 1], as
+ *            fix_color_range does
+ *    inputs: value - the value
+ *   outputs: the value in range
+ *    errors: none
+ */
+static inline float clamp(float value)
+{
+        if (value < 0) {
+                return 0;
+        } else if (value > 1) {
+                return 1;
+        }
+        return value;
+}
+
+/*
+ *      name: scalar_to_rgb
+ *   purpose: convert planes of component video pixels to RGB in the range
+ *            [0, 1] one pixel at a time, with the arithmetic of video_to_rgb
+ *    inputs: y, pb, pr - the pixels' Y, Pb and Pr values
+ *            red, green, blue - where to store their RGB values
+ *            n - the number of pixels
+ *   outputs: none
+ *    errors: none
+ */
+static void scalar_to_rgb(const float *y, const float *pb, const float *pr,
+                          float *red, float *green, float *blue, size_t n)
+{
+        for (size_t i = 0; i < n; i++) {
+                float lum = y[i];
+                float b = pb[i];
+                float r = pr[i];
+
+                red[i] = clamp((1.0 * lum) + (1.402 * r));
+                green[i] = clamp((1.0 * lum) - (0.344136 * b) -
+                                 (0.714136 * r));
+                blue[i] = clamp((1.0 * lum) + (1.772 * b));
+        }
+}
+
+/*
+ *      name: scalar_supported
+ *   purpose: say whether the scalar kernel can run, which it always can
+ *    inputs: none
+ *   outputs: true
+ *    errors: none
+ */
+static bool scalar_supported(void)
+{
+        return true;
+}
+
+#if HAVE_X86
+
+/*
+ *      name: sse2_to_video
+ *   purpose: convert planes of RGB pixels to component video 4 pixels at a
+ *            time, using SSE2
+ *    inputs: as scalar_to_video
+ *   outputs: none
+ *    errors: none
+ */
+__attribute__((target("sse2")))
+static void sse2_to_video(const float *red, const float *green,
+                          const float *blue, float *y, float *pb, float *pr,
+                          size_t n)
+{
+        const __m128d yr = _mm_set1_pd(0.299), yg = _mm_set1_pd(0.587);
+        const __m128d yb = _mm_set1_pd(0.114);
+        const __m128d br = _mm_set1_pd(-0.168736);
+        const __m128d bg = _mm_set1_pd(0.331264);
+        const __m128d half = _mm_set1_pd(0.5);
+        const __m128d rg = _mm_set1_pd(0.418688);
+        const __m128d rb = _mm_set1_pd(0.081312);
+        size_t i = 0;
+
+        for (; i + 4 <= n; i += 4) {
+                __m128 r4 = _mm_loadu_ps(&red[i]);
+                __m128 g4 = _mm_loadu_ps(&green[i]);
+                __m128 b4 = _mm_loadu_ps(&blue[i]);
+                __m128 out[3][2];
+
+                /* the low two pixels, then the high two */
+                for (int h = 0; h < 2; h++) {
+                        __m128d r = _mm_cvtps_pd(r4);
+                        __m128d g = _mm_cvtps_pd(g4);
+                        __m128d b = _mm_cvtps_pd(b4);
+
+                        __m128d vy = _mm_add_pd(_mm_add_pd(
+                                        _mm_mul_pd(yr, r), _mm_mul_pd(yg, g)),
+                                        _mm_mul_pd(yb, b));
+                        __m128d vpb = _mm_add_pd(_mm_sub_pd(
+                                        _mm_mul_pd(br, r), _mm_mul_pd(bg, g)),
+                                        _mm_mul_pd(half, b));
+                        __m128d vpr = _mm_sub_pd(_mm_sub_pd(
+                                        _mm_mul_pd(half, r), _mm_mul_pd(rg, g)),
+                                        _mm_mul_pd(rb, b));
+                        out[0][h] = _mm_cvtpd_ps(vy);
+                        out[1][h] = _mm_cvtpd_ps(vpb);
+                        out[2][h] = _mm_cvtpd_ps(vpr);
+
+                        r4 = _mm_movehl_ps(r4, r4);
+                        g4 = _mm_movehl_ps(g4, g4);
+                        b4 = _mm_movehl_ps(b4, b4);
+                }
+                _mm_storeu_ps(&y[i], _mm_movelh_ps(out[0][0], out[0][1]));
+                _mm_storeu_ps(&pb[i], _mm_movelh_ps(out[1][0], out[1][1]));
+                _mm_storeu_ps(&pr[i], _mm_movelh_ps(out[2][0], out[2][1]));
+        }
+        scalar_to_video(&red[i], &green[i], &blue[i], &y[i], &pb[i], &pr[i],
+                        n - i);
+}
+
+/*
+ *      name: sse2_clamp
+ *   purpose: force 4 floating-point RGB values into the range [0, 1]; the
+ *            operand order makes a value of -0 stay -0, as in clamp
+ *    inputs: value - the values
+ *   outputs: the values in range
+ *    errors: none
+ */
+__attribute__((target("sse2")))
+static inline __m128 sse2_clamp(__m128 value)
+{
+        value = _mm_max_ps(_mm_setzero_ps(), value);
+        return _mm_min_ps(_mm_set1_ps(1), value);
+}
+
+/*
+ *      name: sse2_to_rgb
+ *   purpose: convert planes of component video pixels to RGB in the range
+ *            [0, 1] 4 pixels at a time, using SSE2
+ *    inputs: as scalar_to_rgb
+ *   outputs: none
+ *    errors: none
+ */
+__attribute__((target("sse2")))
+static void sse2_to_rgb(const float *y, const float *pb, const float *pr,
+                        float *red, float *green, float *blue, size_t n)
+{
+        const __m128d rr = _mm_set1_pd(1.402);
+        const __m128d gb = _mm_set1_pd(0.344136);
+        const __m128d gr = _mm_set1_pd(0.714136);
+        const __m128d bb = _mm_set1_pd(1.772);
+        size_t i = 0;
+
+        for (; i + 4 <= n; i += 4) {
+                __m128 y4 = _mm_loadu_ps(&y[i]);
+                __m128 b4 = _mm_loadu_ps(&pb[i]);
+                __m128 r4 = _mm_loadu_ps(&pr[i]);
+                __m128 out[3][2];
+
+                /* the low two pixels, then the high two; 1.0 * y is y */
+                for (int h = 0; h < 2; h++) {
+                        __m128d lum = _mm_cvtps_pd(y4);
+                        __m128d b = _mm_cvtps_pd(b4);
+                        __m128d r = _mm_cvtps_pd(r4);
+
+                        out[0][h] = _mm_cvtpd_ps(_mm_add_pd(lum,
+                                                 _mm_mul_pd(rr, r)));
+                        out[1][h] = _mm_cvtpd_ps(_mm_sub_pd(_mm_sub_pd(lum,
+                                                 _mm_mul_pd(gb, b)),
+                                                 _mm_mul_pd(gr, r)));
+                        out[2][h] = _mm_cvtpd_ps(_mm_add_pd(lum,
+                                                 _mm_mul_pd(bb, b)));
+
+                        y4 = _mm_movehl_ps(y4, y4);
+                        b4 = _mm_movehl_ps(b4, b4);
+                        r4 = _mm_movehl_ps(r4, r4);
+                }
+                _mm_storeu_ps(&red[i], sse2_clamp(_mm_movelh_ps(out[0][0],
+                                                               out[0][1])));
+                _mm_storeu_ps(&green[i], sse2_clamp(_mm_movelh_ps(out[1][0],
+                                                                 out[1][1])));
+                _mm_storeu_ps(&blue[i], sse2_clamp(_mm_movelh_ps(out[2][0],
+                                                                out[2][1])));
+        }
+        scalar_to_rgb(&y[i], &pb[i], &pr[i], &red[i], &green[i], &blue[i],
+                      n - i);
+}
+
+/*
+ *      name: sse2_supported
+ *   purpose: say whether the processor supports SSE2
+ *    inputs: none
+ *   outputs: true if it does
+ *    errors: none
+ */
+static bool sse2_supported(void)
+{
+        return __builtin_cpu_supports("sse2");
+}
+
+/*
+ *      name: avx2_to_video
+ *   purpose: convert planes of RGB pixels to component video 8 pixels at a
+ *            time, using AVX2
+ *    inputs: as scalar_to_video
+ *   outputs: none
+ *    errors: none
+ */
+__attribute__((target("avx2")))
+static void avx2_to_video(const float *red, const float *green,
+                          const float *blue, float *y, float *pb, float *pr,
+                          size_t n)
+{
+        const __m256d yr = _mm256_set1_pd(0.299), yg = _mm256_set1_pd(0.587);
+        const __m256d yb = _mm256_set1_pd(0.114);
+        const __m256d br = _mm256_set1_pd(-0.168736);
+        const __m256d bg = _mm256_set1_pd(0.331264);
+        const __m256d half = _mm256_set1_pd(0.5);
+        const __m256d rg = _mm256_set1_pd(0.418688);
+        const __m256d rb = _mm256_set1_pd(0.081312);
+        size_t i = 0;
+
+        for (; i + 8 <= n; i += 8) {
+                /* the low four pixels, then the high four */
+                for (size_t j = i; j < i + 8; j += 4) {
+                        __m256d r = _mm256_cvtps_pd(_mm_loadu_ps(&red[j]));
+                        __m256d g = _mm256_cvtps_pd(_mm_loadu_ps(&green[j]));
+                        __m256d b = _mm256_cvtps_pd(_mm_loadu_ps(&blue[j]));
+
+                        __m256d vy = _mm256_add_pd(_mm256_add_pd(
+                                        _mm256_mul_pd(yr, r),
+                                        _mm256_mul_pd(yg, g)),
+                                        _mm256_mul_pd(yb, b));
+                        __m256d vpb = _mm256_add_pd(_mm256_sub_pd(
+                                        _mm256_mul_pd(br, r),
+                                        _mm256_mul_pd(bg, g)),
+                                        _mm256_mul_pd(half, b));
+                        __m256d vpr = _mm256_sub_pd(_mm256_sub_pd(
+                                        _mm256_mul_pd(half, r),
+                                        _mm256_mul_pd(rg, g)),
+                                        _mm256_mul_pd(rb, b));
+                        _mm_storeu_ps(&y[j], _mm256_cvtpd_ps(vy));
+                        _mm_storeu_ps(&pb[j], _mm256_cvtpd_ps(vpb));
+                        _mm_storeu_ps(&pr[j], _mm256_cvtpd_ps(vpr));
+                }
+        }
+        scalar_to_video(&red[i], &green[i], &blue[i], &y[i], &pb[i], &pr[i],
+                        n - i);
+}
+
+/*
+ *      name: avx2_clamp
+ *   purpose: force 8 floating-point RGB values into the range [0, 1]; the
+ *            operand order makes a value of -0 stay -0, as in clamp
+ *    inputs: value - the values
+ *   outputs: the values in range
+ *    errors: none
+ */
+__attribute__((target("avx2")))
+static inline __m256 avx2_clamp(__m256 value)
+{
+        value = _mm256_max_ps(_mm256_setzero_ps(), value);
+        return _mm256_min_ps(_mm256_set1_ps(1), value);
+}
+
+/*
+ *      name: avx2_to_rgb
+ *   purpose: convert planes of component video pixels to RGB in the range
+ *            [0, 1] 8 pixels at a time, using AVX2
+ *    inputs: as scalar_to_rgb
+ *   outputs: none
+ *    errors: none
+ */
+__attribute__((target("avx2")))
+static void avx2_to_rgb(const float *y, const float *pb, const float *pr,
+                        float *red, float *green, float *blue, size_t n)
+{
+        const __m256d rr = _mm256_set1_pd(1.402);
+        const __m256d gb = _mm256_set1_pd(0.344136);
+        const __m256d gr = _mm256_set1_pd(0.714136);
+        const __m256d bb = _mm256_set1_pd(1.772);
+        size_t i = 0;
+
+        for (; i + 8 <= n; i += 8) {
+                __m128 out[3][2];
+
+                /* the low four pixels, then the high four; 1.0 * y is y */
+                for (int h = 0; h < 2; h++) {
+                        size_t j = i + 4 * h;
+                        __m256d lum = _mm256_cvtps_pd(_mm_loadu_ps(&y[j]));
+                        __m256d b = _mm256_cvtps_pd(_mm_loadu_ps(&pb[j]));
+                        __m256d r = _mm256_cvtps_pd(_mm_loadu_ps(&pr[j]));
+
+                        out[0][h] = _mm256_cvtpd_ps(_mm256_add_pd(lum,
+                                                    _mm256_mul_pd(rr, r)));
+                        out[1][h] = _mm256_cvtpd_ps(_mm256_sub_pd(
+                                                    _mm256_sub_pd(lum,
+                                                    _mm256_mul_pd(gb, b)),
+                                                    _mm256_mul_pd(gr, r)));
+                        out[2][h] = _mm256_cvtpd_ps(_mm256_add_pd(lum,
+                                                    _mm256_mul_pd(bb, b)));
+                }
+                _mm256_storeu_ps(&red[i], avx2_clamp(_mm256_set_m128(
+                                 out[0][1], out[0][0])));
+                _mm256_storeu_ps(&green[i], avx2_clamp(_mm256_set_m128(
+                                 out[1][1], out[1][0])));
+                _mm256_storeu_ps(&blue[i], avx2_clamp(_mm256_set_m128(
+                                 out[2][1], out[2][0])));
+        }
+        scalar_to_rgb(&y[i], &pb[i], &pr[i], &red[i], &green[i], &blue[i],
+                      n - i);
+}
+
+/*
+ *      name: avx2_supported
+ *   purpose: say whether the processor and operating system support AVX2
+ *    inputs: none
+ *   outputs: true if they do
+ *    errors: none
+ */
+static bool avx2_supported(void)
+{
+        return __builtin_cpu_supports("avx2");
+}
+
+#endif
+
+/* the kernels, fastest first */
+static const struct Kernel kernels[] = {
+#if HAVE_X86
+        { "avx2", avx2_supported, avx2_to_video, avx2_to_rgb },
+        { "sse2", sse2_supported, sse2_to_video, sse2_to_rgb },
+#endif
+        { "scalar", scalar_supported, scalar_to_video, scalar_to_rgb },
+};
+
+static const struct Kernel *selected = NULL;
+
+/*
+ *      name: kernel
+ *   purpose: get the kernel in use, choosing the fastest one the processor
+ *            supports if none has been chosen yet
+ *    inputs: none
+ *   outputs: the kernel
+ *    errors: none
+ */
+static const struct Kernel *kernel(void)
+{
+        if (selected == NULL) {
+                size_t i = 0;
+                while (!kernels[i].supported()) {
+                        i++;
+                }
+                selected = &kernels[i];
+        }
+        return selected;
+}
+
+/*
+ *      name: colorspace_to_video
+ *   purpose: convert planes of floating-point RGB pixels to component video
+ *            color space, as rgb_to_video does for each pixel
+ *    inputs: red, green, blue - the pixels' RGB values
+ *            y, pb, pr - where to store their Y, Pb and Pr values; these
+ *                        must not overlap the inputs
+ *            n - the number of pixels
+ *   outputs: none
+ *    errors: raises a checked runtime error if any plane is NULL
+ */
+void colorspace_to_video(const float *red, const float *green,
+                         const float *blue, float *y, float *pb, float *pr,
+                         size_t n)
+{
+        assert(red != NULL && green != NULL && blue != NULL);
+        assert(y != NULL && pb != NULL && pr != NULL);
+
+        kernel()->to_video(red, green, blue, y, pb, pr, n);
+}
+
+/*
+ *      name: colorspace_to_rgb
+ *   purpose: convert planes of component video pixels to floating-point RGB
+ *            forced into the range [0, 1], as video_to_rgb does for each
+ *            pixel
+ *    inputs: y, pb, pr - the pixels' Y, Pb and Pr values
+ *            red, green, blue - where to store their RGB values; these must
+ *                               not overlap the inputs
+ *            n - the number of pixels
+ *   outputs: none
+ *    errors: raises a checked runtime error if any plane is NULL
+ */
+void colorspace_to_rgb(const float *y, const float *pb, const float *pr,
+                       float *red, float *green, float *blue, size_t n)
+{
+        assert(y != NULL && pb != NULL && pr != NULL);
+        assert(red != NULL && green != NULL && blue != NULL);
+
+        kernel()->to_rgb(y, pb, pr, red, green, blue, n);
+}
+
+/*
+ *      name: colorspace_kernel
+ *   purpose: get the name of the kernel in use
+ *    inputs: none
+ *   outputs: "avx2", "sse2" or "scalar"
+ *    errors: none
+ */
+const char *colorspace_kernel(void)
+{
+        return kernel()->name;
+}
+
+/*
+ *      name: colorspace_use
+ *   purpose: choose the kernel to use by name, so that each kernel can be
+ *            benchmarked and checked against the others
+ *    inputs: name - "avx2", "sse2" or "scalar"
+ *   outputs: true if the kernel exists and the processor supports it, in
+ *            which case it is used from now on; false otherwise, in which
+ *            case the kernel in use does not change
+ *    errors: raises a checked runtime error if name is NULL
+ */
+bool colorspace_use(const char *name)
+{
+        assert(name != NULL);
+
+        for (size_t i = 0; i < sizeof(kernels) / sizeof(kernels[0]); i++) {
+                if (strcmp(kernels[i].name, name) == 0) {
+                        if (!kernels[i].supported()) {
+                                return false;
+                        }
+                        selected = &kernels[i];
+                        return true;
+                }
+        }
+        return false;
+}
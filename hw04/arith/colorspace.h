@@ -0,0 +1,27 @@
+/*
+ *     colorspace.h
+ *     by Helena Lowe (hlowe01) & Olivia Byun (obyun01)
+ *     arith
+ *     10/26/22
+ *
+ *     This is the interface for colorspace, which converts whole runs of
+ *     pixels between floating-point RGB and component video color space.
+ *     The pixels are held as planes: one array of red values, one of green
+ *     and one of blue, or one each of Y, Pb and Pr. The conversion is done
+ *     by the fastest kernel the processor supports (AVX2, SSE2 or plain C),
+ *     and every kernel gives exactly the same results as rgb_to_video and
+ *     video_to_rgb in transform.
+ */
+
+#include <stdlib.h>
+#include <stdbool.h>
+
+void colorspace_to_video(const float *red, const float *green,
+                         const float *blue, float *y, float *pb, float *pr,
+                         size_t n);
+void colorspace_to_rgb(const float *y, const float *pb, const float *pr,
+                       float *red, float *green, float *blue, size_t n);
+
+/* KERNEL SELECTION */
+const char *colorspace_kernel(void);
+bool colorspace_use(const char *name);
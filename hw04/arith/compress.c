@@ -6,39 +6,217 @@
  *
  *     This file is the implementation for compress and compresses a provided 
  *     PPM image into a compressed image stored using codewords.
+ *
+ *     Compression streams through the image a strip of rows at a time. For
+ *     each pair of rows it converts the pixels to planes of Y, Pb and Pr
+ *     values with colorspace's vector kernels, quantizes the whole row of
+ *     2x2 blocks with dct's, and packs the codewords. The kernels do the same
+ *     arithmetic as pixel_to_float in ppm_rgb and rgb_to_video,
+ *     block_to_discrete and quantize in transform, so every kernel gives the
+ *     same output byte for byte. Only a few strips are held in memory,
+ *     however big the image.
+ *
+ *     Strips are independent, so strips runs them on a pool of threads when
+ *     asked to; the strips are still read and written in order, so the
+ *     output does not depend on the number of threads.
  */
 
 #include <string.h>
 #include <stdlib.h>
 #include <stdio.h>
 #include "assert.h"
+#include "mem.h"
 #include "compress.h"
 #include "codewords.h"
+#include "colorspace.h"
+#include "dct.h"
+#include "strips.h"
+
+/* 
+ * purpose: what compressing any strip needs to know about the image
+ * members: reader - the reader for the PPM image
+ *          width, height - the size of the image in 2x2 blocks
+ */
+struct Image {
+        struct Ppm_reader reader;
+        unsigned width, height;
+};
+
+/* 
+ * purpose: the buffers for compressing one strip of the image
+ * members: rows - the number of rows of blocks in the strip
+ *          raw - the strip's rows as read, if the image is raw
+ *          pixels - the strip's rows of pixels
+ *          planes - a pair of rows as planes of R, G, B, then of Y, Pb, Pr
+ *          quant - a row of blocks' quantized values
+ *          chars - the strip's codewords, as printed
+ */
+struct Strip {
+        unsigned rows;
+        unsigned char *raw;
+        struct Pnm_rgb *pixels;
+        float *planes;
+        struct Quant_pix *quant;
+        char *chars;
+};
+
+/* 
+ *      name: read_strip
+ *   purpose: read the rows of pixels of a strip. The rows of a plain
+ *            image have to be parsed as they are read; those of a raw image
+ *            are unpacked by compress_strip.
+ *    inputs: strip - the strip's buffers
+ *            index - which strip it is
+ *            image - the image
+ *   outputs: none
+ *    errors: raises Pnm_Badformat if the image ends early
+ */
+static void read_strip(void *strip, unsigned index, void *image)
+{
+        struct Strip *curr = strip;
+        struct Image *img = image;
+        unsigned first = index * STRIP_ROWS;
+
+        curr->rows = img->height - first < STRIP_ROWS ? img->height - first
+                                                      : STRIP_ROWS;
+        if (!img->reader.plain) {
+                ppmrgb_read_raw(&img->reader, curr->raw, 2 * curr->rows);
+                return;
+        }
+        for (unsigned row = 0; row < 2 * curr->rows; row++) {
+                ppmrgb_read_row(&img->reader,
+                                &curr->pixels[(size_t)row * img->reader.width]);
+        }
+}
+
+/* 
+ *      name: compress_strip
+ *   purpose: compress the pixels of a strip into codewords
+ *    inputs: strip - the strip's buffers, from read_strip
+ *            index - which strip it is
+ *            image - the image
+ *   outputs: none
+ *    errors: none
+ */
+static void compress_strip(void *strip, unsigned index, void *image)
+{
+        struct Strip *curr = strip;
+        struct Image *img = image;
+        unsigned width = img->width;
+        size_t n = (size_t)width * 2;
+        (void)index;
+
+        float *red = curr->planes, *green = red + 2 * n;
+        float *blue = green + 2 * n, *y = blue + 2 * n;
+        float *pb = y + 2 * n, *pr = pb + 2 * n;
+
+        for (unsigned row = 0; row < curr->rows; row++) {
+                struct Pnm_rgb *top = &curr->pixels[(size_t)2 * row *
+                                                    img->reader.width];
+                struct Pnm_rgb *bottom = top + img->reader.width;
+                char *chars = &curr->chars[(size_t)row * width * 32];
+
+                if (!img->reader.plain) {
+                        size_t size = ppmrgb_raw_size(&img->reader);
+                        ppmrgb_unpack_row(&img->reader,
+                                          &curr->raw[2 * row * size], top);
+                        ppmrgb_unpack_row(&img->reader,
+                                          &curr->raw[(2 * row + 1) * size],
+                                          bottom);
+                }
+                pixels_to_planes(top, n, img->reader.denominator, red, green,
+                                 blue);
+                pixels_to_planes(bottom, n, img->reader.denominator, red + n,
+                                 green + n, blue + n);
+                colorspace_to_video(red, green, blue, y, pb, pr, 2 * n);
+                dct_quantize(y, pb, pr, n, width, curr->quant);
+
+                for (unsigned col = 0; col < width; col++) {
+                        uint64_t word = codeword_pack(0, &curr->quant[col]);
+                        codeword_chars(word, &chars[(size_t)col * 32]);
+                }
+        }
+}
+
+/* 
+ *      name: write_strip
+ *   purpose: print the codewords of a strip to standard output
+ *    inputs: strip - the strip's buffers, from compress_strip
+ *            index - which strip it is
+ *            image - the image
+ *   outputs: none
+ *    errors: none
+ */
+static void write_strip(void *strip, unsigned index, void *image)
+{
+        struct Strip *curr = strip;
+        struct Image *img = image;
+        (void)index;
+
+        fwrite(curr->chars, 32, (size_t)img->width * curr->rows, stdout);
+}
 
 /* 
  *      name: compress
  *   purpose: compresses a provided PPM image
- *    inputs: fp - pointer to beginning of file to be compressed
+ *    inputs:      fp - pointer to beginning of file to be compressed
+ *            threads - the number of threads to compress strips on
  *   outputs: none
- *    errors: raises a checked runtime error if the file pointer is NULL
+ *    errors: raises a checked runtime error if the file pointer is NULL or
+ *            threads is 0; raises Mem_Failed if memory cannot be allocated;
+ *            raises Pnm_Badformat if the file is not a raw or plain PPM
+ *            image
  */
-void compress(FILE *fp) 
+void compress(FILE *fp, unsigned threads) 
 {
         assert(fp != NULL);
+        assert(threads > 0);
+
+        struct Image image;
+        ppmrgb_start(&image.reader, fp);
+
+        /* an odd last row or column is trimmed */
+        image.width = image.reader.width / 2;
+        image.height = image.reader.height / 2;
+        size_t n = (size_t)image.width * 2;
 
-        /* transform from scaled integer to floating-point representation */
-        A2Methods_UArray2 float_arr = ppmrgb_compress(fp);
+        fprintf(stdout, "COMP40 Compressed image format 2\n%u %u",
+                image.width, image.height);
+        fprintf(stdout, "\n");
 
-        /* discrete cosine transformation and quantization */
-        A2Methods_UArray2 quant_arr = transform_compress(float_arr);
+        /* choose the kernels now, before any threads share them */
+        colorspace_kernel();
+        dct_kernel();
 
-        /* pack into codewords */
-        codewords_compress(quant_arr);
+        size_t raw_size = image.reader.plain ? 0
+                                             : ppmrgb_raw_size(&image.reader);
+        unsigned num_slots = strips_slots(threads);
+        struct Strip *strips = ALLOC((long)num_slots * sizeof(struct Strip));
+        void **slots = ALLOC((long)num_slots * sizeof(void *));
+        for (unsigned s = 0; s < num_slots; s++) {
+                struct Strip *curr = &strips[s];
+                curr->raw = ALLOC(2 * STRIP_ROWS * (long)raw_size + 1);
+                curr->pixels = ALLOC((2L * STRIP_ROWS * image.reader.width +
+                                      1) * sizeof(struct Pnm_rgb));
+                curr->planes = ALLOC((12 * (long)n + 1) * sizeof(float));
+                curr->quant = ALLOC(((long)image.width + 1) *
+                                    sizeof(struct Quant_pix));
+                curr->chars = ALLOC((long)STRIP_ROWS * image.width * 32 + 1);
+                slots[s] = curr;
+        }
 
-        A2Methods_T methods = uarray2_methods_plain; /* get methods suite */
-        assert(methods != NULL);
+        unsigned count = (image.height + STRIP_ROWS - 1) / STRIP_ROWS;
+        strips_run(count, threads, slots, num_slots, read_strip,
+                   compress_strip, write_strip, &image);
 
-        /* free heap-allocated memory */
-        methods->free(&float_arr);
-        methods->free(&quant_arr);
-}
\ No newline at end of file
+        for (unsigned s = 0; s < num_slots; s++) {
+                FREE(strips[s].raw);
+                FREE(strips[s].pixels);
+                FREE(strips[s].planes);
+                FREE(strips[s].quant);
+                FREE(strips[s].chars);
+        }
+        FREE(strips);
+        FREE(slots);
+        ppmrgb_finish(&image.reader);
+}
@@ -12,5 +12,5 @@
 #include <stdlib.h>
 #include <stdio.h>
 
-void compress(FILE *fp);
+void compress(FILE *fp, unsigned threads);
 
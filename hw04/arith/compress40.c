@@ -28,7 +28,7 @@ extern void compress40(FILE *input)
         assert(input != NULL);
 
         /* compress and print compressed image */
-        compress(input);
+        compress(input, 1);
 }
 
 /* 
@@ -43,5 +43,5 @@ extern void decompress40(FILE *input)
         assert(input != NULL);
 
         /* decompress and print decompressed image */
-        decompress(input);
+        decompress(input, 1);
 }
\ No newline at end of file
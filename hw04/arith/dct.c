@@ -0,0 +1,571 @@
+/*
+ *     dct.c
+ *     by Helena Lowe (hlowe01) & Olivia Byun (obyun01)
+ *     arith
+ *     10/26/22
+ *
+ *     This is the implementation for dct, which takes a row of 2x2 blocks
+ *     from planes of Y, Pb and Pr values to quantized values in one sweep.
+ *
+ *     The vector kernels handle 4 (SSE2) or 8 (AVX2) horizontally adjacent
+ *     blocks per iteration. They split each row of a plane into its even
+ *     and odd pixels, which are the left and right pixels of the blocks,
+ *     and then do what block_to_discrete and quantize do, lane by lane:
+ *
+ *       - the sums for a, b, c, d and the Pb and Pr averages are added in
+ *         float in the same order. block_to_discrete divides them by 4.0 in
+ *         double and rounds to float; the double quotient is exact, so
+ *         multiplying by 0.25 in float gives the same bits.
+ *       - b, c and d are compared with -0.3 and 0.3 in double. The floats
+ *         beyond those are exactly the floats beyond (float)-0.3 and
+ *         (float)0.3, so clamping with float max and min is the same.
+ *       - a * 511 is truncated, as converting it to unsigned does.
+ *       - round(50 * b) rounds halves away from zero. The kernels truncate
+ *         and then step away from zero if the fraction left over, which is
+ *         exact, is at least one half.
+ *       - Arith40_index_of_chroma picks the nearest entry of a sorted table,
+ *         so the index it returns only grows with the chroma value. The
+ *         smallest value giving each index is found once, by binary search
+ *         over the floats in [-1, 1] (averages of Pb and Pr lie within
+ *         [-0.5, 0.5]), and the kernels count how many of those 15
+ *         thresholds a value reaches.
+ *
+ *     So every kernel agrees with the scalar code bit for bit. Blocks left
+ *     over at the end of a row go through the scalar kernel.
+ *
+ *     The kernel is chosen the first time one is needed, from what CPUID
+ *     says the processor supports, unless dct_use has picked one.
+ */
+
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "assert.h"
+#include "arith40.h"
+#include "transform.h"
+#include "dct.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define HAVE_X86 1
+#else
+#define HAVE_X86 0
+#endif
+
+#define NUM_CHROMA 16
+
+typedef void (*Quantize)(const float *y, const float *pb, const float *pr,
+                         size_t width, size_t blocks,
+                         struct Quant_pix *quant);
+
+/*
+ * purpose: describe one implementation of dct_quantize
+ * members: name - what dct_kernel and dct_use call it
+ *          supported - says whether the processor can run it
+ *          quantize - the implementation
+ */
+struct Kernel {
+        const char *name;
+        bool (*supported)(void);
+        Quantize quantize;
+};
+
+/* thresholds[i - 1] is the smallest chroma value whose index is i */
+static float thresholds[NUM_CHROMA - 1];
+
+/*
+ *      name: scalar_quantize
+ *   purpose: quantize a row of blocks one at a time with block_to_discrete
+ *            and quantize
+ *    inputs: y, pb, pr - planes holding two rows of pixels, the upper row
+ *                        then the lower
+ *                width - the number of pixels in a row
+ *               blocks - the number of blocks to quantize, from the left
+ *                quant - where to store the blocks' quantized values
+ *   outputs: none
+ *    errors: none
+ */
+static void scalar_quantize(const float *y, const float *pb, const float *pr,
+                            size_t width, size_t blocks,
+                            struct Quant_pix *quant)
+{
+        for (size_t col = 0; col < blocks; col++) {
+                /* top left, top right, bottom left, bottom right */
+                size_t at[4] = { 2 * col, 2 * col + 1, width + 2 * col,
+                                 width + 2 * col + 1 };
+                struct Video_pix video[4];
+                for (int i = 0; i < 4; i++) {
+                        video[i].y = y[at[i]];
+                        video[i].pb = pb[at[i]];
+                        video[i].pr = pr[at[i]];
+                }
+
+                struct Discrete_pix discrete;
+                block_to_discrete(&video[0], &video[1], &video[2],
+                                  &video[3], &discrete);
+                quantize(&discrete, &quant[col]);
+        }
+}
+
+/*
+ *      name: scalar_supported
+ *   purpose: say whether the scalar kernel can run, which it always can
+ *    inputs: none
+ *   outputs: true
+ *    errors: none
+ */
+static bool scalar_supported(void)
+{
+        return true;
+}
+
+/*
+ *      name: key_of
+ *   purpose: map a float to an unsigned key, so that keys are in the same
+ *            order as the floats they come from
+ *    inputs: x - the float, which is not a NaN
+ *   outputs: the key
+ *    errors: none
+ */
+static uint32_t key_of(float x)
+{
+        uint32_t bits;
+        memcpy(&bits, &x, sizeof(bits));
+        return bits & 0x80000000 ? ~bits : bits | 0x80000000;
+}
+
+/*
+ *      name: float_of
+ *   purpose: map a key from key_of back to its float
+ *    inputs: key - the key
+ *   outputs: the float
+ *    errors: none
+ */
+static float float_of(uint32_t key)
+{
+        uint32_t bits = key & 0x80000000 ? key & 0x7fffffff : ~key;
+        float x;
+        memcpy(&x, &bits, sizeof(x));
+        return x;
+}
+
+/*
+ *      name: find_thresholds
+ *   purpose: find, once, the smallest chroma value in [-1, 1] that
+ *            Arith40_index_of_chroma gives each index for
+ *    inputs: none
+ *   outputs: true if -1 gives index 0 and 1 gives the last index, so that
+ *            every index has a threshold; false otherwise, in which case
+ *            the vector kernels cannot be used
+ *    errors: none
+ */
+static bool find_thresholds(void)
+{
+        static int found = -1;
+        if (found >= 0) {
+                return found;
+        }
+
+        found = Arith40_index_of_chroma(-1) == 0 &&
+                Arith40_index_of_chroma(1) == NUM_CHROMA - 1;
+        for (unsigned i = 1; found && i < NUM_CHROMA; i++) {
+                /* the index at lo is below i and the one at hi is not */
+                uint32_t lo = key_of(-1), hi = key_of(1);
+                while (hi - lo > 1) {
+                        uint32_t mid = lo + (hi - lo) / 2;
+                        if (Arith40_index_of_chroma(float_of(mid)) < i) {
+                                lo = mid;
+                        } else {
+                                hi = mid;
+                        }
+                }
+                thresholds[i - 1] = float_of(hi);
+        }
+        return found;
+}
+
+#if HAVE_X86
+
+/*
+ *      name: sse2_split
+ *   purpose: load 8 pixels of a row and split them into the left and
+ *            right pixels of 4 blocks
+ *    inputs: row - the first pixel
+ *            left, right - where to store the left and right pixels
+ *   outputs: none
+ *    errors: none
+ */
+__attribute__((target("sse2")))
+static inline void sse2_split(const float *row, __m128 *left, __m128 *right)
+{
+        __m128 low = _mm_loadu_ps(row);
+        __m128 high = _mm_loadu_ps(row + 4);
+        *left = _mm_shuffle_ps(low, high, _MM_SHUFFLE(2, 0, 2, 0));
+        *right = _mm_shuffle_ps(low, high, _MM_SHUFFLE(3, 1, 3, 1));
+}
+
+/*
+ *      name: sse2_scale
+ *   purpose: take 4 b, c or d values from the transform to their 5-bit
+ *            signed values, as quantize does
+ *    inputs: value - the values
+ *   outputs: the quantized values
+ *    errors: none
+ */
+__attribute__((target("sse2")))
+static inline __m128i sse2_scale(__m128 value)
+{
+        value = _mm_max_ps(_mm_set1_ps(-0.3f), value);
+        value = _mm_min_ps(_mm_set1_ps(0.3f), value);
+        value = _mm_mul_ps(_mm_set1_ps(50), value);
+
+        /* round halves away from zero; the masks are -1 where true */
+        __m128i whole = _mm_cvttps_epi32(value);
+        __m128 fraction = _mm_sub_ps(value, _mm_cvtepi32_ps(whole));
+        __m128 up = _mm_cmpge_ps(fraction, _mm_set1_ps(0.5f));
+        __m128 down = _mm_cmple_ps(fraction, _mm_set1_ps(-0.5f));
+        whole = _mm_sub_epi32(whole, _mm_castps_si128(up));
+        return _mm_add_epi32(whole, _mm_castps_si128(down));
+}
+
+/*
+ *      name: sse2_chroma
+ *   purpose: find the chroma indices of 4 average Pb or Pr values, as
+ *            Arith40_index_of_chroma does
+ *    inputs: value - the values
+ *   outputs: the indices
+ *    errors: none
+ */
+__attribute__((target("sse2")))
+static inline __m128i sse2_chroma(__m128 value)
+{
+        __m128i index = _mm_setzero_si128();
+        for (int i = 0; i < NUM_CHROMA - 1; i++) {
+                __m128 reached = _mm_cmpge_ps(value,
+                                              _mm_set1_ps(thresholds[i]));
+                index = _mm_sub_epi32(index, _mm_castps_si128(reached));
+        }
+        return index;
+}
+
+/*
+ *      name: sse2_quantize
+ *   purpose: quantize a row of blocks 4 at a time, using SSE2
+ *    inputs: as scalar_quantize
+ *   outputs: none
+ *    errors: none
+ */
+__attribute__((target("sse2")))
+static void sse2_quantize(const float *y, const float *pb, const float *pr,
+                          size_t width, size_t blocks,
+                          struct Quant_pix *quant)
+{
+        const __m128 quarter = _mm_set1_ps(0.25f);
+        size_t i = 0;
+
+        for (; i + 4 <= blocks; i += 4) {
+                size_t x = 2 * i;
+                __m128 y1, y2, y3, y4, b1, b2, b3, b4, r1, r2, r3, r4;
+                sse2_split(&y[x], &y1, &y2);
+                sse2_split(&y[width + x], &y3, &y4);
+                sse2_split(&pb[x], &b1, &b2);
+                sse2_split(&pb[width + x], &b3, &b4);
+                sse2_split(&pr[x], &r1, &r2);
+                sse2_split(&pr[width + x], &r3, &r4);
+
+                __m128 sum = _mm_add_ps(y4, y3), diff = _mm_sub_ps(y4, y3);
+                __m128 a = _mm_add_ps(_mm_add_ps(sum, y2), y1);
+                __m128 b = _mm_sub_ps(_mm_sub_ps(sum, y2), y1);
+                __m128 c = _mm_sub_ps(_mm_add_ps(diff, y2), y1);
+                __m128 d = _mm_add_ps(_mm_sub_ps(diff, y2), y1);
+                __m128 pb_avg = _mm_add_ps(_mm_add_ps(_mm_add_ps(b1, b2),
+                                                      b3), b4);
+                __m128 pr_avg = _mm_add_ps(_mm_add_ps(_mm_add_ps(r1, r2),
+                                                      r3), r4);
+
+                int out[6][4];
+                a = _mm_mul_ps(_mm_mul_ps(a, quarter), _mm_set1_ps(511));
+                _mm_storeu_si128((__m128i *)out[0], _mm_cvttps_epi32(a));
+                _mm_storeu_si128((__m128i *)out[1],
+                                 sse2_scale(_mm_mul_ps(b, quarter)));
+                _mm_storeu_si128((__m128i *)out[2],
+                                 sse2_scale(_mm_mul_ps(c, quarter)));
+                _mm_storeu_si128((__m128i *)out[3],
+                                 sse2_scale(_mm_mul_ps(d, quarter)));
+                _mm_storeu_si128((__m128i *)out[4],
+                                 sse2_chroma(_mm_mul_ps(pb_avg, quarter)));
+                _mm_storeu_si128((__m128i *)out[5],
+                                 sse2_chroma(_mm_mul_ps(pr_avg, quarter)));
+
+                for (int k = 0; k < 4; k++) {
+                        quant[i + k].a = out[0][k];
+                        quant[i + k].b = out[1][k];
+                        quant[i + k].c = out[2][k];
+                        quant[i + k].d = out[3][k];
+                        quant[i + k].pb = out[4][k];
+                        quant[i + k].pr = out[5][k];
+                }
+        }
+        scalar_quantize(&y[2 * i], &pb[2 * i], &pr[2 * i], width, blocks - i,
+                        &quant[i]);
+}
+
+/*
+ *      name: sse2_supported
+ *   purpose: say whether the processor supports SSE2 and the chroma
+ *            thresholds could be found
+ *    inputs: none
+ *   outputs: true if both hold
+ *    errors: none
+ */
+static bool sse2_supported(void)
+{
+        return __builtin_cpu_supports("sse2") && find_thresholds();
+}
+
+/*
+ *      name: avx2_split
+ *   purpose: load 16 pixels of a row and split them into the left and
+ *            right pixels of 8 blocks
+ *    inputs: row - the first pixel
+ *            left, right - where to store the left and right pixels
+ *   outputs: none
+ *    errors: none
+ */
+__attribute__((target("avx2")))
+static inline void avx2_split(const float *row, __m256 *left, __m256 *right)
+{
+        __m256 low = _mm256_loadu_ps(row);
+        __m256 high = _mm256_loadu_ps(row + 8);
+
+        /* shuffling works within each half, leaving blocks 0 1 4 5 2 3 6
+           7; swapping the middle pairs puts them in order */
+        __m256 even = _mm256_shuffle_ps(low, high, _MM_SHUFFLE(2, 0, 2, 0));
+        __m256 odd = _mm256_shuffle_ps(low, high, _MM_SHUFFLE(3, 1, 3, 1));
+        *left = _mm256_castpd_ps(_mm256_permute4x64_pd(
+                        _mm256_castps_pd(even), _MM_SHUFFLE(3, 1, 2, 0)));
+        *right = _mm256_castpd_ps(_mm256_permute4x64_pd(
+                        _mm256_castps_pd(odd), _MM_SHUFFLE(3, 1, 2, 0)));
+}
+
+/*
+ *      name: avx2_scale
+ *   purpose: take 8 b, c or d values from the transform to their 5-bit
+ *            signed values, as quantize does
+ *    inputs: value - the values
+ *   outputs: the quantized values
+ *    errors: none
+ */
+__attribute__((target("avx2")))
+static inline __m256i avx2_scale(__m256 value)
+{
+        value = _mm256_max_ps(_mm256_set1_ps(-0.3f), value);
+        value = _mm256_min_ps(_mm256_set1_ps(0.3f), value);
+        value = _mm256_mul_ps(_mm256_set1_ps(50), value);
+
+        /* round halves away from zero; the masks are -1 where true */
+        __m256i whole = _mm256_cvttps_epi32(value);
+        __m256 fraction = _mm256_sub_ps(value, _mm256_cvtepi32_ps(whole));
+        __m256 up = _mm256_cmp_ps(fraction, _mm256_set1_ps(0.5f),
+                                  _CMP_GE_OQ);
+        __m256 down = _mm256_cmp_ps(fraction, _mm256_set1_ps(-0.5f),
+                                    _CMP_LE_OQ);
+        whole = _mm256_sub_epi32(whole, _mm256_castps_si256(up));
+        return _mm256_add_epi32(whole, _mm256_castps_si256(down));
+}
+
+/*
+ *      name: avx2_chroma
+ *   purpose: find the chroma indices of 8 average Pb or Pr values, as
+ *            Arith40_index_of_chroma does
+ *    inputs: value - the values
+ *   outputs: the indices
+ *    errors: none
+ */
+__attribute__((target("avx2")))
+static inline __m256i avx2_chroma(__m256 value)
+{
+        __m256i index = _mm256_setzero_si256();
+        for (int i = 0; i < NUM_CHROMA - 1; i++) {
+                __m256 reached = _mm256_cmp_ps(value,
+                                               _mm256_set1_ps(thresholds[i]),
+                                               _CMP_GE_OQ);
+                index = _mm256_sub_epi32(index, _mm256_castps_si256(reached));
+        }
+        return index;
+}
+
+/*
+ *      name: avx2_quantize
+ *   purpose: quantize a row of blocks 8 at a time, using AVX2
+ *    inputs: as scalar_quantize
+ *   outputs: none
+ *    errors: none
+ */
+__attribute__((target("avx2")))
+static void avx2_quantize(const float *y, const float *pb, const float *pr,
+                          size_t width, size_t blocks,
+                          struct Quant_pix *quant)
+{
+        const __m256 quarter = _mm256_set1_ps(0.25f);
+        size_t i = 0;
+
+        for (; i + 8 <= blocks; i += 8) {
+                size_t x = 2 * i;
+                __m256 y1, y2, y3, y4, b1, b2, b3, b4, r1, r2, r3, r4;
+                avx2_split(&y[x], &y1, &y2);
+                avx2_split(&y[width + x], &y3, &y4);
+                avx2_split(&pb[x], &b1, &b2);
+                avx2_split(&pb[width + x], &b3, &b4);
+                avx2_split(&pr[x], &r1, &r2);
+                avx2_split(&pr[width + x], &r3, &r4);
+
+                __m256 sum = _mm256_add_ps(y4, y3);
+                __m256 diff = _mm256_sub_ps(y4, y3);
+                __m256 a = _mm256_add_ps(_mm256_add_ps(sum, y2), y1);
+                __m256 b = _mm256_sub_ps(_mm256_sub_ps(sum, y2), y1);
+                __m256 c = _mm256_sub_ps(_mm256_add_ps(diff, y2), y1);
+                __m256 d = _mm256_add_ps(_mm256_sub_ps(diff, y2), y1);
+                __m256 pb_avg = _mm256_add_ps(_mm256_add_ps(
+                                        _mm256_add_ps(b1, b2), b3), b4);
+                __m256 pr_avg = _mm256_add_ps(_mm256_add_ps(
+                                        _mm256_add_ps(r1, r2), r3), r4);
+
+                int out[6][8];
+                a = _mm256_mul_ps(_mm256_mul_ps(a, quarter),
+                                  _mm256_set1_ps(511));
+                _mm256_storeu_si256((__m256i *)out[0],
+                                    _mm256_cvttps_epi32(a));
+                _mm256_storeu_si256((__m256i *)out[1],
+                                    avx2_scale(_mm256_mul_ps(b, quarter)));
+                _mm256_storeu_si256((__m256i *)out[2],
+                                    avx2_scale(_mm256_mul_ps(c, quarter)));
+                _mm256_storeu_si256((__m256i *)out[3],
+                                    avx2_scale(_mm256_mul_ps(d, quarter)));
+                _mm256_storeu_si256((__m256i *)out[4], avx2_chroma(
+                                    _mm256_mul_ps(pb_avg, quarter)));
+                _mm256_storeu_si256((__m256i *)out[5], avx2_chroma(
+                                    _mm256_mul_ps(pr_avg, quarter)));
+
+                for (int k = 0; k < 8; k++) {
+                        quant[i + k].a = out[0][k];
+                        quant[i + k].b = out[1][k];
+                        quant[i + k].c = out[2][k];
+                        quant[i + k].d = out[3][k];
+                        quant[i + k].pb = out[4][k];
+                        quant[i + k].pr = out[5][k];
+                }
+        }
+        scalar_quantize(&y[2 * i], &pb[2 * i], &pr[2 * i], width, blocks - i,
+                        &quant[i]);
+}
+
+/*
+ *      name: avx2_supported
+ *   purpose: say whether the processor and operating system support AVX2
+ *            and the chroma thresholds could be found
+ *    inputs: none
+ *   outputs: true if both hold
+ *    errors: none
+ */
+static bool avx2_supported(void)
+{
+        return __builtin_cpu_supports("avx2") && find_thresholds();
+}
+
+#endif
+
+/* the kernels, fastest first */
+static const struct Kernel kernels[] = {
+#if HAVE_X86
+        { "avx2", avx2_supported, avx2_quantize },
+        { "sse2", sse2_supported, sse2_quantize },
+#endif
+        { "scalar", scalar_supported, scalar_quantize },
+};
+
+static const struct Kernel *selected = NULL;
+
+/*
+ *      name: kernel
+ *   purpose: get the kernel in use, choosing the fastest one the processor
+ *            supports if none has been chosen yet
+ *    inputs: none
+ *   outputs: the kernel
+ *    errors: none
+ */
+static const struct Kernel *kernel(void)
+{
+        if (selected == NULL) {
+                size_t i = 0;
+                while (!kernels[i].supported()) {
+                        i++;
+                }
+                selected = &kernels[i];
+        }
+        return selected;
+}
+
+/*
+ *      name: dct_quantize
+ *   purpose: apply the discrete cosine transform to a row of 2x2 blocks and
+ *            quantize them, as block_to_discrete and quantize do for each
+ *            block
+ *    inputs: y, pb, pr - planes holding two rows of pixels in component
+ *                        video color space, the upper row then the lower
+ *               width - the number of pixels in a row, at least 2 * blocks
+ *              blocks - the number of blocks to quantize, from the left
+ *               quant - where to store the blocks' quantized values
+ *   outputs: none
+ *    errors: raises a checked runtime error if any array is NULL or the rows
+ *            are too short for the blocks
+ */
+void dct_quantize(const float *y, const float *pb, const float *pr,
+                  size_t width, size_t blocks, struct Quant_pix *quant)
+{
+        assert(y != NULL && pb != NULL && pr != NULL);
+        assert(quant != NULL);
+        assert(width >= 2 * blocks);
+
+        kernel()->quantize(y, pb, pr, width, blocks, quant);
+}
+
+/*
+ *      name: dct_kernel
+ *   purpose: get the name of the kernel in use
+ *    inputs: none
+ *   outputs: "avx2", "sse2" or "scalar"
+ *    errors: none
+ */
+const char *dct_kernel(void)
+{
+        return kernel()->name;
+}
+
+/*
+ *      name: dct_use
+ *   purpose: choose the kernel to use by name, so that each kernel can be
+ *            benchmarked and checked against the others
+ *    inputs: name - "avx2", "sse2" or "scalar"
+ *   outputs: true if the kernel exists and can run, in which case it is
+ *            used from now on; false otherwise, in which case the kernel in
+ *            use does not change
+ *    errors: raises a checked runtime error if name is NULL
+ */
+bool dct_use(const char *name)
+{
+        assert(name != NULL);
+
+        for (size_t i = 0; i < sizeof(kernels) / sizeof(kernels[0]); i++) {
+                if (strcmp(kernels[i].name, name) == 0) {
+                        if (!kernels[i].supported()) {
+                                return false;
+                        }
+                        selected = &kernels[i];
+                        return true;
+                }
+        }
+        return false;
+}
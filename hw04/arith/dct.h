@@ -0,0 +1,26 @@
+/*
+ *     dct.h
+ *     by Helena Lowe (hlowe01) & Olivia Byun (obyun01)
+ *     arith
+ *     10/26/22
+ *
+ *     This is the interface for dct, which takes a whole row of 2x2 blocks
+ *     of pixels in component video color space through the discrete cosine
+ *     transform and quantization in one sweep. The pixels are held as
+ *     planes of Y, Pb and Pr values, as colorspace produces them. The work
+ *     is done by the fastest kernel the processor supports (AVX2, SSE2 or
+ *     plain C), and every kernel gives exactly the same results as
+ *     block_to_discrete and quantize in transform.
+ */
+
+#include <stdlib.h>
+#include <stdbool.h>
+
+struct Quant_pix;
+
+void dct_quantize(const float *y, const float *pb, const float *pr,
+                  size_t width, size_t blocks, struct Quant_pix *quant);
+
+/* KERNEL SELECTION */
+const char *dct_kernel(void);
+bool dct_use(const char *name);
@@ -6,39 +6,223 @@
  *
  *     This file is the interface for decompress and allows a user to decompress
  *     a provided image (stored using codewords) into a regular PPM image.
+ *
+ *     Decompression streams like compression does, a strip of rows of
+ *     codewords at a time. It decodes each row into planes of Y, Pb and Pr
+ *     values, converts those to RGB with colorspace's vector kernels, and
+ *     writes the two rows of pixels they hold. colorspace's kernels do the
+ *     same arithmetic as video_to_rgb in transform, so every kernel gives the
+ *     same output byte for byte.
+ *
+ *     As in compression, strips runs the strips on a pool of threads when
+ *     asked to, reading and writing them in order.
  */
 
 #include <string.h>
 #include <stdlib.h>
 #include <stdio.h>
 #include "assert.h"
+#include "mem.h"
+#include "bitpack.h"
 #include "decompress.h"
 #include "codewords.h"
+#include "colorspace.h"
+#include "strips.h"
+
+/* 
+ * purpose: what decompressing any strip needs to know about the image
+ * members: fp - the compressed image
+ *          writer - the writer for the PPM image
+ *          width, height - the size of the image in 2x2 blocks
+ */
+struct Image {
+        FILE *fp;
+        struct Ppm_writer writer;
+        unsigned width, height;
+};
+
+/* 
+ * purpose: the buffers for decompressing one strip of the image
+ * members: rows - the number of rows of blocks in the strip
+ *          chars - the strip's codewords, as read
+ *          planes - a pair of rows as planes of Y, Pb, Pr, then of R, G, B
+ *          pixels - a pair of rows of pixels
+ *          raw - the strip's rows of pixels, packed to be written
+ */
+struct Strip {
+        unsigned rows;
+        unsigned char *chars;
+        float *planes;
+        struct Pnm_rgb *pixels;
+        unsigned char *raw;
+};
+
+/* 
+ *      name: decompress_block
+ *   purpose: decompresses one codeword into a 2x2 block of pixels in
+ *            component video color space
+ *    inputs:      word - the codeword
+ *            y, pb, pr - planes holding two rows of pixels, the upper row
+ *                        then the lower, where the block is stored
+ *                width - the number of pixels in a row
+ *                  col - the column of the block
+ *   outputs: none
+ *    errors: none
+ */
+static void decompress_block(uint64_t word, float *y, float *pb, float *pr,
+                             unsigned width, unsigned col)
+{
+        struct Quant_pix quant;
+        codeword_unpack(word, &quant);
+
+        struct Discrete_pix discrete;
+        dequantize(&quant, &discrete);
+
+        struct Video_pix video[4];
+        discrete_to_block(&discrete, &video[0], &video[1], &video[2],
+                          &video[3]);
+
+        /* top left, top right, bottom left, bottom right */
+        unsigned at[4] = { 2 * col, 2 * col + 1, width + 2 * col,
+                           width + 2 * col + 1 };
+        for (int i = 0; i < 4; i++) {
+                y[at[i]] = video[i].y;
+                pb[at[i]] = video[i].pb;
+                pr[at[i]] = video[i].pr;
+        }
+}
+
+/* 
+ *      name: read_strip
+ *   purpose: read the codewords of a strip
+ *    inputs: strip - the strip's buffers
+ *            index - which strip it is
+ *            image - the image
+ *   outputs: none
+ *    errors: raises Bitpack_Overflow if the codewords are cut short
+ */
+static void read_strip(void *strip, unsigned index, void *image)
+{
+        struct Strip *curr = strip;
+        struct Image *img = image;
+        unsigned first = index * STRIP_ROWS;
+
+        curr->rows = img->height - first < STRIP_ROWS ? img->height - first
+                                                      : STRIP_ROWS;
+        size_t words = (size_t)img->width * curr->rows;
+        if (fread(curr->chars, 32, words, img->fp) != words) {
+                RAISE(Bitpack_Overflow); /* as for a bad character */
+        }
+}
+
+/* 
+ *      name: decompress_strip
+ *   purpose: decompress the codewords of a strip into packed rows of
+ *            pixels
+ *    inputs: strip - the strip's buffers, from read_strip
+ *            index - which strip it is
+ *            image - the image
+ *   outputs: none
+ *    errors: raises Bitpack_Overflow if a codeword is malformed
+ */
+static void decompress_strip(void *strip, unsigned index, void *image)
+{
+        struct Strip *curr = strip;
+        struct Image *img = image;
+        unsigned width = img->width;
+        size_t n = (size_t)width * 2;
+        (void)index;
+
+        float *y = curr->planes, *pb = y + 2 * n, *pr = pb + 2 * n;
+        float *red = pr + 2 * n, *green = red + 2 * n;
+        float *blue = green + 2 * n;
+
+        for (unsigned row = 0; row < curr->rows; row++) {
+                const unsigned char *chars = &curr->chars[(size_t)row *
+                                                          width * 32];
+                for (unsigned col = 0; col < width; col++) {
+                        uint64_t word = codeword_of_chars(&chars[col * 32]);
+                        decompress_block(word, y, pb, pr, n, col);
+                }
+
+                unsigned char *raw = &curr->raw[2 * row * n * 3];
+                colorspace_to_rgb(y, pb, pr, red, green, blue, 2 * n);
+                planes_to_pixels(red, green, blue, n, curr->pixels);
+                planes_to_pixels(red + n, green + n, blue + n, n,
+                                 curr->pixels + n);
+                ppmrgb_pack_row(&img->writer, curr->pixels, raw);
+                ppmrgb_pack_row(&img->writer, curr->pixels + n, raw + n * 3);
+        }
+}
+
+/* 
+ *      name: write_strip
+ *   purpose: write the rows of pixels of a strip to standard output
+ *    inputs: strip - the strip's buffers, from decompress_strip
+ *            index - which strip it is
+ *            image - the image
+ *   outputs: none
+ *    errors: none
+ */
+static void write_strip(void *strip, unsigned index, void *image)
+{
+        struct Strip *curr = strip;
+        struct Image *img = image;
+        (void)index;
+
+        ppmrgb_write_raw(&img->writer, curr->raw, 2 * curr->rows);
+}
 
 /* 
  *      name: decompress
  *   purpose: decompresses a provided image
- *    inputs: fp - pointer to beginning of file to be decompressed
+ *    inputs:      fp - pointer to beginning of file to be decompressed
+ *            threads - the number of threads to decompress strips on
  *   outputs: none
- *    errors: raises a checked runtime error if the file pointer is NULL
+ *    errors: raises a checked runtime error if the file pointer is NULL,
+ *            threads is 0, the header is malformed, or the image is empty;
+ *            raises Mem_Failed if memory cannot be allocated; raises
+ *            Bitpack_Overflow if the codewords are malformed or cut short
  */
-void decompress(FILE *fp)
+void decompress(FILE *fp, unsigned threads)
 {
         assert(fp != NULL);
-        
-        /* read in compressed image into array of words */
-        A2Methods_UArray2 quant_array = codewords_decompress(fp);
+        assert(threads > 0);
+
+        struct Image image;
+        image.fp = fp;
+        codewords_read_header(fp, &image.width, &image.height);
+        size_t n = (size_t)image.width * 2;
+
+        ppmrgb_start_write(&image.writer, stdout, image.width * 2,
+                           image.height * 2);
 
-        /* transform quantized pixels to floating-point RGB pixels */
-        A2Methods_UArray2 float_array = transform_decompress(quant_array);
+        /* choose the kernels now, before any threads share them */
+        colorspace_kernel();
 
-        /* transform to RGB scaled-int form and print regular PPM */
-        ppmrgb_decompress(float_array);
+        unsigned num_slots = strips_slots(threads);
+        struct Strip *strips = ALLOC((long)num_slots * sizeof(struct Strip));
+        void **slots = ALLOC((long)num_slots * sizeof(void *));
+        for (unsigned s = 0; s < num_slots; s++) {
+                struct Strip *curr = &strips[s];
+                curr->chars = ALLOC((long)STRIP_ROWS * image.width * 32 + 1);
+                curr->planes = ALLOC((12 * (long)n + 1) * sizeof(float));
+                curr->pixels = ALLOC((2 * (long)n + 1) *
+                                     sizeof(struct Pnm_rgb));
+                curr->raw = ALLOC(2 * STRIP_ROWS * (long)n * 3 + 1);
+                slots[s] = curr;
+        }
 
-        A2Methods_T methods = uarray2_methods_plain; /* get methods suite */
-        assert(methods != NULL);
+        unsigned count = (image.height + STRIP_ROWS - 1) / STRIP_ROWS;
+        strips_run(count, threads, slots, num_slots, read_strip,
+                   decompress_strip, write_strip, &image);
 
-        /* free heap-allocated memory */
-        methods->free(&float_array);
-        methods->free(&quant_array);
-}
\ No newline at end of file
+        for (unsigned s = 0; s < num_slots; s++) {
+                FREE(strips[s].chars);
+                FREE(strips[s].planes);
+                FREE(strips[s].pixels);
+                FREE(strips[s].raw);
+        }
+        FREE(strips);
+        FREE(slots);
+}
@@ -12,4 +12,4 @@
 #include <stdlib.h>
 #include <stdio.h>
 
-void decompress(FILE *fp);
\ No newline at end of file
+void decompress(FILE *fp, unsigned threads);
\ No newline at end of file
@@ -0,0 +1,212 @@
+/*
+ *     kernelbench.c
+ *     by Helena Lowe (hlowe01) & Olivia Byun (obyun01)
+ *     arith
+ *     10/26/22
+ *
+ *     This program is a microbenchmark for the colorspace and dct kernels.
+ *     For each kernel the processor supports it times the conversion of
+ *     planes of pixels from RGB to component video and back, and prints how
+ *     many pixels each direction converts per nanosecond. Then it times the
+ *     quantization of the component video planes, taken as two rows of
+ *     2x2 blocks, and prints how many blocks are quantized per nanosecond.
+ *     Each time is the fastest of several runs, which is steadier on a busy
+ *     machine than the average. It also checks that every kernel's results
+ *     are the same, bit for bit, as the scalar kernel's, and exits with
+ *     status 1 if not.
+ *
+ *     Usage: kernelbench [pixels [runs]]
+ *     The defaults are 65536 pixels, whose planes fit in the cache, and 200
+ *     runs.
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+
+#include "transform.h"
+#include "colorspace.h"
+#include "dct.h"
+
+static const char *names[] = { "scalar", "sse2", "avx2" };
+#define NUM_KERNELS (sizeof(names) / sizeof(names[0]))
+
+/*
+ *      name: now
+ *   purpose: read the monotonic clock
+ *    inputs: none
+ *   outputs: the time in nanoseconds
+ *    errors: none
+ */
+static double now(void)
+{
+        struct timespec t;
+        clock_gettime(CLOCK_MONOTONIC, &t);
+        return t.tv_sec * 1e9 + t.tv_nsec;
+}
+
+/*
+ *      name: fill
+ *   purpose: fill a plane with pseudo-random values, the same every run
+ *    inputs: plane - the plane
+ *                n - the number of values
+ *              low, high - the range of the values
+ *            state - the state of the generator, updated
+ *   outputs: none
+ *    errors: none
+ */
+static void fill(float *plane, size_t n, float low, float high,
+                 uint32_t *state)
+{
+        for (size_t i = 0; i < n; i++) {
+                /* xorshift32 */
+                *state ^= *state << 13;
+                *state ^= *state >> 17;
+                *state ^= *state << 5;
+                plane[i] = low + (high - low) * (*state / 4294967296.0);
+        }
+}
+
+/*
+ *      name: bench_dct
+ *   purpose: benchmark and check each dct kernel the processor supports
+ *    inputs: vid - planes of Y, Pb and Pr values, n of each
+ *              n - the number of pixels, taken as two rows of n / 2
+ *           runs - how many times to time each kernel
+ *   outputs: true if every kernel agrees with the scalar kernel
+ *    errors: exits with EXIT_FAILURE if memory cannot be allocated
+ */
+static bool bench_dct(const float *vid, size_t n, int runs)
+{
+        size_t width = n / 2, blocks = n / 4;
+        struct Quant_pix *quant = malloc((2 * blocks + 1) *
+                                         sizeof(struct Quant_pix));
+        if (quant == NULL) {
+                fprintf(stderr, "kernelbench: out of memory\n");
+                exit(EXIT_FAILURE);
+        }
+        struct Quant_pix *expected = quant + blocks;
+
+        bool agree = true;
+        printf("\n%-8s %14s\n", "kernel", "dct");
+        for (size_t k = 0; k < NUM_KERNELS; k++) {
+                if (!dct_use(names[k])) {
+                        printf("%-8s %14s\n", names[k], "unsupported");
+                        continue;
+                }
+
+                double best = 0;
+                for (int run = 0; run < runs; run++) {
+                        double start = now();
+                        dct_quantize(vid, vid + n, vid + 2 * n, width, blocks,
+                                     quant);
+                        double end = now();
+
+                        if (run == 0 || end - start < best) {
+                                best = end - start;
+                        }
+                }
+                printf("%-8s %8.3f bl/ns\n", names[k], blocks / best);
+
+                /* the scalar kernel comes first and sets the standard */
+                if (k == 0) {
+                        memcpy(expected, quant,
+                               blocks * sizeof(struct Quant_pix));
+                } else if (memcmp(expected, quant,
+                                  blocks * sizeof(struct Quant_pix)) != 0) {
+                        printf("%-8s differs from scalar\n", names[k]);
+                        agree = false;
+                }
+        }
+
+        free(quant);
+        return agree;
+}
+
+/*
+ *      name: main
+ *   purpose: benchmark and check each kernel the processor supports
+ *    inputs: argc, argv - the number of pixels and of runs, both optional
+ *   outputs: EXIT_SUCCESS if every kernel agrees with the scalar kernel,
+ *            1 otherwise
+ *    errors: exits with EXIT_FAILURE on bad arguments or if memory cannot
+ *            be allocated
+ */
+int main(int argc, char *argv[])
+{
+        size_t n = argc > 1 ? strtoul(argv[1], NULL, 10) : 65536;
+        int runs = argc > 2 ? atoi(argv[2]) : 200;
+        if (argc > 3 || n == 0 || runs <= 0) {
+                fprintf(stderr, "Usage: %s [pixels [runs]]\n", argv[0]);
+                exit(EXIT_FAILURE);
+        }
+
+        /* inputs, outputs, and the scalar kernel's outputs to check by */
+        float *planes = malloc(18 * n * sizeof(float));
+        if (planes == NULL) {
+                fprintf(stderr, "%s: out of memory\n", argv[0]);
+                exit(EXIT_FAILURE);
+        }
+        float *rgb = planes, *vid = planes + 3 * n;
+        float *out_vid = planes + 6 * n, *out_rgb = planes + 9 * n;
+        float *expected = planes + 12 * n;
+
+        /* RGB in [0, 1]; Pb and Pr a little wider than they can be, so
+           that converting back has values to force into range, and so
+           that b, c and d are often out of range too */
+        uint32_t state = 2463534242u;
+        fill(rgb, 3 * n, 0, 1, &state);
+        fill(vid, n, 0, 1, &state);
+        fill(vid + n, 2 * n, -0.6, 0.6, &state);
+
+        int status = EXIT_SUCCESS;
+        printf("%-8s %14s %14s\n", "kernel", "to video", "to rgb");
+        for (size_t k = 0; k < NUM_KERNELS; k++) {
+                if (!colorspace_use(names[k])) {
+                        printf("%-8s %14s %14s\n", names[k], "unsupported",
+                               "unsupported");
+                        continue;
+                }
+
+                double best_vid = 0, best_rgb = 0;
+                for (int run = 0; run < runs; run++) {
+                        double start = now();
+                        colorspace_to_video(rgb, rgb + n, rgb + 2 * n,
+                                            out_vid, out_vid + n,
+                                            out_vid + 2 * n, n);
+                        double middle = now();
+                        colorspace_to_rgb(vid, vid + n, vid + 2 * n,
+                                          out_rgb, out_rgb + n,
+                                          out_rgb + 2 * n, n);
+                        double end = now();
+
+                        if (run == 0 || middle - start < best_vid) {
+                                best_vid = middle - start;
+                        }
+                        if (run == 0 || end - middle < best_rgb) {
+                                best_rgb = end - middle;
+                        }
+                }
+                printf("%-8s %8.3f px/ns %8.3f px/ns\n", names[k],
+                       n / best_vid, n / best_rgb);
+
+                /* the scalar kernel comes first and sets the standard */
+                if (k == 0) {
+                        memcpy(expected, out_vid, 6 * n * sizeof(float));
+                } else if (memcmp(expected, out_vid,
+                                  6 * n * sizeof(float)) != 0) {
+                        printf("%-8s differs from scalar\n", names[k]);
+                        status = 1;
+                }
+        }
+
+        if (!bench_dct(vid, n, runs)) {
+                status = 1;
+        }
+
+        free(planes);
+        return status;
+}
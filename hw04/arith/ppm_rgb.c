@@ -4,263 +4,376 @@
  *     arith
  *     10/26/22
  *
- *     This is the implementation for ppm_rgb, where 2D pixel arrays can be 
- *     transformed to/from a scaled integer representation and a floating point
- *     representation. Users can also trim the last row/column of an image or
- *     print a decompressed/regular PPM image to standard output.
+ *     This is the implementation for ppm_rgb, where pixels can be transformed
+ *     to/from a scaled integer representation and a floating point
+ *     representation, and PPM images can be read and written a few rows at
+ *     a time.
+ *
+ *     For streaming compression, a PPM image can be read one row at a
+ *     time. Only raw (P6) and plain (P3) PPM images can be read this way.
+ *     For streaming decompression, a raw PPM image can be written a few rows
+ *     at a time, in the same format as Pnm_ppmwrite. Rows of a raw image are
+ *     read and written as bytes, and unpacked or packed separately, so that
+ *     other threads can do that part while one thread does the I/O.
  */
 
 #include <stdlib.h>
 #include <stdio.h>
 #include <stdbool.h>
 #include <string.h>
+#include <ctype.h>
 
 #include "assert.h"
-#include "a2methods.h"
-#include "a2plain.h"
 #include "ppm_rgb.h"
 
-void apply_int(int col, int row, A2Methods_UArray2 array, void *elem, 
-                void *float_array);
-void apply_float(int col, int row, A2Methods_UArray2 array, void *elem, 
-                void *pnmppm);
 
 /* 
- *      name: ppmrgb_decompress
- *   purpose: convert the given UArray2 of pixels of type float back to 
- *            scaled ints in a Pnm_ppm. print the Pnm_ppm to stdout.
- *    inputs: transformed - the UArray2 of pixels of type float
+ *      name: pixel_to_float
+ *   purpose: convert one pixel from scaled integers to floating point
+ *    inputs:   pixel - the pixel in scaled integer representation
+ *              denom - the image's maximum pixel value
+ *            current - where to store the pixel in floating point
  *   outputs: none
- *    errors: raises a checked runtime error if the provided 2D array is NULL
+ *    errors: raises a checked runtime error if pixel or current is NULL
  */
-void ppmrgb_decompress(A2Methods_UArray2 transformed)
+void pixel_to_float(const struct Pnm_rgb *pixel, unsigned denom,
+                    struct Rgb_float *current)
 {
-        assert(transformed != NULL);
-
-        A2Methods_T methods = uarray2_methods_plain; /* get methods suite */
-        assert(methods != NULL);
-        
-        /* convert pixels from floating point to integer */
-        Pnm_ppm image = float_to_int(transformed);
-        
-        /* print the ppm to stdout */
-        print(image);
-        
-        /* free image */
-        Pnm_ppmfree(&image);
+        assert(pixel != NULL);
+        assert(current != NULL);
+
+        /* cast to float from unsigned and set RGB pixel values */
+        current->red = (float)pixel->red / denom;
+        current->green = (float)pixel->green / denom;
+        current->blue = (float)pixel->blue / denom;
 }
 
 /* 
- *      name: print
- *   purpose: print the given Pnm_ppm to standard output
- *    inputs: transformed - pointer to Pnm_ppm which contains a UArray2 with 
- *            pixels of type unsigned
+ *      name: pixels_to_planes
+ *   purpose: convert a run of pixels from scaled integers to floating point,
+ *            as pixel_to_float does, storing the red, green and blue values
+ *            in separate planes
+ *    inputs: pixels - the pixels
+ *                 n - the number of pixels
+ *             denom - the image's maximum pixel value
+ *            red, green, blue - where to store the pixels' values, room for
+ *                               n of each
  *   outputs: none
- *    errors: raises a CRE if provided Pnm_ppm is NULL
+ *    errors: raises a checked runtime error if any array is NULL
  */
-void print(Pnm_ppm transformed)
+void pixels_to_planes(const struct Pnm_rgb *pixels, unsigned n,
+                      unsigned denom, float *red, float *green, float *blue)
 {
-        assert(transformed != NULL);
+        assert(pixels != NULL);
+        assert(red != NULL && green != NULL && blue != NULL);
 
-        /* write ppm to standard output */
-        Pnm_ppmwrite(stdout, transformed);
+        for (unsigned i = 0; i < n; i++) {
+                struct Rgb_float pixel;
+                pixel_to_float(&pixels[i], denom, &pixel);
+                red[i] = pixel.red;
+                green[i] = pixel.green;
+                blue[i] = pixel.blue;
+        }
 }
 
 /* 
- *      name: ppmrgb_compress
- *   purpose: read ppm from given file, trim if needed so that the width and 
- *            height are even, convert from scaled ints to floating point
- *    inputs: fp - pointer to beginning of file to be compressed
- *   outputs: A uarray2 of pixels with type float
- *    errors: raises a checked runtime error if the methods suite is null
+ *      name: read_number
+ *   purpose: read an unsigned decimal number from a PPM image, skipping the
+ *            whitespace and comments before it
+ *    inputs: fp - the image
+ *   outputs: the number
+ *    errors: raises Pnm_Badformat if there is no number to read
  */
-A2Methods_UArray2 ppmrgb_compress(FILE *fp) 
+static unsigned read_number(FILE *fp)
 {
-        A2Methods_T methods = uarray2_methods_plain; /* get methods suite */
-        assert(methods != NULL);
+        int c = getc(fp);
 
-        Pnm_ppm pixmap = Pnm_ppmread(fp, methods); /* read in PPM image */
+        /* skip whitespace and comments, which run to the end of the line */
+        while (isspace(c) || c == '#') {
+                if (c == '#') {
+                        while (c != '\n' && c != EOF) {
+                                c = getc(fp);
+                        }
+                }
+                c = getc(fp);
+        }
+        if (!isdigit(c)) {
+                RAISE(Pnm_Badformat);
+        }
 
-        /* trim the image as needed */
-        pixmap = trim(pixmap); 
+        unsigned n = 0;
+        while (isdigit(c)) {
+                n = n * 10 + (c - '0');
+                c = getc(fp);
+        }
+        ungetc(c, fp);
+        return n;
+}
 
-        /* transform to floating point representation */
-        A2Methods_UArray2 float_arr = int_to_float(pixmap);
+/* 
+ *      name: ppmrgb_start
+ *   purpose: read the header of a PPM image, leaving fp at its first row
+ *    inputs: reader - the reader to set up
+ *                fp - pointer to the beginning of the image
+ *   outputs: none
+ *    errors: raises a checked runtime error if reader or fp is NULL; raises
+ *            Pnm_Badformat if the image is not a raw or plain PPM image
+ */
+void ppmrgb_start(struct Ppm_reader *reader, FILE *fp)
+{
+        assert(reader != NULL);
+        assert(fp != NULL);
+
+        /* "P6" for a raw image, "P3" for a plain one */
+        int kind = getc(fp) == 'P' ? getc(fp) : EOF;
+        if (kind != '6' && kind != '3') {
+                RAISE(Pnm_Badformat);
+        }
 
-        Pnm_ppmfree(&pixmap); /* free heap-allocated memory */
+        reader->fp = fp;
+        reader->plain = kind == '3';
+        reader->width = read_number(fp);
+        reader->height = read_number(fp);
+        reader->denominator = read_number(fp);
+        if (reader->denominator == 0 || reader->denominator > 65535) {
+                RAISE(Pnm_Badformat);
+        }
 
-        return float_arr;
+        /* a raw image's rows start after one whitespace character */
+        reader->raw = NULL;
+        if (!reader->plain) {
+                if (!isspace(getc(fp))) {
+                        RAISE(Pnm_Badformat);
+                }
+                reader->raw = malloc((size_t)reader->width * 6 + 1);
+                assert(reader->raw != NULL);
+        }
 }
 
 /* 
- *      name: trim
- *   purpose: trim last row or column of image if height or width is odd.
- *    inputs: image - pointer to Pnm_ppm which contains a UArray2 with pixels
- *            of type unsigned
- *   outputs: The trimmed image.
- *    errors: raises a checked runtime error if the image is NULL
+ *      name: ppmrgb_read_row
+ *   purpose: read the next row of a PPM image
+ *    inputs: reader - the reader, from ppmrgb_start
+ *               row - where to store the row's pixels, room for width of
+ *                     them
+ *   outputs: none
+ *    errors: raises a checked runtime error if reader or row is NULL;
+ *            raises Pnm_Badformat if the image ends early
  */
-Pnm_ppm trim(Pnm_ppm image)
+void ppmrgb_read_row(struct Ppm_reader *reader, struct Pnm_rgb *row)
 {
-        assert(image != NULL);
-        
-        /* if width is odd, trim the last column */
-        if ((image->width % 2) == 1) {
-                image->width = image->width - 1;
-        }
+        assert(reader != NULL);
+        assert(row != NULL);
 
-        /* if height is odd, trim the last row */
-        if ((image->height % 2) == 1) {
-                image->height = image->height - 1;
+        if (reader->plain) {
+                for (unsigned i = 0; i < reader->width; i++) {
+                        row[i].red = read_number(reader->fp);
+                        row[i].green = read_number(reader->fp);
+                        row[i].blue = read_number(reader->fp);
+                }
+                return;
         }
 
-        return image;
+        ppmrgb_read_raw(reader, reader->raw, 1);
+        ppmrgb_unpack_row(reader, reader->raw, row);
 }
 
 /* 
- *      name: int_to_float
- *   purpose: convert the given Pnm_ppm with UArray2 with pixels of type
- *            unsigned to a UArray2 with pixels of type float
- *    inputs: image - pointer to Pnm_ppm contained a UArray2 with pixels of
- *            type unsigned
- *   outputs: A 2D array with pixels of type float
- *    errors: raises a CRE if the provided Pnm_ppm is NULL
+ *      name: ppmrgb_raw_size
+ *   purpose: say how many bytes a row of a raw PPM image takes
+ *    inputs: reader - the reader, from ppmrgb_start, of a raw image
+ *   outputs: the size of a row: 3 bytes per pixel, or 6 if samples take two
+ *    errors: raises a checked runtime error if reader is NULL or the image
+ *            is plain
  */
-A2Methods_UArray2 int_to_float(Pnm_ppm image)
+size_t ppmrgb_raw_size(const struct Ppm_reader *reader)
 {
-        assert(image != NULL);
-        
-        /* get methods suite */
-        const A2Methods_T methods = (const A2Methods_T)image->methods;
-        assert(methods != NULL);
-        
-        /* make new 2D array to hold pixels in floating-point form */
-        A2Methods_UArray2 float_arr = methods->new(image->width, image->height,
-                                        sizeof(struct Rgb_float));
-        
-        /* transform each pixel from scaled int to floating point */
-        methods->map_col_major(float_arr, apply_float, image);
-
-        return float_arr;
+        assert(reader != NULL);
+        assert(!reader->plain);
+
+        return (size_t)reader->width * (reader->denominator < 256 ? 3 : 6);
 }
 
 /* 
- *      name: float_to_int
- *   purpose: given a 2D array in floating point representation, converts its
- *            elements to a scaled integer representation
- *    inputs: float_arr - the 2D array containing pixels in floating-point
- *            representation to be converted to scaled integer representation
- *   outputs: A Pnm_ppm image containing each of the pixels
- *    errors: raises a checked runtime error if the provided float_arr is NULL
- *            or if memory allocation fails for Pnm_ppm int_image
+ *      name: ppmrgb_read_raw
+ *   purpose: read the next rows of a raw PPM image without unpacking them,
+ *            so that they can be unpacked elsewhere (on another thread)
+ *    inputs: reader - the reader, from ppmrgb_start, of a raw image
+ *               raw - where to store the rows, room for rows times
+ *                     ppmrgb_raw_size bytes
+ *              rows - the number of rows to read
+ *   outputs: none
+ *    errors: raises a checked runtime error if reader or raw is NULL or the
+ *            image is plain; raises Pnm_Badformat if the image ends early
  */
-Pnm_ppm float_to_int(A2Methods_UArray2 float_arr)
+void ppmrgb_read_raw(struct Ppm_reader *reader, unsigned char *raw,
+                     unsigned rows)
 {
-        assert(float_arr != NULL);
-        
-        /* create the new Pnm_ppm to be outputted */
-        Pnm_ppm int_image = malloc(sizeof(struct Pnm_ppm));
-        assert(int_image != NULL);
-        
-        /* set the methods and max pixel value of the PPM image */
-        int_image->methods = uarray2_methods_plain;
-        int_image->denominator = 255;
-
-        /* set the height and width of the new PPM image */
-        int width = int_image->methods->width(float_arr);
-        int height = int_image->methods->height(float_arr);
-        int_image->width = width;
-        int_image->height = height;
-        
-        /* create a 2D array to hold pixels with integer values */
-        A2Methods_UArray2 int_arr = int_image->methods->new(width, height, 
-                                        sizeof(struct Pnm_rgb));
-        int_image->methods->map_col_major(int_arr, apply_int, float_arr);
-        
-        int_image->pixels = int_arr;
-        
-        return int_image;
+        assert(raw != NULL);
+
+        size_t size = ppmrgb_raw_size(reader);
+        if (fread(raw, size, rows, reader->fp) != rows) {
+                RAISE(Pnm_Badformat);
+        }
 }
 
 /* 
- *      name: apply_float
- *   purpose: apply function to convert each pixel to a floating-point
- *            representation
- *    inputs:   col - the column index of the current element (integer)
- *              row - the row index of the current element (integer)
- *            array - the new 2D array containing Rgb_float struct elements
- *                    where the RGB values are floats
- *             elem - a void pointer to the current Rgb_float element in the
- *                    2D array
- *           pnmppm - a void pointer to a Pnm_ppm instance containing the
- *                    current image data
+ *      name: ppmrgb_unpack_row
+ *   purpose: unpack a row of a raw PPM image read by ppmrgb_read_raw
+ *    inputs: reader - the reader, from ppmrgb_start, of a raw image
+ *               raw - the row, as read
+ *               row - where to store the row's pixels, room for width of
+ *                     them
  *   outputs: none
- *    errors: raises a checked runtime error if the closure argument or the
- *            current element are NULL
+ *    errors: raises a checked runtime error if any argument is NULL
  */
-void apply_float(int col, int row, A2Methods_UArray2 array, void *elem, 
-                void *pnmppm)
+void ppmrgb_unpack_row(const struct Ppm_reader *reader,
+                       const unsigned char *raw, struct Pnm_rgb *row)
 {
-        (void)array;
-        assert(pnmppm != NULL);
-        assert(elem != NULL);
-
-        /* get Pnm_ppm image and its corresponding 2D array from closure */
-        Pnm_ppm image = (Pnm_ppm) pnmppm;
-        A2Methods_UArray2 pixels = image->pixels;
-
-        /* get methods suite and max pixel value from image*/
-        const A2Methods_T methods = (const A2Methods_T)image->methods;
-        assert(methods != NULL);
-        unsigned denom = image->denominator;
-        
-        /* get current pixel in 2D array and current element */
-        Pnm_rgb curr = methods->at(pixels, col, row);
-        struct Rgb_float *current = (struct Rgb_float *) elem;
-        
-        /* cast to float from unsigned and set RGB pixel values */
-        current->red = (float)curr->red / denom;
-        current->green = (float)curr->green / denom;
-        current->blue = (float)curr->blue / denom;
+        assert(reader != NULL);
+        assert(raw != NULL && row != NULL);
+
+        unsigned width = reader->width;
+
+        /* samples are one byte, or two (most significant first) */
+        if (reader->denominator < 256) {
+                for (unsigned i = 0; i < width; i++, raw += 3) {
+                        row[i].red = raw[0];
+                        row[i].green = raw[1];
+                        row[i].blue = raw[2];
+                }
+        } else {
+                for (unsigned i = 0; i < width; i++, raw += 6) {
+                        row[i].red = raw[0] << 8 | raw[1];
+                        row[i].green = raw[2] << 8 | raw[3];
+                        row[i].blue = raw[4] << 8 | raw[5];
+                }
+        }
+}
+
+/* 
+ *      name: ppmrgb_finish
+ *   purpose: release what a reader allocated. The file is left open.
+ *    inputs: reader - the reader, from ppmrgb_start
+ *   outputs: none
+ *    errors: raises a checked runtime error if reader is NULL
+ */
+void ppmrgb_finish(struct Ppm_reader *reader)
+{
+        assert(reader != NULL);
+
+        free(reader->raw);
+        reader->raw = NULL;
 }
 
 /* 
- *      name: apply_int
- *   purpose: apply function to convert each pixel from a floating-point
- *            representation back to a scaled integer representation
- *    inputs:     col - the column index of the current element (integer)
- *                row - the row index of the current element (integer)
- *              array - the 2D array containing Pnm_rgb struct elements
- *                      where the RGB values are integers
- *               elem - a void pointer to the current Pnm_rgb element in the
- *                    2D array
- *        float_array - a void pointer to a A2Methods_UArray2 instance 
- *                   containing the current floating-point pixel representations
+ *      name: float_to_pixel
+ *   purpose: convert one pixel from floating point to scaled integers with
+ *            a denominator of 255
+ *    inputs:    curr - the pixel in floating point, each value in [0, 1]
+ *            current - where to store the pixel in scaled integers
  *   outputs: none
- *    errors: raises a checked runtime error if the closure argument or the
- *            current element are NULL
+ *    errors: raises a checked runtime error if curr or current is NULL
  */
-void apply_int(int col, int row, A2Methods_UArray2 array, void *elem, 
-                void *float_array)
+void float_to_pixel(const struct Rgb_float *curr, struct Pnm_rgb *current)
 {
-        (void)array;
-        assert(elem != NULL);
-        assert(float_array != NULL);
-        
-        /* get UArray2 of pixels of type float from closure */
-        A2Methods_UArray2 float_arr = (A2Methods_UArray2) float_array;
-
-        A2Methods_T methods = uarray2_methods_plain; /* get methods suite */
-        assert(methods != NULL);
-
-        /* set new denominator and get Rgb_float element at current index */
-        int denominator = 255;
-        struct Rgb_float *curr = methods->at(float_arr, col, row);
-        
-        struct Pnm_rgb *current = (struct Pnm_rgb *) elem;
+        assert(curr != NULL);
+        assert(current != NULL);
+
+        int denominator = 255; /* new denominator */
 
         /* cast to unsigned from float and set RGB pixel values */
         current->red = (unsigned)(curr->red * denominator);
         current->green = (unsigned)(curr->green * denominator);
         current->blue = (unsigned)(curr->blue * denominator);
-}
\ No newline at end of file
+}
+
+/* 
+ *      name: planes_to_pixels
+ *   purpose: convert a run of pixels whose red, green and blue values are in
+ *            separate planes from floating point to scaled integers with a
+ *            denominator of 255, as float_to_pixel does
+ *    inputs: red, green, blue - the pixels' values, in the range [0, 1]
+ *                           n - the number of pixels
+ *                      pixels - where to store the pixels, room for n
+ *   outputs: none
+ *    errors: raises a checked runtime error if any array is NULL
+ */
+void planes_to_pixels(const float *red, const float *green, const float *blue,
+                      unsigned n, struct Pnm_rgb *pixels)
+{
+        assert(red != NULL && green != NULL && blue != NULL);
+        assert(pixels != NULL);
+
+        for (unsigned i = 0; i < n; i++) {
+                struct Rgb_float pixel = { red[i], green[i], blue[i] };
+                float_to_pixel(&pixel, &pixels[i]);
+        }
+}
+
+/* 
+ *      name: ppmrgb_start_write
+ *   purpose: write the header of a raw PPM image whose pixels have a
+ *            denominator of 255
+ *    inputs: writer - the writer to set up
+ *                fp - the file to write to
+ *             width, height - the size of the image
+ *   outputs: none
+ *    errors: raises a checked runtime error if writer or fp is NULL, or if
+ *            the image is empty (as Pnm_ppmwrite does)
+ */
+void ppmrgb_start_write(struct Ppm_writer *writer, FILE *fp, unsigned width,
+                        unsigned height)
+{
+        assert(writer != NULL);
+        assert(fp != NULL);
+        assert(width > 0 && height > 0);
+
+        writer->fp = fp;
+        writer->width = width;
+
+        fprintf(fp, "P6\n%u %u\n%u\n", width, height, 255);
+}
+
+/* 
+ *      name: ppmrgb_pack_row
+ *   purpose: pack a row of pixels as a row of a raw PPM image, ready for
+ *            ppmrgb_write_raw; this can be done on another thread
+ *    inputs: writer - the writer, from ppmrgb_start_write
+ *               row - the row's pixels, width of them, each value at most
+ *                     255
+ *               raw - where to store the packed row, 3 bytes per pixel
+ *   outputs: none
+ *    errors: raises a checked runtime error if any argument is NULL
+ */
+void ppmrgb_pack_row(const struct Ppm_writer *writer,
+                     const struct Pnm_rgb *row, unsigned char *raw)
+{
+        assert(writer != NULL);
+        assert(row != NULL && raw != NULL);
+
+        for (unsigned i = 0; i < writer->width; i++, raw += 3) {
+                raw[0] = row[i].red;
+                raw[1] = row[i].green;
+                raw[2] = row[i].blue;
+        }
+}
+
+/* 
+ *      name: ppmrgb_write_raw
+ *   purpose: write the next rows of a raw PPM image, packed by
+ *            ppmrgb_pack_row
+ *    inputs: writer - the writer, from ppmrgb_start_write
+ *               raw - the rows, one after the other
+ *              rows - the number of rows
+ *   outputs: none
+ *    errors: raises a checked runtime error if writer or raw is NULL
+ */
+void ppmrgb_write_raw(struct Ppm_writer *writer, const unsigned char *raw,
+                      unsigned rows)
+{
+        assert(writer != NULL);
+        assert(raw != NULL);
+
+        fwrite(raw, (size_t)writer->width * 3, rows, writer->fp);
+}
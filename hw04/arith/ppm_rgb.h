@@ -4,10 +4,10 @@
  *     arith
  *     10/26/22
  *
- *     This is the interface for ppm_rgb, where 2D pixel arrays can be 
- *     transformed to/from a scaled integer representation and a floating point
- *     representation. Users can also trim the last row/column of an image or
- *     print a decompressed/regular PPM image to standard output.
+ *     This is the interface for ppm_rgb, where pixels can be transformed
+ *     to/from a scaled integer representation and a floating point
+ *     representation, and PPM images can be read and written a few rows at
+ *     a time.
  */
 #include <stdlib.h>
 #include <stdio.h>
@@ -15,8 +15,6 @@
 #include <string.h>
 
 #include "pnm.h"
-#include "uarray2.h"
-#include "a2methods.h"
 
 typedef struct Rgb_float *Rgb_float;
 
@@ -31,15 +29,56 @@ struct Rgb_float {
         float red, green, blue; /* RGB values of a pixel in float form */
 };
 
-/* DECOMPRESSION FUNCTIONS */
-void ppmrgb_decompress(A2Methods_UArray2 transformed);
-Pnm_ppm float_to_int(A2Methods_UArray2 float_arr);
-void print(Pnm_ppm transformed);
+/* 
+ * purpose: read a PPM image one row at a time, so that compression only
+ *          holds a couple of rows in memory
+ * members: fp - the file being read
+ *          width, height, denominator - from the image's header
+ *          plain - true for a plain (P3) image, whose samples are decimal
+ *                  text; false for a raw (P6) one
+ *          raw - a buffer for one row of a raw image
+ */
+struct Ppm_reader {
+        FILE *fp;
+        unsigned width, height, denominator;
+        bool plain;
+        unsigned char *raw;
+};
 
-/* COMPRESSION FUNCTIONS */
-A2Methods_UArray2 ppmrgb_compress(FILE *fp);
-Pnm_ppm trim(Pnm_ppm image);
-A2Methods_UArray2 int_to_float(Pnm_ppm image);
+/* 
+ * purpose: write a raw PPM image a few rows at a time, so that
+ *          decompression only holds a few rows in memory
+ * members: fp - the file being written
+ *          width - the number of pixels in a row
+ */
+struct Ppm_writer {
+        FILE *fp;
+        unsigned width;
+};
 
+/* DECOMPRESSION FUNCTIONS */
+void float_to_pixel(const struct Rgb_float *curr, struct Pnm_rgb *current);
+void planes_to_pixels(const float *red, const float *green, const float *blue,
+                      unsigned n, struct Pnm_rgb *pixels);
 
+/* COMPRESSION FUNCTIONS */
+void pixel_to_float(const struct Pnm_rgb *pixel, unsigned denom,
+                    struct Rgb_float *current);
+void pixels_to_planes(const struct Pnm_rgb *pixels, unsigned n,
+                      unsigned denom, float *red, float *green, float *blue);
 
+/* STREAMING FUNCTIONS */
+void ppmrgb_start(struct Ppm_reader *reader, FILE *fp);
+void ppmrgb_read_row(struct Ppm_reader *reader, struct Pnm_rgb *row);
+size_t ppmrgb_raw_size(const struct Ppm_reader *reader);
+void ppmrgb_read_raw(struct Ppm_reader *reader, unsigned char *raw,
+                     unsigned rows);
+void ppmrgb_unpack_row(const struct Ppm_reader *reader,
+                       const unsigned char *raw, struct Pnm_rgb *row);
+void ppmrgb_finish(struct Ppm_reader *reader);
+void ppmrgb_start_write(struct Ppm_writer *writer, FILE *fp, unsigned width,
+                        unsigned height);
+void ppmrgb_pack_row(const struct Ppm_writer *writer,
+                     const struct Pnm_rgb *row, unsigned char *raw);
+void ppmrgb_write_raw(struct Ppm_writer *writer, const unsigned char *raw,
+                      unsigned rows);
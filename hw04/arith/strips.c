@@ -0,0 +1,217 @@
+/*
+ *     strips.c
+ *     by Helena Lowe (hlowe01) & Olivia Byun (obyun01)
+ *     arith
+ *     10/26/22
+ *
+ *     This is the implementation for strips, which reads, transforms and
+ *     writes an image a strip at a time, transforming strips in parallel.
+ *
+ *     The caller provides a few slots, each with the buffers for one strip,
+ *     and three steps: read fills a slot with the next strip of input,
+ *     work transforms it in place, and write outputs it. Strip i always
+ *     goes in slot i % num_slots. The calling thread does all the reading
+ *     and writing, in strip order, since the input and output are streams;
+ *     the pool's threads do the work, taking strips in the order they were
+ *     read. Before reading strip i into a slot, the calling thread waits for
+ *     strip i - num_slots, which was in that slot, to be worked on and
+ *     writes it out. With two slots per thread, the reader can stay ahead of
+ *     the workers while the writer waits for the oldest strip.
+ *
+ *     With one thread nothing is started: each strip is read, worked on
+ *     and written in turn by the calling thread.
+ */
+
+#include <stdlib.h>
+#include <stdbool.h>
+#include <pthread.h>
+
+#include "assert.h"
+#include "mem.h"
+#include "strips.h"
+
+/*
+ * purpose: the state shared by the calling thread and the pool
+ * members: slots, num_slots - the slots, from the caller
+ *          work, cl - the step the pool does, and its closure
+ *          done - done[s] is true once the strip in slot s has been
+ *                 worked on and not yet written
+ *          read - the number of strips read so far
+ *          next - the next strip for the pool to work on
+ *          stop - true once every strip has been read, so that a thread
+ *                 that finds nothing to do can finish
+ *          lock - guards done, read, next and stop
+ *          readable - signalled when a strip has been read, or on stop
+ *          finished - signalled when a strip has been worked on
+ */
+struct Strips {
+        void **slots;
+        unsigned num_slots;
+        Strips_step work;
+        void *cl;
+        bool *done;
+        unsigned read, next;
+        bool stop;
+        pthread_mutex_t lock;
+        pthread_cond_t readable, finished;
+};
+
+/*
+ *      name: strips_slots
+ *   purpose: say how many slots strips_run should be given for a number of
+ *            threads
+ *    inputs: threads - the number of threads
+ *   outputs: 1 for one thread, otherwise 2 per thread
+ *    errors: raises a checked runtime error if threads is 0
+ */
+unsigned strips_slots(unsigned threads)
+{
+        assert(threads > 0);
+
+        return threads == 1 ? 1 : 2 * threads;
+}
+
+/*
+ *      name: work_loop
+ *   purpose: the loop each thread of the pool runs: work on the strips in
+ *            the order they are read, until every strip is done
+ *    inputs: strips - the shared state
+ *   outputs: NULL
+ *    errors: none
+ */
+static void *work_loop(void *strips)
+{
+        struct Strips *shared = strips;
+
+        pthread_mutex_lock(&shared->lock);
+        for (;;) {
+                while (shared->next == shared->read && !shared->stop) {
+                        pthread_cond_wait(&shared->readable, &shared->lock);
+                }
+                if (shared->next == shared->read) {
+                        break;
+                }
+                unsigned index = shared->next++;
+                unsigned slot = index % shared->num_slots;
+                pthread_mutex_unlock(&shared->lock);
+
+                shared->work(shared->slots[slot], index, shared->cl);
+
+                pthread_mutex_lock(&shared->lock);
+                shared->done[slot] = true;
+                pthread_cond_signal(&shared->finished);
+        }
+        pthread_mutex_unlock(&shared->lock);
+        return NULL;
+}
+
+/*
+ *      name: write_when_done
+ *   purpose: wait for a strip to be worked on, then write it out and free
+ *            its slot
+ *    inputs: shared - the shared state
+ *             index - the strip
+ *             write - the step that writes it
+ *   outputs: none
+ *    errors: none
+ */
+static void write_when_done(struct Strips *shared, unsigned index,
+                            Strips_step write)
+{
+        unsigned slot = index % shared->num_slots;
+
+        pthread_mutex_lock(&shared->lock);
+        while (!shared->done[slot]) {
+                pthread_cond_wait(&shared->finished, &shared->lock);
+        }
+        shared->done[slot] = false;
+        pthread_mutex_unlock(&shared->lock);
+
+        write(shared->slots[slot], index, shared->cl);
+}
+
+/*
+ *      name: strips_run
+ *   purpose: read, work on and write every strip of an image, working on
+ *            strips in parallel
+ *    inputs: count - the number of strips
+ *            threads - the number of threads to work on strips
+ *            slots, num_slots - the buffers for a strip each; num_slots
+ *                               should come from strips_slots
+ *            read - reads the next strip into a slot; called in order
+ *            work - transforms the strip in a slot; called on the pool,
+ *                   for different slots at the same time
+ *            write - writes out the strip in a slot; called in order
+ *            cl - passed to each step
+ *   outputs: none
+ *    errors: raises a checked runtime error if slots or a step is NULL,
+ *            there are no slots, or a thread cannot be started; raises
+ *            Mem_Failed if memory cannot be allocated. A step
+ *            that raises an exception ends the program, as nothing handles
+ *            exceptions across threads.
+ */
+void strips_run(unsigned count, unsigned threads, void **slots,
+                unsigned num_slots, Strips_step read, Strips_step work,
+                Strips_step write, void *cl)
+{
+        assert(slots != NULL && num_slots > 0);
+        assert(read != NULL && work != NULL && write != NULL);
+        assert(threads > 0);
+
+        if (threads == 1) {
+                for (unsigned i = 0; i < count; i++) {
+                        read(slots[0], i, cl);
+                        work(slots[0], i, cl);
+                        write(slots[0], i, cl);
+                }
+                return;
+        }
+
+        struct Strips shared = {
+                .slots = slots, .num_slots = num_slots, .work = work,
+                .cl = cl, .read = 0, .next = 0, .stop = false,
+        };
+        shared.done = CALLOC(num_slots, sizeof(bool));
+        pthread_t *pool = ALLOC((long)threads * sizeof(pthread_t));
+        pthread_mutex_init(&shared.lock, NULL);
+        pthread_cond_init(&shared.readable, NULL);
+        pthread_cond_init(&shared.finished, NULL);
+
+        for (unsigned t = 0; t < threads; t++) {
+                int status = pthread_create(&pool[t], NULL, work_loop,
+                                            &shared);
+                assert(status == 0);
+        }
+
+        for (unsigned i = 0; i < count; i++) {
+                /* the slot's last strip has to be written out first */
+                if (i >= num_slots) {
+                        write_when_done(&shared, i - num_slots, write);
+                }
+                read(slots[i % num_slots], i, cl);
+
+                pthread_mutex_lock(&shared.lock);
+                shared.read = i + 1;
+                pthread_cond_signal(&shared.readable);
+                pthread_mutex_unlock(&shared.lock);
+        }
+
+        pthread_mutex_lock(&shared.lock);
+        shared.stop = true;
+        pthread_cond_broadcast(&shared.readable);
+        pthread_mutex_unlock(&shared.lock);
+
+        for (unsigned i = count > num_slots ? count - num_slots : 0;
+             i < count; i++) {
+                write_when_done(&shared, i, write);
+        }
+        for (unsigned t = 0; t < threads; t++) {
+                pthread_join(pool[t], NULL);
+        }
+
+        pthread_cond_destroy(&shared.finished);
+        pthread_cond_destroy(&shared.readable);
+        pthread_mutex_destroy(&shared.lock);
+        FREE(pool);
+        FREE(shared.done);
+}
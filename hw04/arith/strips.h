@@ -0,0 +1,34 @@
+/*
+ *     strips.h
+ *     by Helena Lowe (hlowe01) & Olivia Byun (obyun01)
+ *     arith
+ *     10/26/22
+ *
+ *     This is the interface for strips, which runs compression or
+ *     decompression over an image in horizontal strips. Each strip is read
+ *     in order, transformed on a pool of threads, and written in order, so
+ *     the output is the same however many threads there are.
+ */
+
+#ifndef STRIPS_H_
+#define STRIPS_H_
+
+#include <stdlib.h>
+
+/* the number of rows of 2x2 blocks in a strip */
+#define STRIP_ROWS 8
+
+/*
+ * purpose: one step of handling a strip
+ * inputs: strip - the buffers of the slot the strip is in
+ *         index - which strip it is, counting from 0 at the top
+ *            cl - the closure passed to strips_run
+ */
+typedef void (*Strips_step)(void *strip, unsigned index, void *cl);
+
+unsigned strips_slots(unsigned threads);
+void strips_run(unsigned count, unsigned threads, void **slots,
+                unsigned num_slots, Strips_step read, Strips_step work,
+                Strips_step write, void *cl);
+
+#endif
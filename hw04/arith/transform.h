@@ -4,12 +4,12 @@
  *     arith
  *     10/26/22
  *
- *     This is the interface for transform where the client can see what can be 
- *     done: pixel arrays can be converted from rgb color space to video color
- *     space. They can also undergo discrete cosine transformations, and/or 
- *     become quantized. This can also happen in the reverse order, where
- *     a user can calculate chroma codes, inverse discrete cosine, transform
- *     to video color space, then to rgb color space.
+ *     This is the interface for transform where the client can see what can be
+ *     done: a pixel can be converted from rgb color space to video color
+ *     space, and a 2x2 block of them can undergo a discrete cosine
+ *     transformation and become quantized. This can also happen in the
+ *     reverse order, where a user can calculate chroma codes, inverse
+ *     discrete cosine, then transform to rgb color space.
  */
 
 #include <stdlib.h>
@@ -18,8 +18,6 @@
 #include <string.h>
 
 #include "pnm.h"
-#include "uarray2.h"
-#include "a2methods.h"
 #include "ppm_rgb.h"
 
 
@@ -63,27 +61,29 @@ struct Quant_pix {
         unsigned a, pb, pr;
 };
 
-/* main logic functions: compression and decompression */
-A2Methods_UArray2 transform_compress(A2Methods_UArray2 float_arr);
-A2Methods_UArray2 transform_decompress(A2Methods_UArray2 quant_arr);
-
 /* COMPRESSION FUNCTIONS: floating-point -> video color space */
-A2Methods_UArray2 float_to_video(A2Methods_UArray2 float_arr);
+void rgb_to_video(float r, float g, float b, struct Video_pix *pixel);
 
 /* DECOMPRESSION FUNCTIONS: video color space -> floating-point */
-A2Methods_UArray2 video_to_float(A2Methods_UArray2 video_arr);
+void video_to_rgb(const struct Video_pix *curr, struct Rgb_float *pixel);
 
 /* COMPRESSION FUNCTIONS: discrete cosine transformation */
-A2Methods_UArray2 video_to_discrete(A2Methods_UArray2 vid_arr);
+void block_to_discrete(const struct Video_pix *pix1,
+                       const struct Video_pix *pix2,
+                       const struct Video_pix *pix3,
+                       const struct Video_pix *pix4,
+                       struct Discrete_pix *curr);
 
 /* DECOMPRESSION FUNCTIONS: inverse discrete cosine transformation */
-A2Methods_UArray2 discrete_to_video(A2Methods_UArray2 discrete_arr);
+void discrete_to_block(struct Discrete_pix *curr, struct Video_pix *pix1,
+                       struct Video_pix *pix2, struct Video_pix *pix3,
+                       struct Video_pix *pix4);
 void add_pb_pr(struct Discrete_pix *curr, struct Video_pix *pix);
 void fix_color_range(struct Rgb_float *pixel);
 
 /* COMPRESSION FUNCTIONS: quantization */
-A2Methods_UArray2 discrete_to_quant(A2Methods_UArray2 discrete_arr);
 void fix_discrete_range(struct Discrete_pix *pixel);
+void quantize(struct Discrete_pix *pixel, struct Quant_pix *curr);
 
 /* DECOMPRESSION FUNCTIONS: calculating chroma codes */
-A2Methods_UArray2 quant_to_discrete(A2Methods_UArray2 quant_arr);
\ No newline at end of file
+void dequantize(const struct Quant_pix *pixel, struct Discrete_pix *curr);
@@ -0,0 +1,423 @@
+/* batch.c
+ * by Alyssa Williams (awilli36) and Olivia Byun (obyun01)
+ * 11/21/22
+ *
+ * This is the implementation for our batch module, which runs the programs
+ * listed in a manifest on a pool of threads.
+ *
+ * Every program gets a machine of its own: its own registers, segmented
+ * memory (with its own pool) and I/O device, so machines share nothing while
+ * they run. The programs are dealt round-robin onto one double-ended queue
+ * per thread before any thread starts. A thread takes work from the back of
+ * its own queue and, once that is empty, steals from the front of the
+ * others', so a thread that drew short programs helps with the long ones.
+ * No work is added once the threads start, so a thread that finds every
+ * queue empty is done.
+ *
+ * The report lists the programs in manifest order, one per line: the
+ * program, the instructions it executed, its wall time in seconds, and "ok"
+ * or why it could not be run. In the checked build a program stopped by a
+ * fault is reported as "fault", with the details on stderr.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <time.h>
+#include "batch.h"
+#include "fault.h"
+#include "loader.h"
+#include "memory.h"
+#include "perform_io.h"
+#include "profile.h"
+#include "assert.h"
+#include "mem.h"
+
+#define NO_JOB UINT_MAX /* returned by next_job when every queue is empty */
+
+/*
+ * purpose: one program of a batch
+ * members: program - the .um file
+ *            input - the file to read input from, or NULL for none
+ *           output - the file to write output to, or NULL to discard it
+ *            steps - instructions executed, once it has run
+ *          seconds - wall time taken, once it has run
+ *            error - why it could not be run or did not halt, or NULL
+ */
+struct Job {
+        char *program;
+        char *input;
+        char *output;
+        uint64_t steps;
+        double seconds;
+        const char *error;
+};
+
+/*
+ * purpose: one thread's queue of jobs; the jobs still to run are
+ *          jobs[head..tail)
+ * members: lock - held while taking a job
+ *          jobs - indices into the batch's jobs
+ *          head - the next job a thief takes
+ *          tail - one past the next job the owner takes
+ */
+struct Deque {
+        pthread_mutex_t lock;
+        unsigned *jobs;
+        unsigned head;
+        unsigned tail;
+};
+
+/*
+ * purpose: everything the threads of a batch share
+ * members:        jobs - the programs, in manifest order
+ *             num_jobs - number of jobs
+ *               deques - one queue per thread
+ *          num_threads - number of threads
+ *               engine - the execution engine to run each program with
+ *                 numa - true to place each machine's huge segments on the
+ *                        NUMA node of the thread running it
+ */
+struct Batch {
+        struct Job *jobs;
+        unsigned num_jobs;
+        struct Deque *deques;
+        unsigned num_threads;
+        Um_engine engine;
+        bool numa;
+};
+
+/*
+ * purpose: what a thread is given when it starts
+ * members: batch - the batch
+ *             id - the index of the thread's own queue
+ */
+struct Worker {
+        struct Batch *batch;
+        unsigned id;
+};
+
+/*
+ *      name: copy_string
+ *   purpose: copies a string into newly allocated memory
+ *    inputs: s - the string
+ *   outputs: the copy, to be freed with FREE
+ *    errors: CRE if the copy cannot be allocated
+ */
+static char *copy_string(const char *s)
+{
+        char *copy = ALLOC(strlen(s) + 1);
+        strcpy(copy, s);
+        return copy;
+}
+
+/*
+ *      name: read_manifest
+ *   purpose: reads the jobs listed in a manifest
+ *    inputs:     path - the manifest
+ *            num_jobs - set to the number of jobs
+ *   outputs: the jobs, to be freed with free_jobs
+ *    errors: CRE if the manifest cannot be read
+ */
+static struct Job *read_manifest(const char *path, unsigned *num_jobs)
+{
+        FILE *fp = fopen(path, "r");
+        assert(fp != NULL);
+
+        unsigned count = 0, capacity = 16;
+        struct Job *jobs = ALLOC(capacity * sizeof(struct Job));
+        char *line = NULL;
+        size_t line_size = 0;
+
+        while (getline(&line, &line_size, fp) != -1) {
+                char *save;
+                char *fields[3] = { NULL, NULL, NULL };
+                char *field = strtok_r(line, " \t\r\n", &save);
+                if (field == NULL || field[0] == '#') {
+                        continue;
+                }
+                for (int i = 0; i < 3 && field != NULL; i++) {
+                        fields[i] = field;
+                        field = strtok_r(NULL, " \t\r\n", &save);
+                }
+
+                if (count == capacity) {
+                        capacity *= 2;
+                        RESIZE(jobs, capacity * sizeof(struct Job));
+                }
+                struct Job *job = &jobs[count++];
+                memset(job, 0, sizeof(*job));
+                job->program = copy_string(fields[0]);
+                for (int i = 1; i < 3; i++) {
+                        char **file = i == 1 ? &job->input : &job->output;
+                        if (fields[i] != NULL && strcmp(fields[i], "-") != 0) {
+                                *file = copy_string(fields[i]);
+                        }
+                }
+        }
+
+        free(line); /* allocated by getline */
+        fclose(fp);
+        *num_jobs = count;
+        return jobs;
+}
+
+/*
+ *      name: free_jobs
+ *   purpose: frees the jobs read from a manifest
+ *    inputs:     jobs - the jobs
+ *            num_jobs - the number of jobs
+ *   outputs: none
+ *    errors: none
+ */
+static void free_jobs(struct Job *jobs, unsigned num_jobs)
+{
+        for (unsigned i = 0; i < num_jobs; i++) {
+                FREE(jobs[i].program);
+                FREE(jobs[i].input);
+                FREE(jobs[i].output);
+        }
+        FREE(jobs);
+}
+
+/*
+ *      name: seconds_since
+ *   purpose: measures wall time
+ *    inputs: start - when to measure from
+ *   outputs: the seconds since start
+ *    errors: none
+ */
+static double seconds_since(const struct timespec *start)
+{
+        struct timespec now;
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        return (now.tv_sec - start->tv_sec) +
+               (now.tv_nsec - start->tv_nsec) / 1e9;
+}
+
+/*
+ *      name: run_job
+ *   purpose: runs one program on a machine of its own, recording its
+ *            instruction count and wall time, or why it could not run or
+ *            did not halt
+ *    inputs:    job - the job
+ *            engine - the execution engine to use
+ *              numa - true to place huge segments on this thread's NUMA
+ *                     node
+ *   outputs: none
+ *    errors: CRE if the program is not a valid .um file or its output
+ *            cannot be written
+ */
+static void run_job(struct Job *job, Um_engine engine, bool numa)
+{
+        int in_fd = -1;
+        int out_fd = -1;
+
+        if (access(job->program, R_OK) != 0) {
+                job->error = "cannot-read-program";
+                return;
+        }
+        if (job->input != NULL &&
+            (in_fd = open(job->input, O_RDONLY)) < 0) {
+                job->error = "cannot-read-input";
+                return;
+        }
+        if (job->output != NULL) {
+                out_fd = open(job->output, O_WRONLY | O_CREAT | O_TRUNC,
+                              0666);
+        } else {
+                out_fd = open("/dev/null", O_WRONLY);
+        }
+        if (out_fd < 0) {
+                job->error = "cannot-write-output";
+                if (in_fd >= 0) {
+                        close(in_fd);
+                }
+                return;
+        }
+
+        struct timespec start;
+        clock_gettime(CLOCK_MONOTONIC, &start);
+
+        uint32_t registers[8] = { 0 };
+        struct Um_run run = { 0, 0, UINT64_MAX, false, 0, { FAULT_NONE },
+                              NULL };
+        Segments_T segments = read_program(job->program);
+        Pool_set_numa(segments->pool, numa);
+        Io_T io = Io_new(in_fd, out_fd);
+
+        PROFILE_START(segment_length(segments->table[0]));
+        engine(registers, segments, io, &run);
+        Io_free(&io);
+        PROFILE_REPORT(stderr, segments->table[0]);
+        Segments_free(&segments);
+
+        job->seconds = seconds_since(&start);
+        job->steps = run.steps;
+        if (run.fault.kind != FAULT_NONE) {
+                job->error = "fault";
+                Um_fault_report(stderr, job->program, &run.fault, registers);
+        }
+        if (in_fd >= 0) {
+                close(in_fd);
+        }
+        close(out_fd);
+}
+
+/*
+ *      name: take_job
+ *   purpose: takes a job from one end of a queue
+ *    inputs: deque - the queue
+ *             back - true to take the owner's end, false a thief's
+ *   outputs: the job's index, or NO_JOB if the queue is empty
+ *    errors: none
+ */
+static unsigned take_job(struct Deque *deque, bool back)
+{
+        unsigned job = NO_JOB;
+
+        pthread_mutex_lock(&deque->lock);
+        if (deque->head < deque->tail) {
+                job = back ? deque->jobs[--deque->tail]
+                           : deque->jobs[deque->head++];
+        }
+        pthread_mutex_unlock(&deque->lock);
+        return job;
+}
+
+/*
+ *      name: next_job
+ *   purpose: finds a thread its next job: its own most recent one, or else
+ *            the oldest job of the first other thread that has any left
+ *    inputs: batch - the batch
+ *               id - the thread's own queue
+ *   outputs: the job's index, or NO_JOB once every queue is empty
+ *    errors: none
+ */
+static unsigned next_job(struct Batch *batch, unsigned id)
+{
+        unsigned job = take_job(&batch->deques[id], true);
+
+        for (unsigned k = 1; job == NO_JOB && k < batch->num_threads; k++) {
+                unsigned victim = (id + k) % batch->num_threads;
+                job = take_job(&batch->deques[victim], false);
+        }
+        return job;
+}
+
+/*
+ *      name: work
+ *   purpose: the body of each thread: runs jobs until there are none left
+ *    inputs: arg - the thread's struct Worker
+ *   outputs: NULL
+ *    errors: none
+ */
+static void *work(void *arg)
+{
+        struct Worker *worker = arg;
+        struct Batch *batch = worker->batch;
+        unsigned job;
+
+        while ((job = next_job(batch, worker->id)) != NO_JOB) {
+                run_job(&batch->jobs[job], batch->engine, batch->numa);
+        }
+        return NULL;
+}
+
+/*
+ *      name: run_batch
+ *   purpose: runs every program listed in a manifest, several at a time,
+ *            and reports on each
+ *    inputs:    manifest - the manifest (see batch.h)
+ *            num_threads - the most programs to run at once, or 0 for one
+ *                          per online processor
+ *                 engine - the execution engine to run each program with
+ *                   numa - true to place each machine's huge segments on
+ *                          the NUMA node of the thread running it
+ *                 report - the stream to write the report to
+ *   outputs: EXIT_SUCCESS if every program could be run, EXIT_FAILURE if
+ *            any could not
+ *    errors: CRE if manifest, engine or report is NULL, the manifest cannot
+ *            be read, or a thread cannot be started
+ */
+int run_batch(const char *manifest, unsigned num_threads, Um_engine engine,
+              bool numa, FILE *report)
+{
+        assert(manifest != NULL);
+        assert(engine != NULL);
+        assert(report != NULL);
+
+        struct Batch batch;
+        batch.jobs = read_manifest(manifest, &batch.num_jobs);
+        batch.engine = engine;
+        batch.numa = numa;
+
+        if (num_threads == 0) {
+                long online = sysconf(_SC_NPROCESSORS_ONLN);
+                num_threads = online > 0 ? online : 1;
+        }
+#ifdef UM_PROFILE
+        num_threads = 1; /* the profile counters are shared */
+#endif
+        if (num_threads > batch.num_jobs) {
+                num_threads = batch.num_jobs > 0 ? batch.num_jobs : 1;
+        }
+        batch.num_threads = num_threads;
+
+        /* deal the jobs out, so job i lands on queue i % num_threads */
+        batch.deques = ALLOC(num_threads * sizeof(struct Deque));
+        for (unsigned t = 0; t < num_threads; t++) {
+                struct Deque *deque = &batch.deques[t];
+                pthread_mutex_init(&deque->lock, NULL);
+                deque->jobs = ALLOC((batch.num_jobs / num_threads + 1) *
+                                    sizeof(unsigned));
+                deque->head = deque->tail = 0;
+        }
+        for (unsigned i = 0; i < batch.num_jobs; i++) {
+                struct Deque *deque = &batch.deques[i % num_threads];
+                deque->jobs[deque->tail++] = i;
+        }
+
+        struct timespec start;
+        clock_gettime(CLOCK_MONOTONIC, &start);
+
+        pthread_t *threads = ALLOC(num_threads * sizeof(pthread_t));
+        struct Worker *workers = ALLOC(num_threads * sizeof(struct Worker));
+        for (unsigned t = 0; t < num_threads; t++) {
+                workers[t].batch = &batch;
+                workers[t].id = t;
+                int status = pthread_create(&threads[t], NULL, work,
+                                            &workers[t]);
+                assert(status == 0);
+        }
+        for (unsigned t = 0; t < num_threads; t++) {
+                pthread_join(threads[t], NULL);
+        }
+        double seconds = seconds_since(&start);
+
+        unsigned failed = 0;
+        fprintf(report, "# program instructions seconds status\n");
+        for (unsigned i = 0; i < batch.num_jobs; i++) {
+                const struct Job *job = &batch.jobs[i];
+                fprintf(report, "%s %llu %.6f %s\n", job->program,
+                        (unsigned long long)job->steps, job->seconds,
+                        job->error != NULL ? job->error : "ok");
+                failed += job->error != NULL;
+        }
+        fprintf(report, "# %u programs, %u failed, %.6f seconds on %u "
+                "threads\n", batch.num_jobs, failed, seconds, num_threads);
+
+        for (unsigned t = 0; t < num_threads; t++) {
+                pthread_mutex_destroy(&batch.deques[t].lock);
+                FREE(batch.deques[t].jobs);
+        }
+        FREE(batch.deques);
+        FREE(threads);
+        FREE(workers);
+        free_jobs(batch.jobs, batch.num_jobs);
+
+        return failed == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
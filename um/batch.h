@@ -0,0 +1,25 @@
+/* batch.h
+ * by Alyssa Williams (awilli36) and Olivia Byun (obyun01)
+ * 11/21/22
+ *
+ * This is the interface for our batch module, which runs many independent UM
+ * programs at once, one machine per thread, and reports how long each took
+ * and how many instructions it executed.
+ *
+ * A manifest lists one program per line: the .um file, then optionally the
+ * file its input comes from and the file its output goes to. "-" or a missing
+ * field means no input (the first input instruction sees end of input) or
+ * discarded output. Blank lines and lines starting with '#' are ignored.
+ */
+
+#ifndef BATCH_H
+#define BATCH_H
+
+#include <stdbool.h>
+#include <stdio.h>
+#include "dispatch.h"
+
+int run_batch(const char *manifest, unsigned num_threads, Um_engine engine,
+              bool numa, FILE *report);
+
+#endif
@@ -0,0 +1,25 @@
+# run_bench.sh
+# Alyssa Williams (awilli36) and Olivia Byun (obyun01)
+# 11/21/22
+# This file contains a bash script to run our benchmark suite. It writes the
+# input for the I/O benchmark, then runs umbench on the suite. Arguments are
+# passed to umbench, e.g. from the um directory:
+#
+#       bench/run_bench.sh ./um                 time one binary
+#       bench/run_bench.sh -n 5 ./um old/um     compare against a baseline
+#       bench/run_bench.sh -a -s ./um           time the loop engine
+
+dir=$(dirname $0)
+
+if [ ! -f $dir/bench-io.in ] ; then
+        yes "The quick brown fox jumps over the lazy dog." |
+                head -c 8000000 > $dir/bench-io.in
+fi
+
+args=""
+while [ $# -gt 1 ] && [ "${1#-}" != "$1" ] ; do
+        args="$args $1 $2"
+        shift 2
+done
+
+$dir/../umbench $args $dir/suite "$@"
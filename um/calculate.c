@@ -5,6 +5,10 @@
  * This is the implementation for our calculate module that handles UM
  * operations related to calculations such as conditional move, load value,
  * add, multiply, divide, and bitwise NAND.
+ *
+ * These are the checked, out-of-line versions used only by the debug build
+ * (make um-debug, which compiles with -DUM_DEBUG); every other build uses the
+ * inline versions in calculate.h.
  */
 
 #include <stdio.h>
@@ -20,12 +24,14 @@
  *                   rc - register c
  *            registers - the array containing the registers
  *   outputs: none
- *    errors: throws a CRE if registers is null
+ *    errors: throws a CRE if registers is null or a register index is out
+ *            of range
  */
 void conditional_move(unsigned ra, unsigned rb, unsigned rc, 
-                        uint64_t *registers)
+                        uint32_t *registers)
 {
         assert(registers != NULL);
+        assert(ra < 8 && rb < 8 && rc < 8);
         
         if (registers[rc]) {
                 registers[ra] = registers[rb];
@@ -39,30 +45,33 @@ void conditional_move(unsigned ra, unsigned rb, unsigned rc,
  *               value - the value to store in register a
  *           registers - the array containing the registers
  *   outputs: none
- *    errors: throws a CRE if registers is null
+ *    errors: throws a CRE if registers is null or a register index is out
+ *            of range
  */
-void load_value(unsigned ra, unsigned value, uint64_t *registers)
+void load_value(unsigned ra, unsigned value, uint32_t *registers)
 {
         assert(registers != NULL);
-        registers[ra] = value;        
+        assert(ra < 8);
+        registers[ra] = value;
 }
 
 /* 
  *      name: add
  *   purpose: adds the values in register b and c together and stores the sum 
- *            in register a. The sum is modded by 2^32 
- *            in register a
+ *            in register a. The sum is modded by 2^32
  *    inputs:       ra - register a
  *                  rb - register b
  *                  rc - register c
  *           registers - the array containing the registers
  *   outputs: none
- *    errors: throws a CRE if registers is null
+ *    errors: throws a CRE if registers is null or a register index is out
+ *            of range
  */
-void add(unsigned ra, unsigned rb, unsigned rc, uint64_t *registers)
+void add(unsigned ra, unsigned rb, unsigned rc, uint32_t *registers)
 {
         assert(registers != NULL);
-        registers[ra] = (registers[rb] + registers[rc]) % ((uint64_t)2 << 32);
+        assert(ra < 8 && rb < 8 && rc < 8);
+        registers[ra] = registers[rb] + registers[rc];
 }
 
 /* 
@@ -74,12 +83,14 @@ void add(unsigned ra, unsigned rb, unsigned rc, uint64_t *registers)
  *                  rc - register c
  *           registers - the array containing the registers 
  *   outputs: none
- *    errors: throws a CRE if registers is null
+ *    errors: throws a CRE if registers is null or a register index is out
+ *            of range
  */
-void multiply(unsigned ra, unsigned rb, unsigned rc, uint64_t *registers)
+void multiply(unsigned ra, unsigned rb, unsigned rc, uint32_t *registers)
 {
         assert(registers != NULL);
-        registers[ra] = (registers[rb] * registers[rc]) % ((uint64_t)2 << 32);
+        assert(ra < 8 && rb < 8 && rc < 8);
+        registers[ra] = registers[rb] * registers[rc];
 }
 
 /* 
@@ -91,12 +102,14 @@ void multiply(unsigned ra, unsigned rb, unsigned rc, uint64_t *registers)
  *                  rc - register c
  *           registers - the array containing the registers
  *   outputs: none
- *    errors: throws a CRE if registers is null
- *            URE for division by zero
+ *    errors: throws a CRE if registers is null, a register index is out of
+ *            range, or the value in register c is 0
  */
-void divide(unsigned ra, unsigned rb, unsigned rc, uint64_t *registers)
+void divide(unsigned ra, unsigned rb, unsigned rc, uint32_t *registers)
 {
         assert(registers != NULL);
+        assert(ra < 8 && rb < 8 && rc < 8);
+        assert(registers[rc] != 0);
         registers[ra] = registers[rb] / registers[rc];
 }
 
@@ -109,10 +122,12 @@ void divide(unsigned ra, unsigned rb, unsigned rc, uint64_t *registers)
  *                  rc - register c
  *           registers - the array containing the registers
  *   outputs: none
- *    errors: throws a CRE if registers is null
+ *    errors: throws a CRE if registers is null or a register index is out
+ *            of range
  */
-void bitwise_NAND(unsigned ra, unsigned rb, unsigned rc, uint64_t *registers)
+void bitwise_NAND(unsigned ra, unsigned rb, unsigned rc, uint32_t *registers)
 {
         assert(registers != NULL);
+        assert(ra < 8 && rb < 8 && rc < 8);
         registers[ra] = ~(registers[rb] & registers[rc]);
-}
\ No newline at end of file
+}
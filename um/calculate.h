@@ -1,10 +1,16 @@
 /* calculate.h
  * by Alyssa Williams (awilli36) and Olivia Byun (obyun01)
  * 11/21/22
- * 
- * This is the interface for our calculate module that handles UM operations 
+ *
+ * This is the interface for our calculate module that handles UM operations
  * related to calculations such as conditional move, load value, add, multiply,
  * divide, and bitwise NAND.
+ *
+ * Registers are 32-bit words, so add and multiply wrap modulo 2^32 on their
+ * own. The operations are defined here, inline, so the engines execute them
+ * without a call. The debug build (make um-debug, which compiles with
+ * -DUM_DEBUG) uses the out-of-line versions in calculate.c instead, which
+ * check their arguments.
  */
 
 #ifndef CALCULATE_H
@@ -12,12 +18,120 @@
 
 #include <stdint.h>
 
-void conditional_move(unsigned ra, unsigned rb, unsigned rc, 
-                        uint64_t *registers);
-void load_value(unsigned ra, unsigned value, uint64_t *registers);
-void add(unsigned ra, unsigned rb, unsigned rc, uint64_t *registers);
-void multiply(unsigned ra, unsigned rb, unsigned rc, uint64_t *registers);
-void divide(unsigned ra, unsigned rb, unsigned rc, uint64_t *registers);
-void bitwise_NAND(unsigned ra, unsigned rb, unsigned rc, uint64_t *registers);
+#ifdef UM_DEBUG
 
-#endif
\ No newline at end of file
+void conditional_move(unsigned ra, unsigned rb, unsigned rc,
+                        uint32_t *registers);
+void load_value(unsigned ra, unsigned value, uint32_t *registers);
+void add(unsigned ra, unsigned rb, unsigned rc, uint32_t *registers);
+void multiply(unsigned ra, unsigned rb, unsigned rc, uint32_t *registers);
+void divide(unsigned ra, unsigned rb, unsigned rc, uint32_t *registers);
+void bitwise_NAND(unsigned ra, unsigned rb, unsigned rc, uint32_t *registers);
+
+#else
+
+/*
+ *      name: conditional_move
+ *   purpose: if the value in register c does not equal 0, then the value in
+ *            register b is stored in register a
+ *    inputs:        ra - register a
+ *                   rb - register b
+ *                   rc - register c
+ *            registers - the array containing the registers
+ *   outputs: none
+ *    errors: none
+ */
+static inline void conditional_move(unsigned ra, unsigned rb, unsigned rc,
+                                    uint32_t *registers)
+{
+        if (registers[rc]) {
+                registers[ra] = registers[rb];
+        }
+}
+
+/*
+ *      name: load_value
+ *   purpose: the given value is stored in the given register a
+ *    inputs:       ra - register a
+ *               value - the value to store in register a
+ *           registers - the array containing the registers
+ *   outputs: none
+ *    errors: none
+ */
+static inline void load_value(unsigned ra, unsigned value,
+                              uint32_t *registers)
+{
+        registers[ra] = value;
+}
+
+/*
+ *      name: add
+ *   purpose: stores the sum of the values in registers b and c, modulo 2^32,
+ *            in register a
+ *    inputs:       ra - register a
+ *                  rb - register b
+ *                  rc - register c
+ *           registers - the array containing the registers
+ *   outputs: none
+ *    errors: none
+ */
+static inline void add(unsigned ra, unsigned rb, unsigned rc,
+                       uint32_t *registers)
+{
+        registers[ra] = registers[rb] + registers[rc];
+}
+
+/*
+ *      name: multiply
+ *   purpose: stores the product of the values in registers b and c, modulo
+ *            2^32, in register a
+ *    inputs:       ra - register a
+ *                  rb - register b
+ *                  rc - register c
+ *           registers - the array containing the registers
+ *   outputs: none
+ *    errors: none
+ */
+static inline void multiply(unsigned ra, unsigned rb, unsigned rc,
+                            uint32_t *registers)
+{
+        registers[ra] = registers[rb] * registers[rc];
+}
+
+/*
+ *      name: divide
+ *   purpose: divides the value in register b by the value in register c and
+ *            stores the quotient in register a
+ *    inputs:       ra - register a
+ *                  rb - register b
+ *                  rc - register c
+ *           registers - the array containing the registers
+ *   outputs: none
+ *    errors: URE for division by zero
+ */
+static inline void divide(unsigned ra, unsigned rb, unsigned rc,
+                          uint32_t *registers)
+{
+        registers[ra] = registers[rb] / registers[rc];
+}
+
+/*
+ *      name: bitwise_NAND
+ *   purpose: performs the bitwise operation nand on the values in register b
+ *            and c and stores the result in register a
+ *    inputs:       ra - register a
+ *                  rb - register b
+ *                  rc - register c
+ *           registers - the array containing the registers
+ *   outputs: none
+ *    errors: none
+ */
+static inline void bitwise_NAND(unsigned ra, unsigned rb, unsigned rc,
+                                uint32_t *registers)
+{
+        registers[ra] = ~(registers[rb] & registers[rc]);
+}
+
+#endif
+
+#endif
@@ -0,0 +1,830 @@
+/* dispatch.c
+ * by Alyssa Williams (awilli36) and Olivia Byun (obyun01)
+ * 11/21/22
+ *
+ * This is the implementation for our dispatch module, which runs the
+ * fetch/execute loop of the UM.
+ *
+ * The threaded engine decodes segment 0 into an array of instruction
+ * records, each holding the address of its handler inside dispatch_threaded
+ * (GCC's computed goto). Executing an instruction is then a single indirect
+ * jump with the register indices already unpacked.
+ *
+ * The records form a code cache that is decoded lazily, a page of 1024 words
+ * at a time. Every record of a dirty page runs a handler that decodes the
+ * page and then executes the record, so pages that never run are never
+ * decoded and the handlers themselves check nothing. The cache keeps a copy
+ * of the words each clean page was decoded from. A load program that
+ * replaces segment 0 compares the new words with them page by page and only
+ * dirties the pages that differ, so switching between copies of the same
+ * code decodes nothing. A segmented store into a clean page re-decodes just
+ * the word it changed. The cache lives in struct Um_run while the run is
+ * paused, so resuming does not decode segment 0 again either.
+ *
+ * Predecoding also fuses pairs of instructions that compiled UM code runs
+ * back to back (a load value feeding a segmented load or store, a store or
+ * load followed by a load value, two load values, two NANDs, two conditional
+ * moves; chosen by profiling midmark, sandmark and advent). The first record
+ * of such a pair gets a handler that executes both instructions and skips
+ * the second record, which keeps its own handler for jumps that land on it.
+ * A segmented store into segment 0 re-decodes the word it wrote and re-fuses
+ * it and the word before it. Pairs that straddle two pages are fused once
+ * both pages are clean.
+ *
+ * The loop engine is the original interpreter, which fetches segment 0 from
+ * segmented memory and unpacks every word as it executes it.
+ *
+ * Both engines copy the registers into a local array while they run, so the
+ * compiler knows no segmented store can change them, and write them back
+ * when the machine pauses or stops.
+ *
+ * Both engines start at run->pc and can pause at a load program (see
+ * struct Um_run). Load program is the only instruction that transfers
+ * control, so the threaded engine counts instructions by measuring how far it
+ * got between one load program and the next instead of counting each one.
+ */
+
+#include <stdio.h>
+#include <stdbool.h>
+#include <string.h>
+#include "dispatch.h"
+#include "calculate.h"
+#include "memory.h"
+#include "perform_io.h"
+#include "profile.h"
+#include "assert.h"
+#include "bitpack.h"
+#include "mem.h"
+
+volatile sig_atomic_t pause_requested = 0;
+
+/* one handler per 4-bit opcode; 14 and 15 are not valid instructions */
+#define NUM_HANDLERS 16
+
+/* words of segment 0 decoded together (4KB of words) */
+#define CODE_PAGE 1024
+
+/* keeps the code cache's upkeep out of dispatch_threaded: inlined, it
+   costs the handlers the registers that hold ip and the counters */
+#define COLD __attribute__((noinline))
+
+/*
+ * purpose: a predecoded UM instruction
+ * members: handler - address of the code that executes this instruction
+ *            value - the value to load for a load value instruction
+ *               op - the opcode
+ *       ra, rb, rc - register indices (ra is the load value register for LV)
+ */
+struct Instruction {
+        const void *handler;
+        uint32_t value;
+        uint8_t op;
+        uint8_t ra, rb, rc;
+};
+
+/*
+ * purpose: the handler addresses of the threaded engine
+ * members: single - the handler for each opcode
+ *           pairs - the handler that executes an instruction with one
+ *                   opcode followed by one with another, or NULL if that
+ *                   pair is not fused
+ *          decode - the handler of every record in a dirty page, which
+ *                   decodes the page and executes the record
+ */
+struct Handlers {
+        const void *single[NUM_HANDLERS];
+        const void *pairs[NUM_HANDLERS][NUM_HANDLERS];
+        const void *decode;
+};
+
+/*
+ * purpose: the threaded engine's code cache: segment 0 decoded into
+ *          instruction records, a page at a time
+ * members: program - a record per word of segment 0, plus the sentinel
+ *                    record past the end, which stops the machine
+ *            words - the words each clean page was decoded from
+ *            clean - per page: true if its records are decoded from the
+ *                    words segment 0 holds, false (dirty) if they all run
+ *                    the decode handler
+ *           length - the number of words in segment 0
+ */
+struct Code_cache {
+        struct Instruction *program;
+        uint32_t *words;
+        bool *clean;
+        unsigned length;
+};
+
+/*
+ *      name: decode_word
+ *   purpose: unpacks a single UM word into an instruction record
+ *    inputs:    instr - the record to fill in
+ *                word - the UM instruction word
+ *            handlers - the handler addresses
+ *   outputs: none
+ *    errors: none
+ */
+static inline void decode_word(struct Instruction *instr, uint64_t word,
+                               const struct Handlers *handlers)
+{
+        unsigned op = word >> 28;
+
+        instr->handler = handlers->single[op];
+        instr->op = op;
+        if (op == LV) {
+                instr->ra = (word >> 25) & 0x7;
+                instr->rb = 0;
+                instr->rc = 0;
+                instr->value = word & 0x1ffffff;
+        } else {
+                instr->ra = (word >> 6) & 0x7;
+                instr->rb = (word >> 3) & 0x7;
+                instr->rc = word & 0x7;
+                instr->value = 0;
+        }
+}
+
+/*
+ *      name: fuse
+ *   purpose: gives a record the handler for it and the record after it if
+ *            the pair is fused, or its own handler otherwise
+ *    inputs:  program - the instruction records
+ *                   i - the record to choose a handler for
+ *              length - the number of words in segment 0
+ *            handlers - the handler addresses
+ *   outputs: none
+ *    errors: none
+ */
+static inline void fuse(struct Instruction *program, unsigned i,
+                        unsigned length, const struct Handlers *handlers)
+{
+        const void *pair = NULL;
+
+        if (i + 1 < length) {
+                pair = handlers->pairs[program[i].op][program[i + 1].op];
+        }
+        program[i].handler = pair != NULL ? pair
+                                          : handlers->single[program[i].op];
+}
+
+/*
+ *      name: page_clean
+ *   purpose: tells whether the record for a word of segment 0 is decoded
+ *    inputs: code - the code cache
+ *               i - the offset of the word
+ *   outputs: true if the page holding it is clean
+ *    errors: none
+ */
+static inline bool page_clean(const struct Code_cache *code,
+                              unsigned i)
+{
+        return code->clean[i / CODE_PAGE];
+}
+
+/*
+ *      name: decode_page
+ *   purpose: decodes a dirty page of segment 0 into its records, fuses the
+ *            pairs it can (including across its edges into clean pages) and
+ *            marks it clean
+ *    inputs:     code - the code cache
+ *                page - the page to decode
+ *                seg0 - segment 0
+ *            handlers - the handler addresses
+ *   outputs: none
+ *    errors: none
+ */
+COLD
+static void decode_page(struct Code_cache *code, unsigned page,
+                        const uint32_t *seg0, const struct Handlers *handlers)
+{
+        unsigned first = page * CODE_PAGE;
+        unsigned end = first + CODE_PAGE < code->length ? first + CODE_PAGE
+                                                        : code->length;
+        struct Instruction *program = code->program;
+
+        for (unsigned i = first; i < end; i++) {
+                decode_word(&program[i], seg0[i], handlers);
+        }
+        memcpy(code->words + first, seg0 + first,
+               (size_t)(end - first) * sizeof(uint32_t));
+        code->clean[page] = true;
+        PROFILE_DECODE(end - first);
+
+        for (unsigned i = first; i + 1 < end; i++) {
+                fuse(program, i, code->length, handlers);
+        }
+        if (end < code->length && page_clean(code, end)) {
+                fuse(program, end - 1, code->length, handlers);
+        }
+        if (first > 0 && page_clean(code, first - 1)) {
+                fuse(program, first - 1, code->length, handlers);
+        }
+}
+
+/*
+ *      name: make_dirty
+ *   purpose: marks a page of segment 0 dirty, pointing its records at the
+ *            handler that decodes it, and splits the pair the record before
+ *            it may have made with its first record
+ *    inputs:     code - the code cache
+ *                page - the page
+ *            handlers - the handler addresses
+ *   outputs: none
+ *    errors: none
+ */
+COLD
+static void make_dirty(struct Code_cache *code, unsigned page,
+                       const struct Handlers *handlers)
+{
+        unsigned first = page * CODE_PAGE;
+        unsigned end = first + CODE_PAGE < code->length ? first + CODE_PAGE
+                                                        : code->length;
+        struct Instruction *program = code->program;
+
+        for (unsigned i = first; i < end; i++) {
+                program[i].handler = handlers->decode;
+        }
+        code->clean[page] = false;
+        if (first > 0 && page_clean(code, first - 1)) {
+                program[first - 1].handler =
+                        handlers->single[program[first - 1].op];
+        }
+}
+
+/*
+ *      name: sync_code
+ *   purpose: brings the code cache up to date with segment 0 after a load
+ *            program replaced it, or when an engine starts: each clean page
+ *            whose words changed is made dirty. If the length changed, every
+ *            page is. No word is decoded here; dirty pages are decoded when
+ *            the machine first executes an instruction in them.
+ *    inputs:     code - the code cache
+ *                seg0 - segment 0
+ *            handlers - the handler addresses
+ *   outputs: none
+ *    errors: none
+ */
+COLD
+static void sync_code(struct Code_cache *code, const uint32_t *seg0,
+                      const struct Handlers *handlers)
+{
+        unsigned length = segment_length(seg0);
+        unsigned num_pages = (length + CODE_PAGE - 1) / CODE_PAGE;
+
+        if (length != code->length || code->program == NULL) {
+                FREE(code->program);
+                FREE(code->words);
+                FREE(code->clean);
+                code->program = ALLOC(((long)length + 1) *
+                                      sizeof(struct Instruction));
+                code->words = ALLOC(((long)length + 1) * sizeof(uint32_t));
+                code->clean = ALLOC((long)num_pages + 1);
+                code->length = length;
+                for (unsigned i = 0; i < length; i++) {
+                        code->program[i].handler = handlers->decode;
+                        code->program[i].op = 0;
+                }
+                memset(code->clean, false, num_pages);
+                /* falling off the end of segment 0 stops the machine */
+                decode_word(&code->program[length], (uint64_t)15 << 28,
+                            handlers);
+                return;
+        }
+
+        for (unsigned page = 0; page < num_pages; page++) {
+                unsigned first = page * CODE_PAGE;
+                unsigned size = length - first < CODE_PAGE ? length - first
+                                                           : CODE_PAGE;
+                if (code->clean[page] &&
+                    memcmp(code->words + first, seg0 + first,
+                           (size_t)size * sizeof(uint32_t)) != 0) {
+                        make_dirty(code, page, handlers);
+                }
+        }
+}
+
+/*
+ *      name: Code_cache_free
+ *   purpose: frees a code cache
+ *    inputs: code - pointer to the cache, set to NULL; may point to NULL
+ *   outputs: none
+ *    errors: none
+ */
+static void Code_cache_free(struct Code_cache **code)
+{
+        if (*code == NULL) {
+                return;
+        }
+        FREE((*code)->program);
+        FREE((*code)->words);
+        FREE((*code)->clean);
+        FREE(*code);
+}
+
+/*
+ *      name: rewrite_word
+ *   purpose: brings the code cache up to date after a segmented store into
+ *            segment 0. A word in a dirty page needs nothing: it is decoded
+ *            with the page. A changed word in a clean page is decoded now and
+ *            re-fused with its neighbours, which is cheaper than re-decoding
+ *            the page.
+ *    inputs:     code - the code cache
+ *              offset - the offset that was written
+ *                word - the word written there
+ *            handlers - the handler addresses
+ *   outputs: none
+ *    errors: none
+ */
+COLD
+static void rewrite_word(struct Code_cache *code, uint32_t offset,
+                         uint32_t word, const struct Handlers *handlers)
+{
+        if (offset >= code->length || !page_clean(code, offset) ||
+            code->words[offset] == word) {
+                return; /* out of bounds (unchecked), decoded later, or
+                           the word did not change */
+        }
+
+        struct Instruction *program = code->program;
+        code->words[offset] = word;
+        decode_word(&program[offset], word, handlers);
+        PROFILE_DECODE(1);
+        if (offset + 1 == code->length || page_clean(code, offset + 1)) {
+                fuse(program, offset, code->length, handlers);
+        }
+        if (offset > 0 && page_clean(code, offset - 1)) {
+                fuse(program, offset - 1, code->length, handlers);
+        }
+}
+
+/*
+ *      name: find_fault
+ *   purpose: tells whether an instruction would fault if it executed now.
+ *            Only the checked build calls it (see fault.h). A load program
+ *            whose target is past the end of the new segment 0 is checked
+ *            once the program is loaded.
+ *    inputs:         op - the instruction's opcode
+ *            ra, rb, rc - its register indices
+ *             registers - the registers
+ *              segments - the segmented memory
+ *                 fault - where to record the kind, segment and value
+ *   outputs: true if the instruction would fault, false otherwise
+ *    errors: none
+ */
+static inline bool find_fault(unsigned op, unsigned ra, unsigned rb,
+                              unsigned rc, const uint32_t *registers,
+                              Segments_T segments, struct Um_fault *fault)
+{
+        uint32_t seg_id = 0, offset = 0;
+
+        switch (op) {
+        case SLOAD:
+                seg_id = registers[rb];
+                offset = registers[rc];
+                break;
+        case SSTORE:
+                seg_id = registers[ra];
+                offset = registers[rb];
+                break;
+        case DIV:
+                fault->kind = registers[rc] == 0 ? FAULT_DIVIDE : FAULT_NONE;
+                return fault->kind != FAULT_NONE;
+        case INACTIVATE:
+                seg_id = registers[rc];
+                fault->seg_id = seg_id;
+                fault->kind = seg_id == 0 ? FAULT_UNMAP_ZERO
+                            : !segment_mapped(seg_id, segments)
+                                    ? FAULT_UNMAPPED : FAULT_NONE;
+                return fault->kind != FAULT_NONE;
+        case OUT:
+                fault->value = registers[rc];
+                fault->kind = registers[rc] > 255 ? FAULT_OUTPUT : FAULT_NONE;
+                return fault->kind != FAULT_NONE;
+        case LOADP:
+                fault->seg_id = registers[rb];
+                fault->kind = segment_mapped(registers[rb], segments)
+                                    ? FAULT_NONE : FAULT_UNMAPPED;
+                return fault->kind != FAULT_NONE;
+        case HALT: case CMOV: case ADD: case MUL: case NAND: case ACTIVATE:
+        case IN: case LV:
+                return false;
+        default:
+                fault->kind = FAULT_OPCODE;
+                return true;
+        }
+
+        /* a segmented load or store */
+        fault->seg_id = seg_id;
+        fault->value = offset;
+        if (!segment_mapped(seg_id, segments)) {
+                fault->kind = FAULT_UNMAPPED;
+        } else if (!segment_in_bounds(seg_id, offset, segments)) {
+                fault->kind = FAULT_BOUNDS;
+        } else {
+                fault->kind = FAULT_NONE;
+        }
+        return fault->kind != FAULT_NONE;
+}
+
+/*
+ *      name: dispatch_threaded
+ *   purpose: executes the program in segment 0 using the threaded engine
+ *    inputs: register_file - the eight registers, brought up to date when
+ *                            the machine pauses or stops
+ *                 segments - the segmented memory; segment 0 holds the
+ *                            program
+ *                       io - the I/O device
+ *                      run - where to start and when to pause; updated
+ *                            when the machine pauses or stops
+ *   outputs: none
+ *    errors: CRE if any argument is NULL
+ *            the machine halts if it reaches an invalid instruction, runs off
+ *            the end of segment 0, or is loaded at an offset past the end;
+ *            in the checked build these and the other faults set run->fault
+ *            instead
+ */
+void dispatch_threaded(uint32_t *register_file, Segments_T segments,
+                       Io_T io, struct Um_run *run)
+{
+        assert(register_file != NULL);
+        assert(segments != NULL);
+        assert(io != NULL);
+        assert(run != NULL);
+
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wpedantic"
+        static const struct Handlers table = {
+                .single = {
+                        &&do_cmov, &&do_sload, &&do_sstore, &&do_add,
+                        &&do_mul, &&do_div, &&do_nand, &&do_halt,
+                        &&do_activate, &&do_inactivate, &&do_out, &&do_in,
+                        &&do_loadp, &&do_lv, &&do_invalid, &&do_invalid
+                },
+                .pairs = {
+                        [CMOV] = { [CMOV] = &&do_cmov_cmov },
+                        [SLOAD] = { [LV] = &&do_sload_lv },
+                        [SSTORE] = { [LV] = &&do_sstore_lv },
+                        [NAND] = { [NAND] = &&do_nand_nand },
+                        [LV] = { [SLOAD] = &&do_lv_sload,
+                                 [SSTORE] = &&do_lv_sstore,
+                                 [LV] = &&do_lv_lv }
+                },
+                .decode = &&do_decode
+        };
+        const struct Handlers *handlers = &table;
+
+/* execute the record ip points at (a record in a dirty page is not an
+   instruction yet, so it is not profiled until it has been decoded) */
+#define DISPATCH() do {                                                 \
+                if (ip->handler != handlers->decode) {                  \
+                        PROFILE_STEP(ip - program, ip->op);             \
+                }                                                       \
+                goto *ip->handler;                                      \
+        } while (0)
+/* move on to the next record and execute it */
+#define NEXT() do { ip++; DISPATCH(); } while (0)
+/* finish a fused pair: skip both records and execute the next one */
+#define NEXT_PAIR() do {                                                \
+                PROFILE_STEP(ip + 1 - program, ip[1].op);               \
+                fused += 2;                                             \
+                ip += 2;                                                \
+                DISPATCH();                                             \
+        } while (0)
+
+/* the instructions pairs are made of, executing the record at i */
+#define DO_CMOV(i) conditional_move(i->ra, i->rb, i->rc, registers)
+#define DO_SLOAD(i) (registers[i->ra] = segmented_load(registers[i->rb],   \
+                                                    registers[i->rc],   \
+                                                    segments))
+#define DO_NAND(i) bitwise_NAND(i->ra, i->rb, i->rc, registers)
+#define DO_LV(i) load_value(i->ra, i->value, registers)
+#define DO_SSTORE(i) segmented_store(registers[i->ra], registers[i->rb], \
+                                     registers[i->rc], segments)
+/* after a store: true if it wrote segment 0, which may have changed code */
+#define WROTE_CODE(i) (registers[i->ra] == 0)
+/* after a store into segment 0: bring the records up to date */
+#define REWRITE(i) rewrite_word(run->code, registers[i->rb],            \
+                                registers[i->rc], handlers)
+/* the checked build stops at the record i if it would fault */
+#define CHECK(i) do {                                                   \
+                if (UM_CHECKS && find_fault(i->op, i->ra, i->rb, i->rc,   \
+                                            registers, segments,        \
+                                            &run->fault)) {             \
+                        ip = i;                                         \
+                        goto do_fault;                                  \
+                }                                                       \
+        } while (0)
+
+        /* a paused run keeps its cache, so resuming decodes nothing twice;
+           the cache is only reached through run, off the hot paths */
+        if (run->code == NULL) {
+                NEW0(run->code);
+        }
+        sync_code(run->code, segments->table[0], handlers);
+        struct Instruction *program = run->code->program;
+        unsigned length = run->code->length;
+        const struct Instruction *ip = program + (run->pc < length ? run->pc
+                                                                    : length);
+        const struct Instruction *jumped_to = ip; /* last load program target */
+        uint64_t steps = run->steps;
+        uint64_t fused = run->fused_steps;
+        uint32_t registers[8];
+        memcpy(registers, register_file, sizeof(registers));
+
+        DISPATCH();
+
+do_cmov:
+        DO_CMOV(ip);
+        NEXT();
+do_sload:
+        CHECK(ip);
+        DO_SLOAD(ip);
+        NEXT();
+do_sstore:
+        CHECK(ip);
+        DO_SSTORE(ip);
+        if (WROTE_CODE(ip)) { /* the program modified itself */
+                REWRITE(ip);
+        }
+        NEXT();
+do_add:
+        add(ip->ra, ip->rb, ip->rc, registers);
+        NEXT();
+do_mul:
+        multiply(ip->ra, ip->rb, ip->rc, registers);
+        NEXT();
+do_div:
+        CHECK(ip);
+        divide(ip->ra, ip->rb, ip->rc, registers);
+        NEXT();
+do_nand:
+        DO_NAND(ip);
+        NEXT();
+do_activate: {
+        uint32_t seg_id;
+        bool mapped = map_segment(registers[ip->rc], &seg_id, segments);
+        registers[ip->rb] = seg_id;
+        if (!mapped) {
+                goto do_halt; /* memory resources have been exhausted */
+        }
+        NEXT();
+}
+do_inactivate:
+        CHECK(ip);
+        unmap_segment(registers[ip->rc], segments);
+        NEXT();
+do_out:
+        CHECK(ip);
+        output(io, registers[ip->rc]);
+        NEXT();
+do_in:
+        registers[ip->rc] = input(io);
+        NEXT();
+do_loadp: {
+        CHECK(ip);
+        /* ip points into the records being replaced, so read it first */
+        uint64_t target = registers[ip->rc];
+        uint32_t from = ip - program;
+        steps += ip - jumped_to + 1;
+
+        if (load_program(registers[ip->rb], segments)) {
+                sync_code(run->code, segments->table[0], handlers);
+                program = run->code->program;
+                length = run->code->length;
+        }
+        if (target < length) {
+                ip = program + target;
+        } else if (UM_CHECKS) {
+                run->fault = (struct Um_fault){ FAULT_PC, from, LOADP, 0,
+                                                target };
+                goto stop;
+        } else {
+                ip = program + length; /* stops on the sentinel */
+        }
+        jumped_to = ip;
+        if (steps >= run->pause_at || pause_requested) {
+                run->pc = ip - program;
+                run->steps = steps;
+                run->fused_steps = fused;
+                run->paused = true;
+                memcpy(register_file, registers, sizeof(registers));
+                return;
+        }
+        DISPATCH();
+}
+do_lv:
+        DO_LV(ip);
+        NEXT();
+
+do_cmov_cmov:
+        DO_CMOV(ip);
+        DO_CMOV((ip + 1));
+        NEXT_PAIR();
+do_sload_lv:
+        CHECK(ip);
+        DO_SLOAD(ip);
+        DO_LV((ip + 1));
+        NEXT_PAIR();
+do_sstore_lv:
+        CHECK(ip);
+        DO_SSTORE(ip);
+        if (WROTE_CODE(ip)) {
+                REWRITE(ip);
+                NEXT(); /* the store may have rewritten the load value */
+        }
+        DO_LV((ip + 1));
+        NEXT_PAIR();
+do_nand_nand:
+        DO_NAND(ip);
+        DO_NAND((ip + 1));
+        NEXT_PAIR();
+do_lv_sload:
+        DO_LV(ip);
+        CHECK((ip + 1));
+        DO_SLOAD((ip + 1));
+        NEXT_PAIR();
+do_lv_sstore:
+        DO_LV(ip);
+        CHECK((ip + 1));
+        DO_SSTORE((ip + 1));
+        if (WROTE_CODE((ip + 1))) {
+                REWRITE((ip + 1));
+        }
+        NEXT_PAIR();
+do_lv_lv:
+        DO_LV(ip);
+        DO_LV((ip + 1));
+        NEXT_PAIR();
+
+do_decode:
+        /* the first instruction run in a dirty page since it changed */
+        decode_page(run->code, (ip - program) / CODE_PAGE,
+                    segments->table[0], handlers);
+        DISPATCH();
+
+do_invalid:
+        if (UM_CHECKS && ip == program + length) {
+                /* the sentinel: the program ran off the end */
+                run->fault = (struct Um_fault){ FAULT_PC, length, 0, 0,
+                                                length };
+                goto stop;
+        } else if (UM_CHECKS) {
+                run->fault.kind = FAULT_OPCODE;
+                goto do_fault;
+        }
+do_halt:
+        /* the sentinel past the end of segment 0 is not an instruction */
+        steps += (ip - jumped_to) + (ip < program + length);
+        goto stop;
+do_fault:
+        /* the faulting instruction did not execute */
+        run->fault.pc = ip - program;
+        run->fault.op = ip->op;
+        steps += ip - jumped_to;
+stop:
+        run->steps = steps;
+        run->fused_steps = fused;
+        run->paused = false;
+        memcpy(register_file, registers, sizeof(registers));
+        Code_cache_free(&run->code);
+        return;
+
+#undef CHECK
+#undef REWRITE
+#undef WROTE_CODE
+#undef DO_SSTORE
+#undef DO_LV
+#undef DO_NAND
+#undef DO_SLOAD
+#undef DO_CMOV
+#undef NEXT_PAIR
+#undef NEXT
+#undef DISPATCH
+#pragma GCC diagnostic pop
+}
+
+/*
+ *      name: dispatch_loop
+ *   purpose: executes the program in segment 0, decoding every word as it is
+ *            fetched
+ *    inputs: register_file - the eight registers, brought up to date when
+ *                            the machine pauses or stops
+ *                 segments - the segmented memory; segment 0 holds the
+ *                            program
+ *                       io - the I/O device
+ *                      run - where to start and when to pause; updated
+ *                            when the machine pauses or stops
+ *   outputs: none
+ *    errors: unchecked runtime error if program counter points to a word that
+ *            doesn't code for a valid instruction, or if the program counter
+ *            points out of bounds of $m[0]; in the checked build these and
+ *            the other faults set run->fault instead
+ *            CRE if any argument is NULL
+ */
+void dispatch_loop(uint32_t *register_file, Segments_T segments, Io_T io,
+                   struct Um_run *run)
+{
+        assert(register_file != NULL);
+        assert(segments != NULL);
+        assert(io != NULL);
+        assert(run != NULL);
+
+        bool halted = false;
+        uint32_t program_idx = run->pc; /* current index in segment 0 */
+        uint64_t steps = run->steps;
+        uint32_t registers[8];
+        memcpy(registers, register_file, sizeof(registers));
+
+        run->paused = false;
+
+        while (!halted) {
+                /* get segment 0 */
+                const uint32_t *segment0 = segments->table[0];
+                if (program_idx >= segment_length(segment0)) {
+                        if (UM_CHECKS) {
+                                run->fault = (struct Um_fault){
+                                        FAULT_PC, program_idx, 0, 0,
+                                        program_idx };
+                        }
+                        break; /* ran off the end of $m[0] */
+                }
+
+                /* get current word in segment 0 and increment program index */
+                uint64_t word = segment0[program_idx];
+                program_idx++;
+                steps++;
+
+                /* unpack op code and registers from word */
+                unsigned op = Bitpack_getu(word, 4, 28);
+                unsigned ra = Bitpack_getu(word, 3, 6);
+                unsigned rb = Bitpack_getu(word, 3, 3);
+                unsigned rc = Bitpack_getu(word, 3, 0);
+                PROFILE_STEP(program_idx - 1, op);
+
+                if (UM_CHECKS && find_fault(op, ra, rb, rc, registers,
+                                            segments, &run->fault)) {
+                        /* the faulting instruction does not execute */
+                        run->fault.pc = program_idx - 1;
+                        run->fault.op = op;
+                        steps--;
+                        break;
+                }
+
+                if (op == HALT) {
+                        halted = true;
+                } else if (op == CMOV) {
+                        conditional_move(ra, rb, rc, registers);
+                } else if (op == SLOAD) {
+                        registers[ra] = segmented_load(registers[rb],
+                                                       registers[rc],
+                                                       segments);
+                } else if (op == SSTORE) {
+                        segmented_store(registers[ra], registers[rb],
+                                        registers[rc], segments);
+                } else if (op == ADD) {
+                        add(ra, rb, rc, registers);
+                } else if (op == MUL) {
+                        multiply(ra, rb, rc, registers);
+                } else if (op == DIV) {
+                        divide(ra, rb, rc, registers);
+                } else if (op == NAND) {
+                        bitwise_NAND(ra, rb, rc, registers);
+                } else if (op == ACTIVATE) {
+                        uint32_t seg_id;
+                        /* Make sure memory resources haven't been exhausted */
+                        if (!map_segment(registers[rc], &seg_id, segments)) {
+                                halted = true;
+                        }
+                        registers[rb] = seg_id;
+                } else if (op == INACTIVATE) {
+                        unmap_segment(registers[rc], segments);
+                } else if (op == OUT) {
+                        output(io, registers[rc]);
+                } else if (op == IN) {
+                        registers[rc] = input(io);
+                } else if (op == LOADP) {
+                        load_program(registers[rb], segments);
+                        if (UM_CHECKS && registers[rc] >=
+                            segment_length(segments->table[0])) {
+                                run->fault = (struct Um_fault){
+                                        FAULT_PC, program_idx - 1, LOADP, 0,
+                                        registers[rc] };
+                                break;
+                        }
+                        program_idx = registers[rc];
+                        if (steps >= run->pause_at || pause_requested) {
+                                run->pc = program_idx;
+                                run->paused = true;
+                                break;
+                        }
+                } else if (op == LV) {
+                        ra = Bitpack_getu(word, 3, 25);
+                        unsigned val = Bitpack_getu(word, 25, 0);
+                        load_value(ra, val, registers);
+                } else {
+                        halted = true;
+                }
+        }
+        run->steps = steps;
+        memcpy(register_file, registers, sizeof(registers));
+}
@@ -0,0 +1,69 @@
+/* dispatch.h
+ * by Alyssa Williams (awilli36) and Olivia Byun (obyun01)
+ * 11/21/22
+ *
+ * This is the interface for our dispatch module, which runs the fetch/execute
+ * loop of the UM. Two interchangeable engines are provided: a threaded engine
+ * that predecodes segment 0 and jumps straight from one instruction's handler
+ * to the next, and the original decode-every-word loop, kept as a fallback.
+ */
+
+#ifndef DISPATCH_H
+#define DISPATCH_H
+
+#include "fault.h"
+#include "memory.h"
+#include "perform_io.h"
+#include <signal.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+typedef enum Um_opcode {
+        CMOV = 0, SLOAD, SSTORE, ADD, MUL, DIV, NAND, HALT, ACTIVATE,
+        INACTIVATE, OUT, IN, LOADP, LV
+} Um_opcode;
+
+/*
+ * purpose: where a run of the machine starts, and when it should pause.
+ *          Engines only pause at a load program, the one instruction that
+ *          transfers control, so a paused machine can be snapshotted and
+ *          resumed from pc.
+ * members:       pc - offset in segment 0 to start at; when the run pauses,
+ *                     the offset to resume at
+ *             steps - instructions executed so far, brought up to date when
+ *                     the run pauses or the machine stops
+ *          pause_at - pause at the first load program once steps reaches
+ *                     this (UINT64_MAX to never pause on a count)
+ *            paused - set true if the run paused, false if the machine
+ *                     stopped
+ *       fused_steps - instructions executed as part of a fused pair by the
+ *                     threaded engine, brought up to date with steps
+ *             fault - why the machine stopped: FAULT_NONE if it halted,
+ *                     or the fault the checked build detected
+ *              code - the threaded engine's code cache, kept while the run
+ *                     is paused; NULL to start with and once the machine
+ *                     stops
+ */
+struct Um_run {
+        uint32_t pc;
+        uint64_t steps;
+        uint64_t pause_at;
+        bool paused;
+        uint64_t fused_steps;
+        struct Um_fault fault;
+        struct Code_cache *code;
+};
+
+/* set (e.g. by a signal handler) to pause at the next load program */
+extern volatile sig_atomic_t pause_requested;
+
+/* an execution engine: runs the machine until it stops or pauses */
+typedef void (*Um_engine)(uint32_t *register_file, Segments_T segments,
+                          Io_T io, struct Um_run *run);
+
+void dispatch_threaded(uint32_t *register_file, Segments_T segments,
+                       Io_T io, struct Um_run *run);
+void dispatch_loop(uint32_t *register_file, Segments_T segments, Io_T io,
+                   struct Um_run *run);
+
+#endif
@@ -0,0 +1,79 @@
+/* fault.c
+ * by Alyssa Williams (awilli36) and Olivia Byun (obyun01)
+ * 11/21/22
+ *
+ * This is the implementation for our fault module, which prints the report
+ * for a machine stopped by a fault in the checked build.
+ */
+
+#include "fault.h"
+#include "assert.h"
+
+/* mnemonics indexed by opcode, shared with profile */
+const char *const Um_op_names[16] = {
+        "cmov", "sload", "sstore", "add", "mul", "div", "nand", "halt",
+        "map", "unmap", "out", "in", "loadp", "lv", "inv14", "inv15"
+};
+
+/*
+ *      name: Um_fault_report
+ *   purpose: prints what went wrong, where, and the registers at the time:
+ *
+ *              um: fault at pc 17 (sload, opcode 1): segment 3 is not mapped
+ *              um: r0=0x00000003 r1=0x00000000 ... r7=0x00000000
+ *
+ *    inputs:        fp - the stream to print to
+ *                  who - what to start each line with (e.g. the program)
+ *                fault - the fault
+ *            registers - the eight registers when the machine stopped
+ *   outputs: none
+ *    errors: CRE if any argument is NULL or fault->kind is FAULT_NONE
+ */
+void Um_fault_report(FILE *fp, const char *who, const struct Um_fault *fault,
+                     const uint32_t *registers)
+{
+        assert(fp != NULL);
+        assert(who != NULL);
+        assert(fault != NULL && fault->kind != FAULT_NONE);
+        assert(registers != NULL);
+
+        if (fault->kind == FAULT_PC && fault->pc == fault->value) {
+                /* ran off the end: there is no instruction at pc */
+                fprintf(fp, "%s: fault at pc %u: ", who, fault->pc);
+        } else {
+                fprintf(fp, "%s: fault at pc %u (%s, opcode %u): ", who,
+                        fault->pc, Um_op_names[fault->op & 0xf], fault->op);
+        }
+        switch (fault->kind) {
+        case FAULT_UNMAPPED:
+                fprintf(fp, "segment %u is not mapped\n", fault->seg_id);
+                break;
+        case FAULT_BOUNDS:
+                fprintf(fp, "offset %u is out of bounds of segment %u\n",
+                        fault->value, fault->seg_id);
+                break;
+        case FAULT_DIVIDE:
+                fprintf(fp, "division by zero\n");
+                break;
+        case FAULT_OPCODE:
+                fprintf(fp, "invalid opcode\n");
+                break;
+        case FAULT_UNMAP_ZERO:
+                fprintf(fp, "segment 0 cannot be unmapped\n");
+                break;
+        case FAULT_OUTPUT:
+                fprintf(fp, "output value %u is greater than 255\n",
+                        fault->value);
+                break;
+        default:
+                fprintf(fp, "program counter %u is past the end of "
+                        "segment 0\n", fault->value);
+                break;
+        }
+
+        fprintf(fp, "%s:", who);
+        for (int i = 0; i < 8; i++) {
+                fprintf(fp, " r%d=0x%08x", i, (unsigned)registers[i]);
+        }
+        fprintf(fp, "\n");
+}
@@ -0,0 +1,59 @@
+/* fault.h
+ * by Alyssa Williams (awilli36) and Olivia Byun (obyun01)
+ * 11/21/22
+ *
+ * This is the interface for our fault module, which describes the guest
+ * faults the checked build of the UM detects: segmented loads and stores to
+ * unmapped segments or out of bounds, division by zero, invalid opcodes,
+ * unmapping segment 0 or an unmapped segment, output values above 255, and
+ * program counters past the end of segment 0.
+ *
+ * Checking is chosen when the UM is compiled: building with -DUM_CHECKED
+ * (make um-safe) makes UM_CHECKS 1, and the engines test for faults and stop
+ * the machine at the first one. The normal build (make um) has UM_CHECKS 0,
+ * so every test is compiled out of the engines and a faulting program has
+ * undefined behaviour, as the specification allows.
+ */
+
+#ifndef FAULT_H
+#define FAULT_H
+
+#include <stdint.h>
+#include <stdio.h>
+
+#ifdef UM_CHECKED
+#define UM_CHECKS 1
+#else
+#define UM_CHECKS 0
+#endif
+
+/* the faults the checked build detects; FAULT_NONE if the machine halted */
+typedef enum Um_fault_kind {
+        FAULT_NONE = 0, FAULT_UNMAPPED, FAULT_BOUNDS, FAULT_DIVIDE,
+        FAULT_OPCODE, FAULT_UNMAP_ZERO, FAULT_OUTPUT, FAULT_PC
+} Um_fault_kind;
+
+/*
+ * purpose: where and how a machine faulted
+ * members:   kind - what went wrong
+ *              pc - the offset in segment 0 of the faulting instruction
+ *              op - its opcode
+ *          seg_id - the segment it referred to, if any
+ *           value - the offset it referred to, the value it tried to
+ *                   output, or the program counter it tried to jump to
+ */
+struct Um_fault {
+        Um_fault_kind kind;
+        uint32_t pc;
+        unsigned op;
+        uint32_t seg_id;
+        uint32_t value;
+};
+
+/* the mnemonic of each opcode, for reports: "cmov", "sload", ... "inv15" */
+extern const char *const Um_op_names[16];
+
+void Um_fault_report(FILE *fp, const char *who, const struct Um_fault *fault,
+                     const uint32_t *registers);
+
+#endif
@@ -0,0 +1,653 @@
+/* jit.c
+ * by Alyssa Williams (awilli36) and Olivia Byun (obyun01)
+ * 11/21/22
+ *
+ * This is the implementation for our jit module, an optional execution engine
+ * that translates segment 0 into x86-64 machine code one basic block at a
+ * time.
+ *
+ * A block is a run of consecutive conditional move, segmented load and store,
+ * add, multiply, divide, NAND and load value instructions, optionally ended by
+ * a load program. It is compiled into straight-line code that keeps UM
+ * register i in host register r(8 + i), loading the registers the block uses
+ * on entry and writing back the ones it sets on exit. A compiled block
+ * returns the offset of the next instruction to execute: the word after the
+ * block, or the target of a load program that jumps within segment 0. Map,
+ * unmap, I/O, halt, load program from another segment, and segmented stores
+ * that need bookkeeping (into compiled words of segment 0, or into words
+ * shared between identifiers) are executed here in C between blocks.
+ *
+ * Blocks are compiled the first time execution reaches them and kept in an
+ * mmap'd executable buffer, indexed by the offset they start at. The cache
+ * remembers which words of segment 0 it has compiled or marked as executed
+ * in C; a segmented store that overwrites one of them, or a load program
+ * that replaces segment 0, throws every block away. On hosts other than
+ * x86-64, in the profiling build (compiled code cannot count instructions),
+ * in the checked build (compiled code does not test for faults), or if
+ * executable memory cannot be mapped, the threaded engine runs the program
+ * instead.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <stddef.h>
+#include "jit.h"
+#include "dispatch.h"
+#include "calculate.h"
+#include "memory.h"
+#include "perform_io.h"
+#include "assert.h"
+#include "mem.h"
+
+#if defined(__x86_64__) && !defined(UM_PROFILE) && !defined(UM_CHECKED)
+
+#include <sys/mman.h>
+
+#define CODE_SIZE (16 * 1024 * 1024) /* bytes of executable memory */
+#define MAX_BLOCK 256                /* instructions per compiled block */
+#define MAX_INSN_BYTES 48            /* longest code for one instruction */
+#define MAX_EXIT_BYTES 16            /* longest side exit for one instruction */
+#define MAX_FRAME_BYTES 128          /* longest prologue plus epilogue */
+
+/* x86-64 register numbers; UM register i lives in r(8 + i) */
+enum { RAX = 0, RCX = 1, RDX = 2, RSI = 6, RDI = 7, UM_R0 = 8 };
+
+/*
+ * a compiled block: runs from its offset and returns the next offset, plus
+ * SIDE_EXIT if the instruction there has to be executed in C
+ */
+typedef uint64_t (*Block_fn)(uint32_t *registers, Segments_T segments,
+                             const uint8_t *covered);
+#define SIDE_EXIT ((uint64_t)1 << 32)
+
+/* marks an offset whose instruction is executed in C */
+static const char no_block;
+#define NO_BLOCK ((const void *)&no_block)
+
+/*
+ * purpose: the compiled blocks of the current segment 0
+ * members:    code - the executable buffer
+ *             used - number of bytes of code in use
+ *            entry - offset -> its block, NO_BLOCK, or NULL if not compiled
+ *          covered - offset -> 1 if the word is part of a compiled block
+ *                    or its entry is NO_BLOCK
+ *           length - number of words in the segment 0 entry and covered
+ *                    describe
+ */
+struct Jit {
+        unsigned char *code;
+        size_t used;
+        const void **entry;
+        uint8_t *covered;
+        uint32_t length;
+};
+
+/*
+ *      name: emit_rex
+ *   purpose: emits a REX prefix if one is needed to reach the given
+ *            registers or to select a 64-bit operand
+ *    inputs:     p - where to emit
+ *                w - 1 for a 64-bit operand, 0 for 32 bits
+ *              reg - the ModRM reg register
+ *            index - the SIB index register
+ *             base - the ModRM rm or SIB base register
+ *   outputs: the byte after the prefix
+ *    errors: none
+ */
+static unsigned char *emit_rex(unsigned char *p, int w, int reg, int index,
+                               int base)
+{
+        unsigned char rex = 0x40 | (w << 3) | ((reg >> 3) << 2) |
+                            ((index >> 3) << 1) | (base >> 3);
+        if (rex != 0x40) {
+                *p++ = rex;
+        }
+        return p;
+}
+
+/*
+ *      name: emit_opcode
+ *   purpose: emits a one-byte opcode, or a two-byte 0x0F xx opcode
+ *    inputs:      p - where to emit
+ *            opcode - the opcode, 0x0Fxx for two-byte opcodes
+ *   outputs: the byte after the opcode
+ *    errors: none
+ */
+static unsigned char *emit_opcode(unsigned char *p, unsigned opcode)
+{
+        if (opcode > 0xff) {
+                *p++ = opcode >> 8;
+        }
+        *p++ = opcode & 0xff;
+        return p;
+}
+
+/*
+ *      name: emit_rr
+ *   purpose: emits an instruction with a register-direct ModRM operand
+ *    inputs:      p - where to emit
+ *                 w - 1 for a 64-bit operand, 0 for 32 bits
+ *            opcode - the opcode
+ *               reg - the ModRM reg register (or opcode extension)
+ *                rm - the ModRM rm register
+ *   outputs: the byte after the instruction
+ *    errors: none
+ */
+static unsigned char *emit_rr(unsigned char *p, int w, unsigned opcode,
+                              int reg, int rm)
+{
+        p = emit_rex(p, w, reg, 0, rm);
+        p = emit_opcode(p, opcode);
+        *p++ = 0xc0 | ((reg & 7) << 3) | (rm & 7);
+        return p;
+}
+
+/*
+ *      name: emit_disp8
+ *   purpose: emits an instruction whose memory operand is [base + disp8]
+ *    inputs:      p - where to emit
+ *                 w - 1 for a 64-bit operand, 0 for 32 bits
+ *            opcode - the opcode
+ *               reg - the ModRM reg register
+ *              base - the base register (not rsp or r12)
+ *              disp - the displacement
+ *   outputs: the byte after the instruction
+ *    errors: none
+ */
+static unsigned char *emit_disp8(unsigned char *p, int w, unsigned opcode,
+                                 int reg, int base, int8_t disp)
+{
+        p = emit_rex(p, w, reg, 0, base);
+        p = emit_opcode(p, opcode);
+        *p++ = 0x40 | ((reg & 7) << 3) | (base & 7);
+        *p++ = (unsigned char)disp;
+        return p;
+}
+
+/*
+ *      name: emit_indexed
+ *   purpose: emits an instruction whose memory operand is
+ *            [base + index * 2^scale]
+ *    inputs:      p - where to emit
+ *                 w - 1 for a 64-bit operand, 0 for 32 bits
+ *            opcode - the opcode
+ *               reg - the ModRM reg register
+ *              base - the base register (not rbp or r13)
+ *             index - the index register (not rsp)
+ *             scale - log2 of the index scale
+ *   outputs: the byte after the instruction
+ *    errors: none
+ */
+static unsigned char *emit_indexed(unsigned char *p, int w, unsigned opcode,
+                                   int reg, int base, int index, int scale)
+{
+        p = emit_rex(p, w, reg, index, base);
+        p = emit_opcode(p, opcode);
+        *p++ = 0x04 | ((reg & 7) << 3);
+        *p++ = (scale << 6) | ((index & 7) << 3) | (base & 7);
+        return p;
+}
+
+/*
+ *      name: emit_mov_imm
+ *   purpose: emits mov r32, imm32
+ *    inputs:     p - where to emit
+ *              reg - the destination register
+ *            value - the immediate
+ *   outputs: the byte after the instruction
+ *    errors: none
+ */
+static unsigned char *emit_mov_imm(unsigned char *p, int reg, uint32_t value)
+{
+        p = emit_rex(p, 0, 0, 0, reg);
+        *p++ = 0xb8 + (reg & 7);
+        memcpy(p, &value, sizeof(value));
+        return p + sizeof(value);
+}
+
+/*
+ *      name: emit_mov_imm64
+ *   purpose: emits mov r64, imm64
+ *    inputs:     p - where to emit
+ *              reg - the destination register
+ *            value - the immediate
+ *   outputs: the byte after the instruction
+ *    errors: none
+ */
+static unsigned char *emit_mov_imm64(unsigned char *p, int reg, uint64_t value)
+{
+        p = emit_rex(p, 1, 0, 0, reg);
+        *p++ = 0xb8 + (reg & 7);
+        memcpy(p, &value, sizeof(value));
+        return p + sizeof(value);
+}
+
+/*
+ *      name: compilable
+ *   purpose: tells whether an opcode can be part of a compiled block
+ *    inputs: op - the opcode
+ *   outputs: true for the opcodes that only touch registers and memory
+ *    errors: none
+ */
+static inline bool compilable(unsigned op)
+{
+        return op == CMOV || op == SLOAD || op == SSTORE || op == ADD ||
+               op == MUL || op == DIV || op == NAND || op == LV;
+}
+
+/*
+ *      name: emit_jump
+ *   purpose: emits a conditional jump with a 32-bit displacement to be
+ *            patched once its target is known
+ *    inputs:         p - where to emit
+ *            condition - the condition code (0x4 for je, 0x5 for jne)
+ *                fixup - set to the address of the displacement
+ *   outputs: the byte after the instruction
+ *    errors: none
+ */
+static unsigned char *emit_jump(unsigned char *p, unsigned condition,
+                                unsigned char **fixup)
+{
+        *p++ = 0x0f;
+        *p++ = 0x80 + condition;
+        *fixup = p;
+        memset(p, 0, sizeof(int32_t));
+        return p + sizeof(int32_t);
+}
+
+/*
+ *      name: patch_jump
+ *   purpose: points a jump emitted by emit_jump at its target
+ *    inputs:  fixup - the address of the jump's displacement
+ *            target - where the jump should go
+ *   outputs: none
+ *    errors: none
+ */
+static void patch_jump(unsigned char *fixup, const unsigned char *target)
+{
+        int32_t displacement = target - (fixup + sizeof(int32_t));
+        memcpy(fixup, &displacement, sizeof(displacement));
+}
+
+/*
+ *      name: emit_instruction
+ *   purpose: emits the machine code for one compilable UM instruction
+ *    inputs:     p - where to emit
+ *             word - the UM instruction word
+ *            exits - for a segmented store, set to the addresses of the
+ *                    jumps taken when the store has to be done in C
+ *   outputs: the byte after the code
+ *    errors: none
+ */
+static unsigned char *emit_instruction(unsigned char *p, uint32_t word,
+                                       unsigned char **exits)
+{
+        unsigned op = word >> 28;
+        int a = UM_R0 + ((word >> 6) & 0x7);
+        int b = UM_R0 + ((word >> 3) & 0x7);
+        int c = UM_R0 + (word & 0x7);
+
+        switch (op) {
+        case CMOV:                                   /* if c: a = b */
+                p = emit_rr(p, 0, 0x85, c, c);               /* test c, c */
+                p = emit_rr(p, 0, 0x0f45, a, b);             /* cmovne a, b */
+                break;
+        case SLOAD:                                  /* a = m[b][c] */
+                p = emit_disp8(p, 1, 0x8b, RAX, RSI,
+                               offsetof(struct Segments, table));
+                p = emit_indexed(p, 1, 0x8b, RAX, RAX, b, 3);
+                p = emit_indexed(p, 0, 0x8b, a, RAX, c, 2);
+                break;
+        case SSTORE: {                               /* m[a][b] = c */
+                /* stores into segment 0 must not hit compiled code */
+                p = emit_rr(p, 0, 0x85, a, a);               /* test a, a */
+                *p++ = 0x75;                                 /* jnz store */
+                unsigned char *skip = p++;
+                p = emit_indexed(p, 0, 0x80, 7, RCX, b, 0);  /* cmp covered */
+                *p++ = 0;
+                p = emit_jump(p, 0x5, &exits[0]);            /* jne exit */
+                *skip = p - (skip + 1);
+                p = emit_disp8(p, 1, 0x8b, RAX, RSI,
+                               offsetof(struct Segments, table));
+                p = emit_indexed(p, 1, 0x8b, RAX, RAX, a, 3);
+                /* shared words have to be copied first */
+                p = emit_disp8(p, 0, 0x83, 7, RAX,          /* cmp refs, 1 */
+                               -SEGMENT_HEADER * (int)sizeof(uint32_t));
+                *p++ = 1;
+                p = emit_jump(p, 0x5, &exits[1]);            /* jne exit */
+                p = emit_indexed(p, 0, 0x89, c, RAX, b, 2);
+                break;
+        }
+        case ADD:                                    /* a = b + c */
+                p = emit_rr(p, 0, 0x89, b, RAX);             /* mov eax, b */
+                p = emit_rr(p, 0, 0x03, RAX, c);             /* add eax, c */
+                p = emit_rr(p, 0, 0x89, RAX, a);             /* mov a, eax */
+                break;
+        case MUL:                                    /* a = b * c */
+                p = emit_rr(p, 0, 0x89, b, RAX);
+                p = emit_rr(p, 0, 0x0faf, RAX, c);           /* imul eax, c */
+                p = emit_rr(p, 0, 0x89, RAX, a);
+                break;
+        case DIV:                                    /* a = b / c */
+                p = emit_rr(p, 0, 0x89, b, RAX);
+                p = emit_rr(p, 0, 0x31, RDX, RDX);           /* xor edx, edx */
+                p = emit_rr(p, 0, 0xf7, 6, c);               /* div c */
+                p = emit_rr(p, 0, 0x89, RAX, a);
+                break;
+        case NAND:                                   /* a = ~(b & c) */
+                p = emit_rr(p, 0, 0x89, b, RAX);
+                p = emit_rr(p, 0, 0x23, RAX, c);             /* and eax, c */
+                p = emit_rr(p, 0, 0xf7, 2, RAX);             /* not eax */
+                p = emit_rr(p, 0, 0x89, RAX, a);
+                break;
+        case LV:
+                p = emit_mov_imm(p, UM_R0 + ((word >> 25) & 0x7),
+                                 word & 0x1ffffff);
+                break;
+        }
+        return p;
+}
+
+/*
+ *      name: register_masks
+ *   purpose: finds the UM registers an instruction reads or writes
+ *    inputs:    word - the UM instruction word
+ *            written - bits for the registers it writes are set here
+ *   outputs: bits for every register it reads or writes
+ *    errors: none
+ */
+static unsigned register_masks(uint32_t word, unsigned *written)
+{
+        unsigned op = word >> 28;
+
+        if (op == LV) {
+                unsigned a = 1u << ((word >> 25) & 0x7);
+                *written |= a;
+                return a;
+        }
+
+        unsigned a = 1u << ((word >> 6) & 0x7);
+        if (op != SSTORE && op != LOADP) {
+                *written |= a;
+        }
+        return a | 1u << ((word >> 3) & 0x7) | 1u << (word & 0x7);
+}
+
+/*
+ *      name: jit_reset
+ *   purpose: throws away every compiled block and sizes the cache for the
+ *            current segment 0
+ *    inputs:  jit - the compiled blocks
+ *            seg0 - segment 0
+ *   outputs: none
+ *    errors: none
+ */
+static void jit_reset(struct Jit *jit, const uint32_t *seg0)
+{
+        uint32_t length = segment_length(seg0);
+
+        if (length != jit->length) {
+                FREE(jit->entry);
+                FREE(jit->covered);
+                jit->entry = CALLOC((long)length + 1, sizeof(const void *));
+                jit->covered = CALLOC((long)length + 1, sizeof(uint8_t));
+                jit->length = length;
+        } else {
+                memset(jit->entry, 0, ((size_t)length + 1) *
+                                      sizeof(const void *));
+                memset(jit->covered, 0, (size_t)length + 1);
+        }
+        jit->used = 0;
+}
+
+/*
+ *      name: compile_block
+ *   purpose: compiles the block starting at an offset in segment 0 and
+ *            records it in the cache. A block ends before the first
+ *            instruction that has to be executed in C, or after a load
+ *            program, which the block carries out itself when it jumps
+ *            within segment 0. A segmented store into segment 0, or into
+ *            words shared with another identifier, leaves the block early
+ *            so it can be done in C.
+ *    inputs:  jit - the compiled blocks
+ *            seg0 - segment 0
+ *              pc - the offset the block starts at; less than jit->length
+ *   outputs: the block's code, or NO_BLOCK if the instruction at pc has to
+ *            be executed in C
+ *    errors: CRE if the code is longer than the room reserved for it
+ */
+static const void *compile_block(struct Jit *jit, const uint32_t *seg0,
+                                 uint32_t pc)
+{
+        uint32_t end = pc;
+        unsigned used = 0, written = 0;
+        bool jumps = false; /* the block ends with a load program */
+
+        while (end < jit->length && end - pc < MAX_BLOCK) {
+                unsigned op = seg0[end] >> 28;
+                if (!compilable(op) && op != LOADP) {
+                        break;
+                }
+                used |= register_masks(seg0[end], &written);
+                end++;
+                if (op == LOADP) {
+                        jumps = true;
+                        break;
+                }
+        }
+        if (end == pc || (jumps && end - 1 == pc)) {
+                /* overwriting the word has to clear NO_BLOCK too */
+                jit->entry[pc] = NO_BLOCK;
+                jit->covered[pc] = 1;
+                return NO_BLOCK;
+        }
+
+        size_t needed = MAX_FRAME_BYTES + (size_t)(end - pc) *
+                                          (MAX_INSN_BYTES + MAX_EXIT_BYTES);
+        if (jit->used + needed > CODE_SIZE) {
+                jit_reset(jit, seg0);
+        }
+
+        unsigned char *start = jit->code + jit->used;
+        unsigned char *p = start;
+        unsigned char *exits[MAX_BLOCK][2];
+        memset(exits, 0, sizeof(exits));
+
+        /* prologue: save the callee-saved registers we use, load registers */
+        p = emit_rr(p, 1, 0x89, RDX, RCX);                   /* mov rcx, rdx */
+        for (int i = 4; i < 8; i++) {
+                if (used & (1u << i)) {
+                        p = emit_rex(p, 0, 0, 0, UM_R0 + i);
+                        *p++ = 0x50 + ((UM_R0 + i) & 7);     /* push */
+                }
+        }
+        for (int i = 0; i < 8; i++) {
+                if (used & (1u << i)) {
+                        p = emit_disp8(p, 0, 0x8b, UM_R0 + i, RDI, 4 * i);
+                }
+        }
+
+        uint32_t body_end = jumps ? end - 1 : end;
+        for (uint32_t i = pc; i < body_end; i++) {
+                p = emit_instruction(p, seg0[i], exits[i - pc]);
+                jit->covered[i] = 1;
+        }
+
+        if (jumps) {
+                /* load program: jumps within segment 0 return the target */
+                uint32_t word = seg0[body_end];
+                int b = UM_R0 + ((word >> 3) & 0x7);
+                int c = UM_R0 + (word & 0x7);
+
+                p = emit_rr(p, 0, 0x85, b, b);               /* test b, b */
+                p = emit_jump(p, 0x5, &exits[body_end - pc][0]);
+                p = emit_rr(p, 0, 0x89, c, RAX);             /* mov eax, c */
+                jit->covered[body_end] = 1;
+        } else {
+                p = emit_mov_imm(p, RAX, end);
+        }
+
+        /* epilogue: store results, restore, return eax */
+        unsigned char *epilogue = p;
+        for (int i = 0; i < 8; i++) {
+                if (written & (1u << i)) {
+                        p = emit_disp8(p, 0, 0x89, UM_R0 + i, RDI, 4 * i);
+                }
+        }
+        for (int i = 7; i >= 4; i--) {
+                if (used & (1u << i)) {
+                        p = emit_rex(p, 0, 0, 0, UM_R0 + i);
+                        *p++ = 0x58 + ((UM_R0 + i) & 7);     /* pop */
+                }
+        }
+        *p++ = 0xc3;                                         /* ret */
+
+        /* side exits: return the instruction left to C */
+        for (uint32_t i = pc; i < end; i++) {
+                if (exits[i - pc][0] == NULL) {
+                        continue;
+                }
+                for (int k = 0; k < 2; k++) {
+                        if (exits[i - pc][k] != NULL) {
+                                patch_jump(exits[i - pc][k], p);
+                        }
+                }
+                p = emit_mov_imm64(p, RAX, SIDE_EXIT | i);
+                *p++ = 0xe9;                                 /* jmp rel32 */
+                p += sizeof(int32_t);
+                patch_jump(p - sizeof(int32_t), epilogue);
+        }
+
+        assert((size_t)(p - start) <= needed);
+        jit->used = p - jit->code;
+        jit->entry[pc] = start;
+        return start;
+}
+
+/*
+ *      name: dispatch_jit
+ *   purpose: executes the program in segment 0, compiling each basic block
+ *            to machine code the first time it runs
+ *    inputs: registers - the array containing the registers
+ *             segments - the segmented memory; segment 0 holds the program
+ *                   io - the I/O device
+ *                  run - where to start. Compiled code neither counts
+ *                        instructions nor pauses, so run->steps and
+ *                        run->pause_at are ignored.
+ *   outputs: none
+ *    errors: CRE if any argument is NULL or the cache cannot be allocated
+ *            the machine halts if it reaches an invalid instruction, runs off
+ *            the end of segment 0, or is loaded at an offset past the end
+ */
+void dispatch_jit(uint32_t *registers, Segments_T segments, Io_T io,
+                  struct Um_run *run)
+{
+        assert(registers != NULL);
+        assert(segments != NULL);
+        assert(io != NULL);
+        assert(run != NULL);
+
+        struct Jit jit = { NULL, 0, NULL, NULL, 0 };
+        void *code = mmap(NULL, CODE_SIZE, PROT_READ | PROT_WRITE | PROT_EXEC,
+                          MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (code == MAP_FAILED) {
+                dispatch_threaded(registers, segments, io, run);
+                return;
+        }
+        jit.code = code;
+        jit.length = UINT32_MAX; /* force jit_reset to allocate */
+        jit_reset(&jit, segments->table[0]);
+
+        uint32_t pc = run->pc;
+        run->paused = false;
+        for (;;) {
+                const uint32_t *seg0 = segments->table[0];
+                if (pc >= jit.length) {
+                        break; /* ran off the end of $m[0] */
+                }
+
+                const void *block = jit.entry[pc];
+                if (block == NULL) {
+                        block = compile_block(&jit, seg0, pc);
+                }
+                if (block != NO_BLOCK) {
+                        Block_fn execute = (Block_fn)(uintptr_t)block;
+                        uint64_t next = execute(registers, segments,
+                                                jit.covered);
+                        pc = (uint32_t)next;
+                        if ((next & SIDE_EXIT) == 0) {
+                                continue;
+                        }
+                }
+
+                uint32_t word = seg0[pc++];
+                unsigned ra = (word >> 6) & 0x7;
+                unsigned rb = (word >> 3) & 0x7;
+                unsigned rc = word & 0x7;
+
+                switch (word >> 28) {
+                case SSTORE:
+                        segmented_store(registers[ra], registers[rb],
+                                        registers[rc], segments);
+                        if (registers[ra] == 0 && jit.covered[registers[rb]]) {
+                                /* the program overwrote compiled code */
+                                jit_reset(&jit, segments->table[0]);
+                        }
+                        break;
+                case ACTIVATE: {
+                        uint32_t seg_id;
+                        bool mapped = map_segment(registers[rc], &seg_id,
+                                                  segments);
+                        registers[rb] = seg_id;
+                        if (!mapped) {
+                                goto halt;
+                        }
+                        break;
+                }
+                case INACTIVATE:
+                        unmap_segment(registers[rc], segments);
+                        break;
+                case OUT:
+                        output(io, registers[rc]);
+                        break;
+                case IN:
+                        registers[rc] = input(io);
+                        break;
+                case LOADP:
+                        if (load_program(registers[rb], segments)) {
+                                jit_reset(&jit, segments->table[0]);
+                        }
+                        pc = registers[rc];
+                        break;
+                default: /* halt, or an invalid instruction */
+                        goto halt;
+                }
+        }
+
+halt:
+        FREE(jit.entry);
+        FREE(jit.covered);
+        munmap(jit.code, CODE_SIZE);
+}
+
+#else
+
+/*
+ *      name: dispatch_jit
+ *   purpose: executes the program in segment 0; without an x86-64 code
+ *            generator, or when profiling or checking, this is the
+ *            threaded engine
+ *    inputs: registers - the array containing the registers
+ *             segments - the segmented memory; segment 0 holds the program
+ *                   io - the I/O device
+ *                  run - where to start and when to pause
+ *   outputs: none
+ *    errors: CRE if any argument is NULL
+ */
+void dispatch_jit(uint32_t *registers, Segments_T segments, Io_T io,
+                  struct Um_run *run)
+{
+        dispatch_threaded(registers, segments, io, run);
+}
+
+#endif
@@ -0,0 +1,19 @@
+/* jit.h
+ * by Alyssa Williams (awilli36) and Olivia Byun (obyun01)
+ * 11/21/22
+ *
+ * This is the interface for our jit module, an optional execution engine
+ * that translates basic blocks of segment 0 into x86-64 machine code.
+ */
+
+#ifndef JIT_H
+#define JIT_H
+
+#include <stdint.h>
+#include "dispatch.h"
+#include "memory.h"
+
+void dispatch_jit(uint32_t *registers, Segments_T segments, Io_T io,
+                  struct Um_run *run);
+
+#endif
@@ -0,0 +1,219 @@
+/* loader.c
+ * by Alyssa Williams (awilli36) and Olivia Byun (obyun01)
+ * 11/21/22
+ *
+ * This is the implementation for our loader module, which reads a .um program
+ * image into segment 0 of a fresh segmented memory.
+ *
+ * A program image is a sequence of big-endian 32-bit words. Regular files are
+ * mapped into memory and byte-swapped into segment 0 in one pass, using SSSE3
+ * or AVX2 byte shuffles on x86 CPUs that have them. Anything that cannot be
+ * mapped (standard input from a pipe, a FIFO, a process substitution) is read
+ * in large blocks instead. Trailing bytes that do not make up a whole word
+ * are ignored.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "loader.h"
+#include "assert.h"
+#include "mem.h"
+
+#define READ_BLOCK (1024 * 1024) /* bytes per read() when streaming */
+
+/* the byte shuffles are only built for x86; elsewhere words are swapped in C */
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define HAVE_X86 1
+#else
+#define HAVE_X86 0
+#endif
+
+/*
+ *      name: swap_words_scalar
+ *   purpose: converts big-endian words to host order, one word at a time
+ *    inputs: dst - where to store the converted words
+ *            src - the big-endian words
+ *              n - the number of words
+ *   outputs: none
+ *    errors: none
+ */
+static void swap_words_scalar(uint32_t *dst, const uint32_t *src, size_t n)
+{
+        for (size_t i = 0; i < n; i++) {
+                dst[i] = __builtin_bswap32(src[i]);
+        }
+}
+
+#if HAVE_X86
+
+/*
+ *      name: swap_words_ssse3
+ *   purpose: converts big-endian words to host order, four words at a time
+ *    inputs: dst - where to store the converted words
+ *            src - the big-endian words
+ *              n - the number of words
+ *   outputs: none
+ *    errors: none
+ */
+__attribute__((target("ssse3")))
+static void swap_words_ssse3(uint32_t *dst, const uint32_t *src, size_t n)
+{
+        const __m128i reverse = _mm_set_epi8(12, 13, 14, 15, 8, 9, 10, 11,
+                                             4, 5, 6, 7, 0, 1, 2, 3);
+        size_t i = 0;
+
+        for (; i + 4 <= n; i += 4) {
+                __m128i v = _mm_loadu_si128((const __m128i *)(src + i));
+                _mm_storeu_si128((__m128i *)(dst + i),
+                                 _mm_shuffle_epi8(v, reverse));
+        }
+        swap_words_scalar(dst + i, src + i, n - i);
+}
+
+/*
+ *      name: swap_words_avx2
+ *   purpose: converts big-endian words to host order, eight words at a time
+ *    inputs: dst - where to store the converted words
+ *            src - the big-endian words
+ *              n - the number of words
+ *   outputs: none
+ *    errors: none
+ */
+__attribute__((target("avx2")))
+static void swap_words_avx2(uint32_t *dst, const uint32_t *src, size_t n)
+{
+        const __m256i reverse = _mm256_set_epi8(12, 13, 14, 15, 8, 9, 10, 11,
+                                                4, 5, 6, 7, 0, 1, 2, 3,
+                                                12, 13, 14, 15, 8, 9, 10, 11,
+                                                4, 5, 6, 7, 0, 1, 2, 3);
+        size_t i = 0;
+
+        for (; i + 8 <= n; i += 8) {
+                __m256i v = _mm256_loadu_si256((const __m256i *)(src + i));
+                _mm256_storeu_si256((__m256i *)(dst + i),
+                                    _mm256_shuffle_epi8(v, reverse));
+        }
+        swap_words_scalar(dst + i, src + i, n - i);
+}
+
+#endif
+
+/*
+ *      name: swap_words
+ *   purpose: converts big-endian words to host order using the widest byte
+ *            shuffle the CPU supports, or one word at a time off x86
+ *    inputs: dst - where to store the converted words
+ *            src - the big-endian words
+ *              n - the number of words
+ *   outputs: none
+ *    errors: none
+ */
+static void swap_words(uint32_t *dst, const uint32_t *src, size_t n)
+{
+#if HAVE_X86
+        if (__builtin_cpu_supports("avx2")) {
+                swap_words_avx2(dst, src, n);
+                return;
+        }
+        if (__builtin_cpu_supports("ssse3")) {
+                swap_words_ssse3(dst, src, n);
+                return;
+        }
+#endif
+        swap_words_scalar(dst, src, n);
+}
+
+/*
+ *      name: image_segments
+ *   purpose: creates segmented memory whose segment 0 holds a program image
+ *    inputs: image - the bytes of the program image
+ *             size - the number of bytes in the image
+ *   outputs: the new segmented memory
+ *    errors: CRE if the image has 2^32 words or more
+ */
+static Segments_T image_segments(const void *image, size_t size)
+{
+        size_t num_words = size / sizeof(uint32_t);
+        assert(num_words < UINT32_MAX);
+
+        Segments_T segments = Segments_new(num_words);
+        swap_words(segments->table[0], image, num_words);
+
+        return segments;
+}
+
+/*
+ *      name: stream_program
+ *   purpose: reads a program image from a descriptor that cannot be mapped
+ *    inputs: fd - the descriptor to read until end of file
+ *   outputs: the new segmented memory
+ *    errors: CRE if reading fails
+ */
+static Segments_T stream_program(int fd)
+{
+        size_t capacity = READ_BLOCK;
+        size_t size = 0;
+        char *buffer = ALLOC(capacity);
+
+        for (;;) {
+                if (capacity - size < READ_BLOCK) {
+                        capacity *= 2;
+                        RESIZE(buffer, capacity);
+                }
+                ssize_t n = read(fd, buffer + size, capacity - size);
+                assert(n >= 0);
+                if (n == 0) {
+                        break;
+                }
+                size += n;
+        }
+
+        Segments_T segments = image_segments(buffer, size);
+        FREE(buffer);
+        return segments;
+}
+
+/*
+ *      name: read_program
+ *   purpose: reads a program image into segment 0 of a new segmented memory
+ *    inputs: path - the file to read, or "-" for standard input
+ *   outputs: the new segmented memory, to be freed with Segments_free
+ *    errors: CRE if the file cannot be opened or read
+ */
+Segments_T read_program(const char *path)
+{
+        assert(path != NULL);
+
+        bool from_stdin = strcmp(path, "-") == 0;
+        int fd = from_stdin ? STDIN_FILENO : open(path, O_RDONLY);
+        assert(fd >= 0);
+
+        struct stat st;
+        int status = fstat(fd, &st);
+        assert(status == 0);
+
+        Segments_T segments = NULL;
+        if (S_ISREG(st.st_mode) && st.st_size > 0 &&
+            lseek(fd, 0, SEEK_CUR) == 0) {
+                void *image = mmap(NULL, st.st_size, PROT_READ,
+                                   MAP_PRIVATE | MAP_POPULATE, fd, 0);
+                if (image != MAP_FAILED) {
+                        madvise(image, st.st_size, MADV_SEQUENTIAL);
+                        segments = image_segments(image, st.st_size);
+                        munmap(image, st.st_size);
+                }
+        }
+        if (segments == NULL) {
+                segments = stream_program(fd);
+        }
+
+        if (!from_stdin) {
+                close(fd);
+        }
+        return segments;
+}
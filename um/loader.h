@@ -0,0 +1,16 @@
+/* loader.h
+ * by Alyssa Williams (awilli36) and Olivia Byun (obyun01)
+ * 11/21/22
+ *
+ * This is the interface for our loader module, which reads a .um program
+ * image into segment 0 of a fresh segmented memory.
+ */
+
+#ifndef LOADER_H
+#define LOADER_H
+
+#include "memory.h"
+
+Segments_T read_program(const char *path);
+
+#endif
@@ -1,161 +1,235 @@
 /* memory.c
  * by Alyssa Williams (awilli36) and Olivia Byun (obyun01)
  * 11/21/22
- * 
+ *
  * This is the implementation for our memory module, which handles UM operations
  * related to memory. Functionality includes mapping and unmapping segments,
  * loading a program, and segmented loading/storing.
  */
 
 #include <stdio.h>
+#include <string.h>
 #include "memory.h"
+#include "profile.h"
 #include "assert.h"
-#include "uarray.h"
+#include "mem.h"
 
-/* 
+/* initial number of slots in the identifier table and free stack */
+#define INITIAL_CAPACITY 64
+
+/*
+ *      name: Segments_new
+ *   purpose: creates the segmented memory with a zeroed segment 0 of the
+ *            given size, ready for the program to be read into
+ *    inputs: seg0_words - the number of words in segment 0
+ *   outputs: the new segmented memory, to be freed with Segments_free
+ *    errors: CRE if memory cannot be allocated
+ */
+Segments_T Segments_new(uint32_t seg0_words)
+{
+        Segments_T segments;
+        NEW(segments);
+
+        segments->pool = Pool_new();
+        segments->capacity = INITIAL_CAPACITY;
+        segments->table = CALLOC(segments->capacity, sizeof(uint32_t *));
+        segments->table[0] = segment_new(segments->pool, seg0_words);
+        segments->next_id = 1;
+
+        segments->free_capacity = INITIAL_CAPACITY;
+        segments->free_ids = ALLOC(segments->free_capacity * sizeof(uint32_t));
+        segments->num_free = 0;
+
+        return segments;
+}
+
+/*
+ *      name: Segments_free
+ *   purpose: frees the segmented memory and every segment still mapped
+ *    inputs: segments - pointer to the segmented memory to free
+ *   outputs: none
+ *    errors: CRE if segments or *segments is NULL
+ */
+void Segments_free(Segments_T *segments)
+{
+        assert(segments != NULL && *segments != NULL);
+
+        Segments_T s = *segments;
+        for (uint32_t id = 0; id < s->next_id; id++) {
+                if (s->table[id] != NULL) {
+                        segment_free(s->pool, s->table[id]);
+                }
+        }
+
+        Pool_dispose(&s->pool);
+        FREE(s->table);
+        FREE(s->free_ids);
+        FREE(*segments);
+}
+
+/*
+ *      name: segment_new
+ *   purpose: allocates an array of words, all initialized to 0, mapped under
+ *            one identifier
+ *    inputs:      pool - the allocator to take the words from
+ *            num_words - the number of words in the segment
+ *   outputs: pointer to word 0 of the segment, to be freed with segment_free
+ *    errors: CRE if pool is NULL or memory cannot be allocated
+ */
+uint32_t *segment_new(Pool_T pool, uint32_t num_words)
+{
+        uint32_t *block = Pool_alloc(pool, ((size_t)num_words +
+                                            SEGMENT_HEADER) * sizeof(uint32_t));
+        uint32_t *words = block + SEGMENT_HEADER;
+
+        words[-1] = num_words;
+        *segment_refs(words) = 1;
+        return words;
+}
+
+/*
+ *      name: segment_free
+ *   purpose: drops one identifier's reference to an array of words allocated
+ *            by segment_new, returning the array to its pool once no
+ *            identifier refers to it
+ *    inputs:  pool - the allocator the words came from
+ *            words - pointer to word 0 of the segment
+ *   outputs: none
+ *    errors: CRE if pool or words is NULL
+ */
+void segment_free(Pool_T pool, uint32_t *words)
+{
+        assert(words != NULL);
+
+        if (--*segment_refs(words) == 0) {
+                Pool_free(pool, words - SEGMENT_HEADER,
+                          ((size_t)segment_length(words) + SEGMENT_HEADER) *
+                          sizeof(uint32_t));
+        }
+}
+
+/*
+ *      name: segment_unshare
+ *   purpose: gives a segment whose words are shared with another identifier
+ *            its own copy of them, so it can be written without changing the
+ *            other identifier's segment
+ *    inputs: segments - the segmented memory
+ *              seg_id - the identifier about to be written
+ *   outputs: the segment's new word array
+ *    errors: CRE if segments is NULL
+ */
+uint32_t *segment_unshare(Segments_T segments, unsigned seg_id)
+{
+        assert(segments != NULL);
+
+        uint32_t *shared = segments->table[seg_id];
+        uint32_t length = segment_length(shared);
+        uint32_t *copy = segment_new(segments->pool, length);
+
+        memcpy(copy, shared, (size_t)length * sizeof(uint32_t));
+        segment_free(segments->pool, shared);
+        segments->table[seg_id] = copy;
+
+        return copy;
+}
+
+/*
  *      name: map_segment
  *   purpose: creates a new segment with the number of words equal to the value
- *            specified. Each word in the new segment is initialized to 0. 
- *            the new segment identifier is placed in register b. 
- *    inputs:              rb - register b 
- *                  num_words - number of words to have in the new segment
- *                  registers - the array containing the registers
- *                   segments - the sequence containing the segments
- *          unmapped_segments - the sequence containing the segments that have 
- *                              been unmapped
- *                   next_seg - the identifier of the next segment that has 
- *                              never been mapped to
- *   outputs: none
- *    errors: throws a CRE if registers, segments, unmapped_segments, or 
- *            next_seg is null
+ *            specified. Each word in the new segment is initialized to 0.
+ *    inputs:       num_words - number of words to have in the new segment
+ *                     seg_id - where to store the new segment identifier,
+ *                              to be placed in register b
+ *                   segments - the segmented memory
+ *   outputs: false if every segment identifier is now in use, true otherwise
+ *    errors: throws a CRE if seg_id or segments is NULL
  */
-void map_segment(unsigned rb, unsigned num_words, uint64_t *registers, 
-                Seq_T segments, Seq_T unmapped_segments, int *next_seg)
+bool map_segment(unsigned num_words, uint32_t *seg_id, Segments_T segments)
 {
-        assert(registers != NULL);
+        assert(seg_id != NULL);
         assert(segments != NULL);
-        assert(unmapped_segments != NULL);
-        assert(next_seg != NULL);
-        
-        UArray_T new_seg = UArray_new(num_words, sizeof(uint64_t));
-
-        /* initialize elements to 0 */
-        for (unsigned i = 0; i < num_words; i++) {
-                *(uint64_t *)UArray_at(new_seg, i) = 0;
-        }
-        
 
-        if (Seq_length(unmapped_segments) == 0) { /* map to a new segment */
-                Seq_addhi(segments, new_seg);
-                registers[rb] = *next_seg;
-                (*next_seg)++;
+        uint32_t *new_seg = segment_new(segments->pool, num_words);
+        PROFILE_MAP(num_words);
+
+        if (segments->num_free == 0) { /* map to a new segment */
+                if (segments->next_id == segments->capacity) {
+                        segments->capacity *= 2;
+                        RESIZE(segments->table,
+                               (long)segments->capacity * sizeof(uint32_t *));
+                }
+                segments->table[segments->next_id] = new_seg;
+                *seg_id = segments->next_id;
+                segments->next_id++;
         } else { /* reuse an unmapped segment */
-                uint64_t new_id = (uintptr_t)Seq_remlo(unmapped_segments);
-                Seq_put(segments, new_id, new_seg);
-                registers[rb] = new_id;
+                uint32_t new_id = segments->free_ids[--segments->num_free];
+                segments->table[new_id] = new_seg;
+                *seg_id = new_id;
         }
+
+        /* Make sure memory resources haven't been exhausted */
+        return segments->next_id < UINT32_MAX;
 }
 
-/* 
+/*
  *      name: unmap_segment
  *   purpose: Unmap a given segment in register c. After the register is
- *            unmapped, the identifier is placed into the unmapped_segments
- *            sequence so that it can be reused for future map segment
+ *            unmapped, the identifier is pushed onto the free identifier
+ *            stack so that it can be reused for future map segment
  *            instructions
- *    inputs:          seg_id - the identifier of the segment to unmap
- *                   segments - the sequence of segments 
- *          unmapped_segments - the sequence of segments that have been 
- *                              unmapped
+ *    inputs:   seg_id - the identifier of the segment to unmap
+ *            segments - the segmented memory
  *   outputs: none
  *    errors: unchecked runtime error if instruction unmaps either $m[0] or a
- *            segment that is not mapped; throws a CRE if segments or
- *            unmapped_segments are NULL
+ *            segment that is not mapped
  *            raises a CRE if segments is NULL
  */
-void unmap_segment(unsigned seg_id, Seq_T segments, Seq_T unmapped_segments)
+void unmap_segment(unsigned seg_id, Segments_T segments)
 {
         assert(segments != NULL);
-        assert(unmapped_segments != NULL);
 
-        UArray_T seg = Seq_get(segments, seg_id);
-        
-        UArray_free(&seg);
+        segment_free(segments->pool, segments->table[seg_id]);
+        segments->table[seg_id] = NULL;
+        PROFILE_UNMAP();
 
-        /* set segment to NULL and add to unmapped segments */
-        Seq_put(segments, seg_id, NULL);
-        Seq_addlo(unmapped_segments, (void *)(uintptr_t)seg_id);
+        if (segments->num_free == segments->free_capacity) {
+                segments->free_capacity *= 2;
+                RESIZE(segments->free_ids,
+                       (long)segments->free_capacity * sizeof(uint32_t));
+        }
+        segments->free_ids[segments->num_free++] = seg_id;
 }
 
-/* 
+/*
  *      name: load_program
- *   purpose: duplicates the value in register b and replaces segment 0, which
- *            holds the instructions to execute the program.
+ *   purpose: replaces segment 0, which holds the instructions to execute the
+ *            program, with a duplicate of the segment in register b. The
+ *            duplicate shares the source segment's words until either one
+ *            is written, so this is O(1) regardless of the segment's size.
  *    inputs:   seg_id - the identifier of the segment to duplicate
- *            segments - the sequence of segments
- *   outputs: none
+ *            segments - the segmented memory
+ *   outputs: true if segment 0 changed, false if it already held the same
+ *            words (seg_id is 0, or the segment was loaded before and
+ *            neither copy has been written since)
  *    errors: unchecked runtime error if an instruction loads a program from a
  *            segment that is not mapped
  *            raises a CRE if segments is NULL
  */
-void load_program(unsigned seg_id, Seq_T segments)
+bool load_program(unsigned seg_id, Segments_T segments)
 {
         assert(segments != NULL);
 
-        if (seg_id != 0) {
-                /* duplicate value in register b */
-                UArray_T to_copy = Seq_get(segments, seg_id);
-                UArray_T copy = UArray_copy(to_copy, UArray_length(to_copy));
-                
-                /* replace segment 0 and free heap-allocated memory */
-                UArray_T seg0 = Seq_get(segments, 0);
-                UArray_free(&seg0);
-                Seq_put(segments, 0, copy);
+        uint32_t *source = segments->table[seg_id];
+        if (source == segments->table[0]) {
+                PROFILE_LOAD(false, segment_length(source));
+                return false;
         }
-}
 
-/* 
- *      name: segmented_load
- *   purpose: stores the value with the given segment identifier and offset 
- *            into register a
- *    inputs:        ra - register a
- *               seg_id - segment identifier of the desired value
- *               offset - word offset of the desired value
- *            registers - the array containing the registers 
- *             segments - the sequence containing the segments
- *   outputs: none
- *    errors: URE if the segment with the given identifier is unmapped 
- *            URE if the offset is outside the bounds of the mapped segment 
- *            CRE if segments or registers is NULL
- */
-void segmented_load(unsigned ra, unsigned seg_id, unsigned offset, 
-                    uint64_t *registers, Seq_T segments)
-{
-        assert(registers != NULL);
-        assert(segments != NULL);
+        /* share the source's words, dropping segment 0's old ones */
+        (*segment_refs(source))++;
+        segment_free(segments->pool, segments->table[0]);
+        segments->table[0] = source;
+        PROFILE_LOAD(true, segment_length(source));
 
-        UArray_T seg = Seq_get(segments, seg_id);
-        registers[ra] = *(uint64_t *)UArray_at(seg, offset);
+        return true;
 }
-
-/* 
- *      name: segmented_store
- *   purpose: stores the given value at place with the given segment identifier
- *            and offset
- *    inputs:   seg_id - segment identifier of the desired location 
- *              offset - word offset of the desired location
- *               value - value to be stored
- *            segments - sequence of segments 
- *   outputs: none
- *    errors: URE if the segmented store refers to an unmapped segment
- *            URE if the segmented store refers to a location outside the bounds
- *            of a mapped segment
- *            CRE if segments is NULL
- */
-void segmented_store(unsigned seg_id, unsigned offset, unsigned value, 
-                        Seq_T segments)
-{
-        assert(segments != NULL);
-        
-        UArray_T seg = Seq_get(segments, seg_id);
-        *(uint64_t *)UArray_at(seg, offset) = value;
-}
\ No newline at end of file
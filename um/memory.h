@@ -1,28 +1,161 @@
 /* memory.h
  * by Alyssa Williams (awilli36) and Olivia Byun (obyun01)
  * 11/21/22
- * 
- * This is the interface for our memory module, which handles UM operations 
+ *
+ * This is the interface for our memory module, which handles UM operations
  * related to memory. Functionality includes mapping and unmapping segments,
  * loading a program, and segmented loading/storing.
+ *
+ * Segmented memory is a dense table from segment identifier to an array of
+ * 32-bit words. Each word array is prefixed by a two-word header: the word
+ * just before element 0 holds the number of words in the segment, and the
+ * one before that counts the identifiers the array is mapped under. Load
+ * program shares the source segment's array with segment 0 instead of
+ * copying it; the first segmented store to either identifier gives that
+ * identifier its own copy (copy-on-write). Unmapped identifiers
+ * are kept on a stack so they can be handed out again in O(1). Word arrays
+ * come from a size-class pool, so unmapped segments are recycled by later
+ * map segment instructions without going through malloc and free.
  */
 
 #ifndef MEMORY_H
 #define MEMORY_H
 
-#include "seq.h"
+#include <stdbool.h>
 #include <stdint.h>
+#include "pool.h"
 
+typedef struct Segments *Segments_T;
 
-void map_segment(unsigned seg_id, unsigned num_words, uint64_t *registers, 
-                Seq_T segments, Seq_T unmapped_segments, int *next_seg);
-void unmap_segment(unsigned seg_id, Seq_T segments, Seq_T unmapped_segments);
+/*
+ * purpose: the segmented memory of the UM
+ * members:         table - segment identifier -> words (NULL if unmapped)
+ *               capacity - number of slots in table
+ *                next_id - the lowest identifier that has never been mapped
+ *               free_ids - stack of identifiers that have been unmapped
+ *               num_free - number of identifiers on the free_ids stack
+ *          free_capacity - number of slots in free_ids
+ *                   pool - allocator for the word arrays
+ */
+struct Segments {
+        uint32_t **table;
+        uint32_t capacity;
+        uint32_t next_id;
+        uint32_t *free_ids;
+        uint32_t num_free;
+        uint32_t free_capacity;
+        Pool_T pool;
+};
+
+Segments_T Segments_new(uint32_t seg0_words);
+void Segments_free(Segments_T *segments);
+
+uint32_t *segment_new(Pool_T pool, uint32_t num_words);
+void segment_free(Pool_T pool, uint32_t *words);
+
+uint32_t *segment_unshare(Segments_T segments, unsigned seg_id);
+
+/* words in front of element 0: reference count, then length */
+#define SEGMENT_HEADER 2
+
+/*
+ *      name: segment_length
+ *   purpose: returns the number of words in a segment
+ *    inputs: words - the segment's word array
+ *   outputs: the number of words in the segment
+ *    errors: none
+ */
+static inline uint32_t segment_length(const uint32_t *words)
+{
+        return words[-1];
+}
+
+/*
+ *      name: segment_refs
+ *   purpose: returns a pointer to the count of identifiers a segment's word
+ *            array is mapped under
+ *    inputs: words - the segment's word array
+ *   outputs: pointer to the reference count
+ *    errors: none
+ */
+static inline uint32_t *segment_refs(uint32_t *words)
+{
+        return &words[-2];
+}
 
-void load_program(unsigned seg_id, Seq_T segments);
+/*
+ *      name: segment_mapped
+ *   purpose: tells whether a segment identifier is mapped; used by the
+ *            checked build
+ *    inputs:   seg_id - the segment identifier
+ *            segments - the segmented memory
+ *   outputs: true if seg_id is mapped, false otherwise
+ *    errors: none
+ */
+static inline bool segment_mapped(uint32_t seg_id, Segments_T segments)
+{
+        return seg_id < segments->next_id && segments->table[seg_id] != NULL;
+}
+
+/*
+ *      name: segment_in_bounds
+ *   purpose: tells whether an offset is inside a mapped segment; used by
+ *            the checked build
+ *    inputs:   seg_id - the segment identifier, which must be mapped
+ *              offset - the word offset
+ *            segments - the segmented memory
+ *   outputs: true if offset is less than the segment's length
+ *    errors: none
+ */
+static inline bool segment_in_bounds(uint32_t seg_id, uint32_t offset,
+                                     Segments_T segments)
+{
+        return offset < segment_length(segments->table[seg_id]);
+}
+
+bool map_segment(unsigned num_words, uint32_t *seg_id, Segments_T segments);
+void unmap_segment(unsigned seg_id, Segments_T segments);
+
+bool load_program(unsigned seg_id, Segments_T segments);
+
+/*
+ *      name: segmented_load
+ *   purpose: returns the value with the given segment identifier and offset
+ *    inputs:   seg_id - segment identifier of the desired value
+ *              offset - word offset of the desired value
+ *            segments - the segmented memory
+ *   outputs: the value, to be stored in register a
+ *    errors: URE if the segment with the given identifier is unmapped
+ *            URE if the offset is outside the bounds of the mapped segment
+ */
+static inline uint32_t segmented_load(unsigned seg_id, unsigned offset,
+                                      Segments_T segments)
+{
+        return segments->table[seg_id][offset];
+}
+
+/*
+ *      name: segmented_store
+ *   purpose: stores the given value at place with the given segment identifier
+ *            and offset
+ *    inputs:   seg_id - segment identifier of the desired location
+ *              offset - word offset of the desired location
+ *               value - value to be stored
+ *            segments - the segmented memory
+ *   outputs: none
+ *    errors: URE if the segmented store refers to an unmapped segment
+ *            URE if the segmented store refers to a location outside the bounds
+ *            of a mapped segment
+ */
+static inline void segmented_store(unsigned seg_id, unsigned offset,
+                                   unsigned value, Segments_T segments)
+{
+        uint32_t *words = segments->table[seg_id];
 
-void segmented_load(unsigned ra, unsigned seg_id, unsigned offset, 
-                        uint64_t *registers, Seq_T segments);
-void segmented_store(unsigned seg_id, unsigned offset, unsigned value, 
-                        Seq_T segments);
+        if (*segment_refs(words) != 1) { /* shared with segment 0 */
+                words = segment_unshare(segments, seg_id);
+        }
+        words[offset] = value;
+}
 
-#endif 
\ No newline at end of file
+#endif
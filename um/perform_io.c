@@ -1,46 +1,271 @@
 /* perform_io.c
  * by Alyssa Williams (awilli36) and Olivia Byun (obyun01)
  * 11/21/22
- * 
+ *
  * This is the implementation for our perform_io module, which handles UM
  * operations related to file I/O (input and output).
+ *
+ * Each machine has its own I/O device. Output goes into a private buffer that
+ * is written when it fills, when an input instruction has to wait for more
+ * input (so a prompt is visible before the program waits for an answer), and
+ * when the device is freed. Input comes from a private buffer refilled with
+ * large reads, or, when the input is a regular file, straight from a
+ * read-only mapping of the file, whose offset is moved past the input used
+ * when the device is freed. When the device replays a trace, input
+ * comes from the trace instead. The module keeps no state outside the
+ * devices, so machines in different threads never share anything here.
  */
 
 #include <stdio.h>
+#include <stdbool.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #include "perform_io.h"
 #include "assert.h"
+#include "mem.h"
 
-/* 
+#define IO_BUFFER (64 * 1024) /* bytes in each of the I/O buffers */
+
+/*
+ * purpose: the I/O device of one machine
+ * members:       in_fd - the file descriptor input is read from, or -1
+ *               out_fd - the file descriptor output is written to
+ *             out_used - bytes waiting in out_buffer
+ *              in_next - next byte of input
+ *               in_end - end of the input available
+ *               in_map - mapping of the input file, or NULL
+ *          in_map_size - bytes in in_map
+ *               record - the trace to record input values to, or NULL
+ *               replay - the trace to take input values from, or NULL
+ *               inputs - input instructions executed with this device
+ *           out_buffer - output not yet written
+ *            in_buffer - input read but not yet used, unless in_map is set
+ */
+struct Io {
+        int in_fd;
+        int out_fd;
+        size_t out_used;
+        const unsigned char *in_next;
+        const unsigned char *in_end;
+        void *in_map;
+        size_t in_map_size;
+        Trace_T record;
+        Trace_T replay;
+        uint64_t inputs;
+        unsigned char out_buffer[IO_BUFFER];
+        unsigned char in_buffer[IO_BUFFER];
+};
+
+/*
+ *      name: Io_new
+ *   purpose: creates an I/O device, mapping the input if it is a regular
+ *            file
+ *    inputs:  in_fd - the file descriptor to read input from, or -1 for
+ *                     input that is always at its end
+ *            out_fd - the file descriptor to write output to
+ *   outputs: the new device, to be freed with Io_free
+ *    errors: CRE if the device cannot be allocated; if the input cannot be
+ *            mapped it is read instead
+ */
+Io_T Io_new(int in_fd, int out_fd)
+{
+        Io_T io;
+        NEW(io);
+        struct stat st;
+
+        io->in_fd = in_fd;
+        io->out_fd = out_fd;
+        io->out_used = 0;
+        io->in_next = io->in_end = io->in_buffer;
+        io->in_map = NULL;
+        io->in_map_size = 0;
+        io->record = NULL;
+        io->replay = NULL;
+        io->inputs = 0;
+
+        if (in_fd < 0 || fstat(in_fd, &st) != 0 || !S_ISREG(st.st_mode)) {
+                return io;
+        }
+        off_t offset = lseek(in_fd, 0, SEEK_CUR);
+        if (offset < 0 || offset >= st.st_size) {
+                return io;
+        }
+
+        void *map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, in_fd, 0);
+        if (map != MAP_FAILED) {
+                madvise(map, st.st_size, MADV_SEQUENTIAL);
+                io->in_map = map;
+                io->in_map_size = st.st_size;
+                io->in_next = (const unsigned char *)map + offset;
+                io->in_end = (const unsigned char *)map + st.st_size;
+        }
+        return io;
+}
+
+/*
+ *      name: flush_output
+ *   purpose: writes any buffered output
+ *    inputs: io - the I/O device
+ *   outputs: none
+ *    errors: CRE if io is NULL or the output cannot be written
+ */
+void flush_output(Io_T io)
+{
+        assert(io != NULL);
+        size_t written = 0;
+
+        while (written < io->out_used) {
+                ssize_t n = write(io->out_fd, io->out_buffer + written,
+                                  io->out_used - written);
+                if (n < 0 && errno == EINTR) {
+                        continue;
+                }
+                assert(n > 0);
+                written += n;
+        }
+        io->out_used = 0;
+}
+
+/*
+ *      name: Io_record
+ *   purpose: records the value of every input instruction from now on
+ *    inputs:    io - the I/O device
+ *            trace - the trace to record to, which outlives the device's
+ *                    use
+ *   outputs: none
+ *    errors: CRE if io or trace is NULL
+ */
+void Io_record(Io_T io, Trace_T trace)
+{
+        assert(io != NULL);
+        assert(trace != NULL);
+        io->record = trace;
+}
+
+/*
+ *      name: Io_replay
+ *   purpose: takes the value of every input instruction from a trace from
+ *            now on, instead of reading the input
+ *    inputs:    io - the I/O device
+ *            trace - the trace to replay, which outlives the device's use
+ *   outputs: none
+ *    errors: CRE if io or trace is NULL
+ */
+void Io_replay(Io_T io, Trace_T trace)
+{
+        assert(io != NULL);
+        assert(trace != NULL);
+        io->replay = trace;
+}
+
+/*
+ *      name: Io_inputs
+ *   purpose: tells how many input instructions have used the device
+ *    inputs: io - the I/O device
+ *   outputs: the count
+ *    errors: CRE if io is NULL
+ */
+uint64_t Io_inputs(Io_T io)
+{
+        assert(io != NULL);
+        return io->inputs;
+}
+
+/*
+ *      name: Io_free
+ *   purpose: writes any buffered output, releases the input's mapping and
+ *            frees the device. The file descriptors are left open; a mapped
+ *            input's file offset is moved past the bytes the machine used,
+ *            as if it had read them, so later readers of the descriptor see
+ *            the rest.
+ *    inputs: io - pointer to the device, set to NULL
+ *   outputs: none
+ *    errors: CRE if io or *io is NULL or the output cannot be written
+ */
+void Io_free(Io_T *io)
+{
+        assert(io != NULL && *io != NULL);
+
+        flush_output(*io);
+        if ((*io)->in_map != NULL) {
+                const unsigned char *start = (*io)->in_map;
+                lseek((*io)->in_fd, (*io)->in_next - start, SEEK_SET);
+                munmap((*io)->in_map, (*io)->in_map_size);
+        }
+        FREE(*io);
+}
+
+/*
  *      name: output
  *   purpose: outputs value in register c to the I/O device
- *    inputs: value - the value in register c to be outputted
+ *    inputs:    io - the I/O device
+ *            value - the value in register c to be outputted
  *   outputs: none
  *    errors: unchecked runtime error if value is not in the range [0, 255]
+ *            CRE if the buffer fills and the output cannot be written
  */
-void output(unsigned value)
+void output(Io_T io, unsigned value)
 {
-        fputc(value, stdout);
+        io->out_buffer[io->out_used++] = value;
+        if (io->out_used == IO_BUFFER) {
+                flush_output(io);
+        }
 }
 
-/* 
+/*
+ *      name: fill_input
+ *   purpose: reads more input into the input buffer, first writing any
+ *            buffered output since the read may wait
+ *    inputs: io - the I/O device
+ *   outputs: false at end of input, true otherwise
+ *    errors: CRE if the input cannot be read
+ */
+static bool fill_input(Io_T io)
+{
+        if (io->in_map != NULL || io->in_fd < 0) {
+                return false; /* mapped input is all there; -1 has none */
+        }
+
+        flush_output(io);
+
+        ssize_t n;
+        do {
+                n = read(io->in_fd, io->in_buffer, IO_BUFFER);
+        } while (n < 0 && errno == EINTR);
+        assert(n >= 0);
+
+        io->in_next = io->in_buffer;
+        io->in_end = io->in_buffer + n;
+        return n > 0;
+}
+
+/*
  *      name: input
- *   purpose: obtains input from I/O device and loads register c with the input.
- *            If end of input has been signaled, register c is loaded with a 
- *            full 32-bit word where every bit is 1.
- *    inputs:     value - the value to be loaded into register c
- *            registers - the array containing the registers (uint64_t)
- *   outputs: none
- *    errors: CRE if registers equals NULL
+ *   purpose: obtains input from the I/O device. If end of input has been
+ *            signaled, the result is a full 32-bit word where every bit is 1.
+ *            Buffered output is written before waiting for input, so prompts
+ *            appear first. A replaying device returns the recorded value
+ *            instead, and a recording one records the value it returns.
+ *    inputs: io - the I/O device
+ *   outputs: the value to be loaded into register c
+ *    errors: CRE if the output, the input or the trace fails
  */
-void input(unsigned rc, uint64_t *registers)
+uint32_t input(Io_T io)
 {
-        assert(registers != NULL);
-        int value = fgetc(stdin);
+        uint32_t value;
 
-        if (value == EOF) {
-                uint32_t word = ~0;
-                registers[rc] = (int) word;
+        if (io->replay != NULL) {
+                value = Trace_replay_input(io->replay);
+        } else if (io->in_next == io->in_end && !fill_input(io)) {
+                value = ~(uint32_t)0;
         } else {
-                registers[rc] = value;
+                value = *io->in_next++;
+        }
+        if (io->record != NULL) {
+                Trace_record_input(io->record, value);
         }
-}
\ No newline at end of file
+        io->inputs++;
+        return value;
+}
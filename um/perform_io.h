@@ -3,7 +3,11 @@
  * 11/21/22
  * 
  * This is the interface for our perform_io module, which handles UM operations
- * related to file I/O (input and output).
+ * related to file I/O (input and output). Each machine gets its own I/O
+ * device from Io_new, reading from and writing to the file descriptors it is
+ * given; both directions are buffered, and Io_free writes what is left.
+ * A device can also record the values its input instructions return to a
+ * trace, or play them back from one instead of reading its input.
  */
 
 
@@ -11,8 +15,18 @@
 #define PERFORM_IO_H
 
 #include <stdint.h>
+#include "trace.h"
 
-void output(unsigned value);
-void input(unsigned rc, uint64_t *registers);
+typedef struct Io *Io_T;
 
-#endif
\ No newline at end of file
+Io_T Io_new(int in_fd, int out_fd);
+void Io_free(Io_T *io);
+void flush_output(Io_T io);
+void Io_record(Io_T io, Trace_T trace);
+void Io_replay(Io_T io, Trace_T trace);
+uint64_t Io_inputs(Io_T io);
+
+void output(Io_T io, unsigned value);
+uint32_t input(Io_T io);
+
+#endif
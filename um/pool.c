@@ -0,0 +1,407 @@
+/* pool.c
+ * by Alyssa Williams (awilli36) and Olivia Byun (obyun01)
+ * 11/21/22
+ *
+ * This is the implementation for our pool module, a size-class allocator for
+ * the blocks that back UM segments.
+ *
+ * Size classes are 8 bytes apart up to 256 bytes, then four classes per
+ * power of two up to 64KB, which keeps the space wasted by rounding under a
+ * quarter of the block. Each class has a singly linked free list threaded
+ * through the freed blocks themselves. New blocks are carved from 1MB chunks
+ * that come from calloc, so they are already zero; a reused block is cleared
+ * with memset, whose vector stores beat an inline loop (which gcc turns into
+ * rep stos) at every class size.
+ *
+ * Blocks bigger than the largest class are mmapped anonymously, so they
+ * start out as the kernel's shared zero page and a page is only zeroed when
+ * it is first touched: allocating one costs the same whatever its size.
+ * (calloc does not promise this, since glibc serves blocks under its
+ * adaptive mmap threshold from the heap and clears them with memset.) Huge
+ * blocks, 2MB and up, are also aligned to 2MB and rounded up to a multiple
+ * of it, and marked MADV_HUGEPAGE so the kernel backs them with huge pages
+ * where it can. Freeing a mapped block does MADV_DONTNEED, which returns the
+ * memory and makes the pages read as zero again, and keeps the mapping in a
+ * small cache: the next request of the same size reuses it without another
+ * mmap. With NUMA placement on, each huge block is bound (preferred, not
+ * strict) to the node of the CPU the allocating thread is running on.
+ */
+
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include "pool.h"
+#include "assert.h"
+#include "mem.h"
+
+#define SMALL_LIMIT 256            /* classes are 8 bytes apart up to here */
+#define LARGE_LIMIT (64 * 1024)    /* bigger requests bypass the pool */
+#define NUM_CLASSES 64
+#define CHUNK_SIZE (1024 * 1024)   /* bytes of arena memory per chunk */
+#define HUGE_PAGE (2 * 1024 * 1024) /* requests this big get a mapping */
+#define MAP_PAGE 4096              /* mapped blocks are rounded up to this */
+#define MAP_CACHE 8                /* freed mappings kept for reuse */
+#define MPOL_PREFERRED 1           /* from <numaif.h>, which may be absent */
+
+/* keeps the mapping paths out of Pool_alloc and Pool_free: inlined, they make
+   the free-list path save and restore every callee-saved register */
+#define COLD __attribute__((noinline))
+
+/*
+ * purpose: a freed block on a free list, or an arena chunk on the chunk list
+ * members: next - the next entry in the list
+ */
+struct Link {
+        struct Link *next;
+};
+
+/*
+ * purpose: a freed mapping kept for reuse. Its memory has been given
+ *          back, so nothing is stored inside it.
+ * members: base - the start of the mapping
+ *          size - its size, from map_size
+ */
+struct Mapping {
+        void *base;
+        size_t size;
+};
+
+/*
+ * purpose: the allocator state
+ * members:        free - the free list for each size class
+ *               chunks - every arena chunk, so they can be released together
+ *          avail/limit - the unused part of the current chunk
+ *               mapped - freed mappings, and num_mapped how many
+ *                 numa - true to place huge blocks on the allocating
+ *                        thread's NUMA node
+ *                stats - hit/miss counters and byte totals
+ */
+struct Pool_T {
+        struct Link *free[NUM_CLASSES];
+        struct Link *chunks;
+        char *avail;
+        char *limit;
+        struct Mapping mapped[MAP_CACHE];
+        unsigned num_mapped;
+        bool numa;
+        struct Pool_stats stats;
+};
+
+/*
+ *      name: size_class
+ *   purpose: finds the size class that serves a request
+ *    inputs:     nbytes - the number of bytes requested, at most LARGE_LIMIT
+ *            class_size - set to the number of bytes in a block of the class
+ *   outputs: the index of the size class
+ *    errors: none
+ */
+static inline unsigned size_class(size_t nbytes, size_t *class_size)
+{
+        if (nbytes <= SMALL_LIMIT) {
+                unsigned index = nbytes <= 8 ? 0 : (nbytes - 1) / 8;
+                *class_size = (size_t)(index + 1) * 8;
+                return index;
+        }
+
+        /* 2^power < nbytes <= 2^(power + 1), split into four steps */
+        unsigned power = 63 - __builtin_clzll(nbytes - 1);
+        size_t step = (size_t)1 << (power - 2);
+        unsigned quarter = (nbytes - 1 - ((size_t)1 << power)) / step;
+
+        *class_size = ((size_t)1 << power) + (quarter + 1) * step;
+        return SMALL_LIMIT / 8 + (power - 8) * 4 + quarter;
+}
+
+/*
+ *      name: map_size
+ *   purpose: rounds a request too big for the size classes up to the size
+ *            of the mapping that serves it: whole huge pages for a huge
+ *            request, whole pages otherwise
+ *    inputs: nbytes - the number of bytes requested
+ *   outputs: the size of the mapping
+ *    errors: none
+ */
+static inline size_t map_size(size_t nbytes)
+{
+        size_t page = nbytes >= HUGE_PAGE ? HUGE_PAGE : MAP_PAGE;
+        return (nbytes + page - 1) & ~(page - 1);
+}
+
+/*
+ *      name: bind_local
+ *   purpose: asks the kernel to take a mapping's pages from the NUMA node of
+ *            the CPU the calling thread is running on. This is a preference,
+ *            not a requirement, and quietly does nothing where NUMA policy
+ *            is not supported.
+ *    inputs: base - the mapping
+ *            size - its size
+ *   outputs: none
+ *    errors: none
+ */
+static void bind_local(void *base, size_t size)
+{
+#if defined(SYS_getcpu) && defined(SYS_mbind)
+        unsigned cpu, node;
+        if (syscall(SYS_getcpu, &cpu, &node, NULL) != 0 ||
+            node >= 8 * sizeof(unsigned long)) {
+                return;
+        }
+        unsigned long nodemask = 1UL << node;
+        syscall(SYS_mbind, base, size, MPOL_PREFERRED, &nodemask,
+                8 * sizeof(nodemask), 0);
+#else
+        (void)base;
+        (void)size;
+#endif
+}
+
+/*
+ *      name: map_alloc
+ *   purpose: allocates a block too big for the size classes: a freed
+ *            mapping of the same size if there is one, or a new one, aligned
+ *            to HUGE_PAGE if the block is huge
+ *    inputs:   pool - the pool
+ *            nbytes - the number of bytes needed
+ *   outputs: the block, which reads as zero
+ *    errors: CRE if the memory cannot be mapped
+ */
+static COLD void *map_alloc(Pool_T pool, size_t nbytes)
+{
+        size_t size = map_size(nbytes);
+        bool huge = nbytes >= HUGE_PAGE;
+        char *base = NULL;
+
+        pool->stats.large++;
+        pool->stats.huge += huge;
+        for (unsigned i = 0; i < pool->num_mapped; i++) {
+                if (pool->mapped[i].size == size) {
+                        base = pool->mapped[i].base;
+                        pool->mapped[i] = pool->mapped[--pool->num_mapped];
+                        pool->stats.reused++;
+                        break;
+                }
+        }
+
+        if (base == NULL && !huge) {
+                base = mmap(NULL, size, PROT_READ | PROT_WRITE,
+                            MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+                assert(base != MAP_FAILED);
+        } else if (base == NULL) {
+                /* over-allocate, then trim to a HUGE_PAGE boundary */
+                char *raw = mmap(NULL, size + HUGE_PAGE,
+                                 PROT_READ | PROT_WRITE,
+                                 MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+                assert(raw != MAP_FAILED);
+                uintptr_t misalign = (uintptr_t)raw & (HUGE_PAGE - 1);
+                size_t head = misalign == 0 ? 0 : HUGE_PAGE - misalign;
+                if (head > 0) {
+                        munmap(raw, head);
+                }
+                munmap(raw + head + size, HUGE_PAGE - head);
+                base = raw + head;
+#ifdef MADV_HUGEPAGE
+                madvise(base, size, MADV_HUGEPAGE);
+#endif
+        }
+        if (huge && pool->numa) {
+                bind_local(base, size);
+        }
+        return base;
+}
+
+/*
+ *      name: map_free
+ *   purpose: gives a mapped block's memory back to the kernel, keeping the
+ *            mapping for reuse if there is room in the cache
+ *    inputs:   pool - the pool
+ *               ptr - the block
+ *            nbytes - the size it was allocated with
+ *   outputs: none
+ *    errors: none
+ */
+static COLD void map_free(Pool_T pool, void *ptr, size_t nbytes)
+{
+        size_t size = map_size(nbytes);
+
+        if (pool->num_mapped == MAP_CACHE) {
+                munmap(ptr, size);
+                return;
+        }
+        madvise(ptr, size, MADV_DONTNEED);
+        pool->mapped[pool->num_mapped].base = ptr;
+        pool->mapped[pool->num_mapped].size = size;
+        pool->num_mapped++;
+}
+
+/*
+ *      name: Pool_new
+ *   purpose: creates an empty pool
+ *    inputs: none
+ *   outputs: the new pool, to be released with Pool_dispose
+ *    errors: CRE if memory cannot be allocated
+ */
+Pool_T Pool_new(void)
+{
+        Pool_T pool;
+        NEW0(pool);
+        return pool;
+}
+
+/*
+ *      name: Pool_dispose
+ *   purpose: releases the pool and all of its arena memory, including blocks
+ *            still handed out, and the mappings it kept. Blocks larger than
+ *            the biggest size class must already have been returned with
+ *            Pool_free.
+ *    inputs: pool - pointer to the pool to release
+ *   outputs: none
+ *    errors: CRE if pool or *pool is NULL
+ */
+void Pool_dispose(Pool_T *pool)
+{
+        assert(pool != NULL && *pool != NULL);
+
+        while ((*pool)->chunks != NULL) {
+                struct Link *chunk = (*pool)->chunks;
+                (*pool)->chunks = chunk->next;
+                FREE(chunk);
+        }
+        for (unsigned i = 0; i < (*pool)->num_mapped; i++) {
+                munmap((*pool)->mapped[i].base, (*pool)->mapped[i].size);
+        }
+        FREE(*pool);
+}
+
+/*
+ *      name: Pool_set_numa
+ *   purpose: chooses whether huge blocks are placed on the NUMA node of the
+ *            thread that allocates them
+ *    inputs:  pool - the pool
+ *            local - true to place them, false to leave it to the kernel
+ *   outputs: none
+ *    errors: CRE if pool is NULL
+ */
+void Pool_set_numa(Pool_T pool, bool local)
+{
+        assert(pool != NULL);
+        pool->numa = local;
+}
+
+/*
+ *      name: Pool_alloc
+ *   purpose: allocates a block of zeroed memory
+ *    inputs:   pool - the pool to allocate from
+ *            nbytes - the number of bytes needed
+ *   outputs: pointer to the block, aligned to 8 bytes
+ *    errors: CRE if pool is NULL or memory cannot be allocated
+ */
+void *Pool_alloc(Pool_T pool, size_t nbytes)
+{
+        assert(pool != NULL);
+
+        if (nbytes > LARGE_LIMIT) {
+                return map_alloc(pool, nbytes);
+        }
+
+        size_t class_size;
+        unsigned index = size_class(nbytes, &class_size);
+
+        /* reuse a freed block of the same class */
+        struct Link *block = pool->free[index];
+        if (block != NULL) {
+                pool->free[index] = block->next;
+                pool->stats.hits++;
+                pool->stats.bytes_retained -= class_size;
+                memset(block, 0, nbytes);
+                return block;
+        }
+
+        /* carve a new block out of the current chunk */
+        pool->stats.misses++;
+        if ((size_t)(pool->limit - pool->avail) < class_size) {
+                struct Link *chunk = CALLOC(1, CHUNK_SIZE);
+                chunk->next = pool->chunks;
+                pool->chunks = chunk;
+                pool->avail = (char *)(chunk + 1);
+                pool->limit = (char *)chunk + CHUNK_SIZE;
+                pool->stats.bytes_reserved += CHUNK_SIZE;
+        }
+        void *ptr = pool->avail;
+        pool->avail += class_size;
+        return ptr;
+}
+
+/*
+ *      name: Pool_free
+ *   purpose: returns a block to the pool so it can be handed out again
+ *    inputs:   pool - the pool the block came from
+ *               ptr - the block, from Pool_alloc
+ *            nbytes - the size passed to Pool_alloc for this block
+ *   outputs: none
+ *    errors: CRE if pool or ptr is NULL
+ */
+void Pool_free(Pool_T pool, void *ptr, size_t nbytes)
+{
+        assert(pool != NULL);
+        assert(ptr != NULL);
+
+        if (nbytes > LARGE_LIMIT) {
+                map_free(pool, ptr, nbytes);
+                return;
+        }
+
+        size_t class_size;
+        unsigned index = size_class(nbytes, &class_size);
+
+        struct Link *block = ptr;
+        block->next = pool->free[index];
+        pool->free[index] = block;
+        pool->stats.bytes_retained += class_size;
+}
+
+/*
+ *      name: Pool_get_stats
+ *   purpose: copies out the pool's counters
+ *    inputs:  pool - the pool
+ *            stats - where to store the counters
+ *   outputs: none
+ *    errors: CRE if pool or stats is NULL
+ */
+void Pool_get_stats(Pool_T pool, struct Pool_stats *stats)
+{
+        assert(pool != NULL);
+        assert(stats != NULL);
+
+        *stats = pool->stats;
+}
+
+/*
+ *      name: Pool_report
+ *   purpose: prints the pool's counters in a human-readable form
+ *    inputs: pool - the pool
+ *              fp - the stream to print to
+ *   outputs: none
+ *    errors: CRE if pool or fp is NULL
+ */
+void Pool_report(Pool_T pool, FILE *fp)
+{
+        assert(pool != NULL);
+        assert(fp != NULL);
+
+        struct Pool_stats *s = &pool->stats;
+        uint64_t pooled = s->hits + s->misses;
+
+        fprintf(fp, "pool: %llu hits, %llu misses (%.1f%% hit rate), "
+                "%llu large\n", (unsigned long long)s->hits,
+                (unsigned long long)s->misses,
+                pooled == 0 ? 0.0 : 100.0 * s->hits / pooled,
+                (unsigned long long)s->large);
+        fprintf(fp, "pool: %llu huge, %llu reused a freed mapping, "
+                "%u freed mappings kept\n", (unsigned long long)s->huge,
+                (unsigned long long)s->reused, pool->num_mapped);
+        fprintf(fp, "pool: %llu bytes retained on free lists, "
+                "%llu bytes reserved in arena chunks\n",
+                (unsigned long long)s->bytes_retained,
+                (unsigned long long)s->bytes_reserved);
+}
@@ -0,0 +1,63 @@
+/* pool.h
+ * by Alyssa Williams (awilli36) and Olivia Byun (obyun01)
+ * 11/21/22
+ *
+ * This is the interface for our pool module, a size-class allocator for the
+ * short-lived blocks that back UM segments. Small requests are rounded up to
+ * one of a fixed set of size classes and carved out of large arena chunks.
+ * Freed blocks go onto a free list for their class and are handed out again,
+ * zeroed, by the next request of that class, so programs that map and unmap
+ * many small segments rarely reach malloc or free. Requests bigger than the
+ * largest class get anonymous mappings of their own, which the kernel zeroes
+ * a page at a time as they are first touched, so a big segment costs the
+ * same to allocate whatever its size. Huge ones (2MB and up) are backed by
+ * transparent huge pages to spare the TLB, and can be placed on the NUMA
+ * node of the thread that asks for them. A freed mapping gives its memory
+ * back to the kernel but keeps its addresses for the next request of the
+ * same size.
+ *
+ * Following Hanson's Arena interface, Pool_dispose releases every block at
+ * once; Pool_free only returns a block to its free list.
+ */
+
+#ifndef POOL_H
+#define POOL_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+typedef struct Pool_T *Pool_T;
+
+/*
+ * purpose: counters describing how well the pool is serving requests
+ * members:           hits - allocations served from a free list
+ *                  misses - allocations carved from fresh arena memory
+ *                   large - allocations too big for any size class
+ *                    huge - large allocations given a huge-page mapping
+ *                  reused - large allocations that reused a freed mapping
+ *          bytes_retained - bytes currently sitting on free lists
+ *          bytes_reserved - bytes of arena memory obtained from malloc
+ */
+struct Pool_stats {
+        uint64_t hits;
+        uint64_t misses;
+        uint64_t large;
+        uint64_t huge;
+        uint64_t reused;
+        uint64_t bytes_retained;
+        uint64_t bytes_reserved;
+};
+
+Pool_T Pool_new(void);
+void Pool_dispose(Pool_T *pool);
+void Pool_set_numa(Pool_T pool, bool local);
+
+void *Pool_alloc(Pool_T pool, size_t nbytes);
+void Pool_free(Pool_T pool, void *ptr, size_t nbytes);
+
+void Pool_get_stats(Pool_T pool, struct Pool_stats *stats);
+void Pool_report(Pool_T pool, FILE *fp);
+
+#endif
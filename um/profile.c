@@ -0,0 +1,154 @@
+/* profile.c
+ * by Alyssa Williams (awilli36) and Olivia Byun (obyun01)
+ * 11/21/22
+ *
+ * This is the implementation for our profile module, which counts what a
+ * guest program does while it runs and prints a report when it halts. It is
+ * only part of the profiling build (make um-profile), which compiles every
+ * module with -DUM_PROFILE.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "profile.h"
+#include "fault.h"
+#include "memory.h"
+#include "assert.h"
+#include "mem.h"
+
+#define TOP_PCS 20 /* program counters listed in the report */
+
+struct Profile profile;
+
+/*
+ *      name: Profile_start
+ *   purpose: clears the counters and starts the clock
+ *    inputs: seg0_words - the length of segment 0
+ *   outputs: none
+ *    errors: CRE if the counters cannot be allocated
+ */
+void Profile_start(uint32_t seg0_words)
+{
+        FREE(profile.pc_counts);
+        memset(&profile, 0, sizeof(profile));
+        Profile_program(seg0_words);
+        clock_gettime(CLOCK_MONOTONIC, &profile.start);
+}
+
+/*
+ *      name: Profile_program
+ *   purpose: makes room for a counter for every offset of a new segment 0.
+ *            Counts are kept by offset, so offsets shared by several
+ *            programs accumulate the counts of all of them.
+ *    inputs: seg0_words - the length of the new segment 0
+ *   outputs: none
+ *    errors: CRE if the counters cannot be allocated
+ */
+void Profile_program(uint32_t seg0_words)
+{
+        /* one more for the end of segment 0, where the machine stops */
+        uint64_t needed = (uint64_t)seg0_words + 1;
+        if (needed <= profile.pc_capacity) {
+                return;
+        }
+
+        RESIZE(profile.pc_counts, (long)needed * sizeof(uint64_t));
+        memset(profile.pc_counts + profile.pc_capacity, 0,
+               (needed - profile.pc_capacity) * sizeof(uint64_t));
+        profile.pc_capacity = needed;
+}
+
+/*
+ *      name: compare_counts
+ *   purpose: orders program counters by descending execution count, then by
+ *            ascending offset, for qsort
+ *    inputs: a, b - pointers to the program counters to compare
+ *   outputs: negative, zero, or positive like strcmp
+ *    errors: none
+ */
+static int compare_counts(const void *a, const void *b)
+{
+        uint32_t pa = *(const uint32_t *)a;
+        uint32_t pb = *(const uint32_t *)b;
+        uint64_t ca = profile.pc_counts[pa];
+        uint64_t cb = profile.pc_counts[pb];
+
+        if (ca != cb) {
+                return ca > cb ? -1 : 1;
+        }
+        return pa < pb ? -1 : pa > pb;
+}
+
+/*
+ *      name: Profile_report
+ *   purpose: prints the opcode mix, segment and load program counts,
+ *            instructions per second, and the hottest program counters
+ *    inputs:   fp - the stream to print to
+ *            seg0 - segment 0 when the machine halted, used to show the
+ *                   instruction at each hot program counter
+ *   outputs: none
+ *    errors: CRE if fp or seg0 is NULL
+ */
+void Profile_report(FILE *fp, const uint32_t *seg0)
+{
+        assert(fp != NULL);
+        assert(seg0 != NULL);
+
+        struct timespec end;
+        clock_gettime(CLOCK_MONOTONIC, &end);
+        double seconds = (end.tv_sec - profile.start.tv_sec) +
+                         (end.tv_nsec - profile.start.tv_nsec) / 1e9;
+
+        uint64_t total = 0;
+        for (int op = 0; op < 16; op++) {
+                total += profile.op_counts[op];
+        }
+
+        fprintf(fp, "profile: %llu instructions in %.3f s (%.1f million/s)\n",
+                (unsigned long long)total, seconds,
+                seconds > 0 ? total / seconds / 1e6 : 0.0);
+        fprintf(fp, "profile: %llu maps (%llu words, peak %llu live), "
+                "%llu unmaps\n", (unsigned long long)profile.maps,
+                (unsigned long long)profile.words_mapped,
+                (unsigned long long)profile.live_peak,
+                (unsigned long long)profile.unmaps);
+        fprintf(fp, "profile: %llu load programs, %llu replaced segment 0\n",
+                (unsigned long long)profile.loads,
+                (unsigned long long)profile.loads_changed);
+        fprintf(fp, "profile: %llu words of segment 0 decoded\n",
+                (unsigned long long)profile.decoded);
+
+        fprintf(fp, "profile: opcode mix\n");
+        for (int op = 0; op < 16; op++) {
+                if (profile.op_counts[op] == 0) {
+                        continue;
+                }
+                fprintf(fp, "  %-6s %14llu  %5.1f%%\n", Um_op_names[op],
+                        (unsigned long long)profile.op_counts[op],
+                        100.0 * profile.op_counts[op] / total);
+        }
+
+        /* sort the program counters that ran by count */
+        uint32_t num_hot = 0;
+        uint32_t *hot = ALLOC(((long)profile.pc_capacity + 1) *
+                              sizeof(uint32_t));
+        for (uint32_t pc = 0; pc < profile.pc_capacity; pc++) {
+                if (profile.pc_counts[pc] != 0) {
+                        hot[num_hot++] = pc;
+                }
+        }
+        qsort(hot, num_hot, sizeof(uint32_t), compare_counts);
+
+        uint32_t length = segment_length(seg0);
+        fprintf(fp, "profile: top program counters\n");
+        for (uint32_t i = 0; i < num_hot && i < TOP_PCS; i++) {
+                uint32_t pc = hot[i];
+                const char *name = pc < length ? Um_op_names[seg0[pc] >> 28]
+                                               : "(end)";
+                fprintf(fp, "  %10u  %-6s %14llu  %5.1f%%\n", pc, name,
+                        (unsigned long long)profile.pc_counts[pc],
+                        100.0 * profile.pc_counts[pc] / total);
+        }
+
+        FREE(hot);
+}
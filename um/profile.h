@@ -0,0 +1,157 @@
+/* profile.h
+ * by Alyssa Williams (awilli36) and Olivia Byun (obyun01)
+ * 11/21/22
+ *
+ * This is the interface for our profile module, which counts what a guest
+ * program does while it runs: executions per program counter and per opcode,
+ * segments mapped and unmapped, load programs, and the words of segment 0
+ * the threaded engine decoded. A report sorted by the
+ * hottest program counters is printed when the machine halts.
+ *
+ * Profiling is chosen when the UM is compiled, not when it runs: building
+ * with -DUM_PROFILE (make um-profile) turns every PROFILE_* macro below into
+ * a counter update, and without it they expand to nothing, so the normal
+ * build carries no profiling code at all.
+ */
+
+#ifndef PROFILE_H
+#define PROFILE_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdbool.h>
+
+#ifdef UM_PROFILE
+
+#include <time.h>
+
+/*
+ * purpose: the counters gathered while a program runs
+ * members:     pc_counts - program counter -> times executed
+ *            pc_capacity - number of counters in pc_counts
+ *              op_counts - opcode -> times executed
+ *                   maps - map segment instructions executed
+ *            words_mapped - total words in the segments mapped
+ *                 unmaps - unmap segment instructions executed
+ *                live_now - segments mapped and not yet unmapped
+ *               live_peak - most segments mapped at once
+ *                  loads - load programs executed
+ *           loads_changed - load programs that replaced segment 0
+ *                 decoded - words of segment 0 the threaded engine decoded
+ *                   start - when the program started running
+ */
+struct Profile {
+        uint64_t *pc_counts;
+        uint32_t pc_capacity;
+        uint64_t op_counts[16];
+        uint64_t maps;
+        uint64_t words_mapped;
+        uint64_t unmaps;
+        uint64_t live_now;
+        uint64_t live_peak;
+        uint64_t loads;
+        uint64_t loads_changed;
+        uint64_t decoded;
+        struct timespec start;
+};
+
+extern struct Profile profile;
+
+void Profile_start(uint32_t seg0_words);
+void Profile_program(uint32_t seg0_words);
+void Profile_report(FILE *fp, const uint32_t *seg0);
+
+/*
+ *      name: Profile_step
+ *   purpose: counts one executed instruction
+ *    inputs: pc - the offset of the instruction in segment 0
+ *            op - the instruction's opcode
+ *   outputs: none
+ *    errors: none; pc must be less than the length passed to Profile_start
+ *            or Profile_program, plus one
+ */
+static inline void Profile_step(uint32_t pc, unsigned op)
+{
+        profile.pc_counts[pc]++;
+        profile.op_counts[op & 0xf]++;
+}
+
+/*
+ *      name: Profile_map
+ *   purpose: counts one map segment instruction
+ *    inputs: num_words - the size of the new segment
+ *   outputs: none
+ *    errors: none
+ */
+static inline void Profile_map(uint32_t num_words)
+{
+        profile.maps++;
+        profile.words_mapped += num_words;
+        if (++profile.live_now > profile.live_peak) {
+                profile.live_peak = profile.live_now;
+        }
+}
+
+/*
+ *      name: Profile_unmap
+ *   purpose: counts one unmap segment instruction
+ *    inputs: none
+ *   outputs: none
+ *    errors: none
+ */
+static inline void Profile_unmap(void)
+{
+        profile.unmaps++;
+        profile.live_now--;
+}
+
+/*
+ *      name: Profile_load
+ *   purpose: counts one load program instruction
+ *    inputs:    changed - true if it replaced segment 0
+ *            seg0_words - the length of segment 0 afterwards
+ *   outputs: none
+ *    errors: none
+ */
+static inline void Profile_load(bool changed, uint32_t seg0_words)
+{
+        profile.loads++;
+        if (changed) {
+                profile.loads_changed++;
+                Profile_program(seg0_words);
+        }
+}
+
+/*
+ *      name: Profile_decode
+ *   purpose: counts words of segment 0 decoded into instruction records
+ *    inputs: num_words - how many
+ *   outputs: none
+ *    errors: none
+ */
+static inline void Profile_decode(uint32_t num_words)
+{
+        profile.decoded += num_words;
+}
+
+#define PROFILE_START(seg0_words) Profile_start(seg0_words)
+#define PROFILE_STEP(pc, op) Profile_step((pc), (op))
+#define PROFILE_MAP(num_words) Profile_map(num_words)
+#define PROFILE_UNMAP() Profile_unmap()
+#define PROFILE_LOAD(changed, seg0_words) Profile_load((changed), (seg0_words))
+#define PROFILE_DECODE(num_words) Profile_decode(num_words)
+#define PROFILE_REPORT(fp, seg0) Profile_report((fp), (seg0))
+
+#else
+
+#define PROFILE_START(seg0_words) ((void)0)
+#define PROFILE_STEP(pc, op) ((void)0)
+#define PROFILE_MAP(num_words) ((void)0)
+#define PROFILE_UNMAP() ((void)0)
+#define PROFILE_LOAD(changed, seg0_words) ((void)0)
+#define PROFILE_DECODE(num_words) ((void)0)
+#define PROFILE_REPORT(fp, seg0) ((void)0)
+
+#endif
+
+#endif
@@ -2,17 +2,53 @@
 # Alyssa Williams (awilli36) and Olivia Byun (obyun01)
 # 11/21/22
 # This file contains a bash script to run all of our tests and diff them
-# from expected output.
+# from expected output. The tests run in parallel as one batch (um -b): each
+# test reads its .0 file as input if it has one and writes its output to .2.
+# Extra arguments are passed to um, e.g. "-t 4" or "-s".
+# The fault-*.um programs are left out of the batch, since the fast build
+# does not check them. If um-safe has been built, each is run under it on
+# the threaded and the switch (-s) engines, and must exit with status 1
+# after printing the report in its .fault file to stderr (written to .2).
+
+manifest=$(mktemp)
+testFiles=$(ls *.um | grep -v '^fault-')
+for testFile in $testFiles; do
+        testName=$(echo $testFile | sed -E 's/(.*).um/\1/')
+        if [ -f $testName.0 ] ; then
+                echo "$testFile $testName.0 $testName.2" >> $manifest
+        else
+                echo "$testFile - $testName.2" >> $manifest
+        fi
+done
+
+./um "$@" -b $manifest
+rm -f $manifest
 
-testFiles=$(ls *.um)
 for testFile in $testFiles; do
         testName=$(echo $testFile | sed -E 's/(.*).um/\1/')
-        ./um $testFile > $testName.2
-        # um $testFile > $testName.2
         if [ -f $testName.1 ] ; then
                 echo "lmao $testName"
                 diff $testName.1 $testName.2
         else
                 echo $testName "has no output!"
         fi
-done
\ No newline at end of file
+done
+
+faultFiles=$(ls fault-*.um)
+if [ ! -x ./um-safe ] ; then
+        echo "no um-safe: skipping the fault tests"
+        exit 0
+fi
+for testFile in $faultFiles; do
+        testName=$(echo $testFile | sed -E 's/(.*).um/\1/')
+        for engine in "" -s; do
+                echo "lmao $testName $engine"
+                ./um-safe $engine $testFile < /dev/null > /dev/null \
+                        2> $testName.2
+                status=$?
+                if [ $status -ne 1 ] ; then
+                        echo "$testName exited with status $status"
+                fi
+                diff $testName.fault $testName.2
+        done
+done
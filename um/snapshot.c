@@ -0,0 +1,268 @@
+/* snapshot.c
+ * by Alyssa Williams (awilli36) and Olivia Byun (obyun01)
+ * 11/21/22
+ *
+ * This is the implementation for our snapshot module, which saves and
+ * restores the complete state of a paused UM.
+ *
+ * A snapshot is a fixed header, the stack of unmapped identifiers, then one
+ * record per mapped segment in increasing identifier order (segment 0
+ * first): the identifier, the number of words, and the words. Everything is
+ * in the byte order of the machine that wrote it. Segments are written
+ * straight from segmented memory through a stdio buffer, so a snapshot of a
+ * machine using many gigabytes needs no extra memory to write. A snapshot is
+ * written under a temporary name and renamed into place, so a crash while
+ * writing leaves the previous snapshot intact. Restoring maps the file and
+ * copies each segment out of the mapping.
+ *
+ * Segments that share words after a load program are saved and restored as
+ * separate copies; the program cannot tell the difference.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "snapshot.h"
+#include "assert.h"
+#include "mem.h"
+
+#define SNAPSHOT_MAGIC "UMSNAP\r\n"
+#define SNAPSHOT_VERSION 3
+#define WRITE_BUFFER (1024 * 1024) /* bytes of stdio buffer when writing */
+
+/*
+ * purpose: the fixed part at the start of a snapshot
+ * members:      magic - SNAPSHOT_MAGIC, without its terminating NUL
+ *             version - SNAPSHOT_VERSION
+ *                  pc - the offset in segment 0 to resume at
+ *           registers - the eight registers
+ *               steps - instructions executed before the snapshot
+ *              inputs - input instructions executed before the snapshot
+ *             next_id - the lowest identifier that has never been mapped
+ *            num_free - identifiers on the unmapped stack
+ *          num_mapped - segment records that follow the stack
+ */
+struct Snapshot_header {
+        char magic[8];
+        uint32_t version;
+        uint32_t pc;
+        uint32_t registers[8];
+        uint64_t steps;
+        uint64_t inputs;
+        uint32_t next_id;
+        uint32_t num_free;
+        uint32_t num_mapped;
+        uint32_t unused;
+};
+
+/*
+ * purpose: the fixed part of a segment record
+ * members:     id - the segment identifier
+ *          length - the number of words that follow
+ */
+struct Snapshot_segment {
+        uint32_t id;
+        uint32_t length;
+};
+
+/*
+ *      name: write_all
+ *   purpose: writes a block to a snapshot being written
+ *    inputs:   fp - the snapshot stream
+ *            data - the bytes to write
+ *            size - the number of bytes
+ *   outputs: none
+ *    errors: CRE if the write fails
+ */
+static void write_all(FILE *fp, const void *data, size_t size)
+{
+        size_t written = fwrite(data, 1, size, fp);
+        assert(written == size);
+}
+
+/*
+ *      name: write_snapshot
+ *   purpose: saves the state of a paused machine to a file
+ *    inputs:      path - the file to write; replaced only once the new
+ *                        snapshot is complete
+ *            registers - the array containing the registers
+ *             segments - the segmented memory
+ *                  run - the paused run, whose pc is where to resume
+ *               inputs - input instructions executed so far, so a trace
+ *                        replay can resume with the machine
+ *   outputs: none
+ *    errors: CRE if any argument is NULL or the file cannot be written
+ */
+void write_snapshot(const char *path, const uint32_t *registers,
+                    Segments_T segments, const struct Um_run *run,
+                    uint64_t inputs)
+{
+        assert(path != NULL);
+        assert(registers != NULL);
+        assert(segments != NULL);
+        assert(run != NULL);
+
+        char *temp_path = ALLOC(strlen(path) + sizeof(".tmp"));
+        strcpy(temp_path, path);
+        strcat(temp_path, ".tmp");
+
+        FILE *fp = fopen(temp_path, "wb");
+        assert(fp != NULL);
+        setvbuf(fp, NULL, _IOFBF, WRITE_BUFFER);
+
+        struct Snapshot_header header;
+        memset(&header, 0, sizeof(header));
+        memcpy(header.magic, SNAPSHOT_MAGIC, sizeof(header.magic));
+        header.version = SNAPSHOT_VERSION;
+        header.pc = run->pc;
+        memcpy(header.registers, registers, sizeof(header.registers));
+        header.steps = run->steps;
+        header.inputs = inputs;
+        header.next_id = segments->next_id;
+        header.num_free = segments->num_free;
+        for (uint32_t id = 0; id < segments->next_id; id++) {
+                header.num_mapped += segments->table[id] != NULL;
+        }
+
+        write_all(fp, &header, sizeof(header));
+        write_all(fp, segments->free_ids,
+                  (size_t)segments->num_free * sizeof(uint32_t));
+
+        for (uint32_t id = 0; id < segments->next_id; id++) {
+                const uint32_t *words = segments->table[id];
+                if (words == NULL) {
+                        continue;
+                }
+                struct Snapshot_segment record = { id,
+                                                   segment_length(words) };
+                write_all(fp, &record, sizeof(record));
+                write_all(fp, words, (size_t)record.length *
+                                     sizeof(uint32_t));
+        }
+
+        int failed = fflush(fp) != 0;
+        failed |= fsync(fileno(fp)) != 0;
+        failed |= fclose(fp) != 0;
+        failed |= rename(temp_path, path) != 0;
+        assert(!failed);
+        FREE(temp_path);
+}
+
+/*
+ *      name: take
+ *   purpose: steps over the next part of a mapped snapshot
+ *    inputs: next - the next unread byte, advanced past the part
+ *             end - the end of the snapshot
+ *            size - the size of the part
+ *   outputs: the part
+ *    errors: CRE if the snapshot ends before the part does
+ */
+static const void *take(const char **next, const char *end, size_t size)
+{
+        assert((size_t)(end - *next) >= size);
+
+        const void *part = *next;
+        *next += size;
+        return part;
+}
+
+/*
+ *      name: read_snapshot
+ *   purpose: rebuilds a paused machine from a snapshot file
+ *    inputs:      path - the snapshot to read
+ *            registers - where to store the eight registers
+ *                  run - set up to resume where the snapshot was taken
+ *               inputs - where to store the input instructions executed
+ *                        before the snapshot
+ *   outputs: the segmented memory, to be freed with Segments_free
+ *    errors: CRE if any argument is NULL, or if the file cannot be read or
+ *            is not a well-formed snapshot
+ */
+Segments_T read_snapshot(const char *path, uint32_t *registers,
+                         struct Um_run *run, uint64_t *inputs)
+{
+        assert(path != NULL);
+        assert(registers != NULL);
+        assert(run != NULL);
+        assert(inputs != NULL);
+
+        int fd = open(path, O_RDONLY);
+        assert(fd >= 0);
+        struct stat st;
+        int status = fstat(fd, &st);
+        assert(status == 0);
+        assert((size_t)st.st_size >= sizeof(struct Snapshot_header));
+
+        void *image = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        assert(image != MAP_FAILED);
+        close(fd);
+        madvise(image, st.st_size, MADV_SEQUENTIAL);
+
+        const char *next = image;
+        const char *end = next + st.st_size;
+
+        struct Snapshot_header header;
+        memcpy(&header, take(&next, end, sizeof(header)), sizeof(header));
+        assert(memcmp(header.magic, SNAPSHOT_MAGIC,
+                      sizeof(header.magic)) == 0);
+        assert(header.version == SNAPSHOT_VERSION);
+        assert(header.num_mapped >= 1 && header.next_id >= 1);
+
+        memcpy(registers, header.registers, sizeof(header.registers));
+        run->pc = header.pc;
+        run->steps = header.steps;
+        *inputs = header.inputs;
+        run->paused = false;
+
+        const void *free_ids = take(&next, end, (size_t)header.num_free *
+                                                sizeof(uint32_t));
+
+        /* segment 0 comes first, sized by its record */
+        struct Snapshot_segment record;
+        memcpy(&record, take(&next, end, sizeof(record)), sizeof(record));
+        assert(record.id == 0);
+        Segments_T segments = Segments_new(record.length);
+        memcpy(segments->table[0],
+               take(&next, end, (size_t)record.length * sizeof(uint32_t)),
+               (size_t)record.length * sizeof(uint32_t));
+
+        /* make room for every identifier ever mapped and every free one */
+        if (segments->capacity < header.next_id) {
+                segments->capacity = header.next_id;
+                RESIZE(segments->table,
+                       (long)segments->capacity * sizeof(uint32_t *));
+        }
+        memset(segments->table + 1, 0,
+               ((size_t)segments->capacity - 1) * sizeof(uint32_t *));
+        segments->next_id = header.next_id;
+
+        if (segments->free_capacity < header.num_free) {
+                segments->free_capacity = header.num_free;
+                RESIZE(segments->free_ids,
+                       (long)segments->free_capacity * sizeof(uint32_t));
+        }
+        memcpy(segments->free_ids, free_ids,
+               (size_t)header.num_free * sizeof(uint32_t));
+        segments->num_free = header.num_free;
+
+        uint32_t last_id = 0;
+        for (uint32_t i = 1; i < header.num_mapped; i++) {
+                memcpy(&record, take(&next, end, sizeof(record)),
+                       sizeof(record));
+                assert(record.id > last_id && record.id < header.next_id);
+                last_id = record.id;
+
+                uint32_t *words = segment_new(segments->pool, record.length);
+                memcpy(words, take(&next, end, (size_t)record.length *
+                                               sizeof(uint32_t)),
+                       (size_t)record.length * sizeof(uint32_t));
+                segments->table[record.id] = words;
+        }
+        assert(next == end);
+
+        munmap(image, st.st_size);
+        return segments;
+}
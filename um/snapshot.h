@@ -0,0 +1,25 @@
+/* snapshot.h
+ * by Alyssa Williams (awilli36) and Olivia Byun (obyun01)
+ * 11/21/22
+ *
+ * This is the interface for our snapshot module, which saves the complete
+ * state of a paused UM (registers, program counter, instruction and input
+ * counts, every mapped segment, and the stack of unmapped identifiers) to a file, and
+ * rebuilds a machine from such a file so the program can carry on where it
+ * left off.
+ */
+
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include <stdint.h>
+#include "dispatch.h"
+#include "memory.h"
+
+void write_snapshot(const char *path, const uint32_t *registers,
+                    Segments_T segments, const struct Um_run *run,
+                    uint64_t inputs);
+Segments_T read_snapshot(const char *path, uint32_t *registers,
+                         struct Um_run *run, uint64_t *inputs);
+
+#endif
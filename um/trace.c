@@ -0,0 +1,648 @@
+/* trace.c
+ * by Alyssa Williams (awilli36) and Olivia Byun (obyun01)
+ * 11/21/22
+ *
+ * This is the implementation for our trace module, which records a UM run's
+ * input and checkpoints to a file and plays them back.
+ *
+ * A trace is a fixed header followed by records, each a tag byte and its
+ * operands; counts are unsigned LEB128 varints (7 bits a byte, low bits
+ * first):
+ *
+ *      'D' n byte...   n (1 to 255) input instructions returned these bytes
+ *      'E'             an input instruction returned end of input
+ *      'C' steps pc    after steps instructions the machine paused at pc
+ *      'H' steps       the machine stopped after steps instructions
+ *
+ * The header identifies the program by the length and a hash of segment 0
+ * when recording started, and says how many instructions and inputs the
+ * machine had already run then (nonzero when resuming a snapshot).
+ *
+ * While recording, records are appended to one of two buffers. When it
+ * fills, it is handed to a writer thread and the machine carries on with
+ * the other, so it only waits if the disk falls a whole buffer behind.
+ *
+ * A replay maps the trace and reads it with two cursors: one steps through
+ * the input records as input instructions run, the other through the
+ * checkpoints as the machine pauses.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "trace.h"
+#include "assert.h"
+#include "mem.h"
+
+#define TRACE_MAGIC "UMTRACE\n"
+#define TRACE_VERSION 1
+#define TRACE_BUFFER (1024 * 1024) /* bytes in each record buffer */
+#define MAX_RECORD 32              /* longest record but a 'D' */
+#define MAX_RUN 255                /* bytes in one 'D' record */
+
+/*
+ * purpose: the fixed part at the start of a trace
+ * members:        magic - TRACE_MAGIC, without its terminating NUL
+ *               version - TRACE_VERSION
+ *          program_size - words in segment 0 when recording started
+ *           start_steps - instructions executed before recording started
+ *          start_inputs - input instructions executed before then
+ *          program_hash - FNV-1a hash of segment 0 then
+ */
+struct Trace_header {
+        char magic[8];
+        uint32_t version;
+        uint32_t program_size;
+        uint64_t start_steps;
+        uint64_t start_inputs;
+        uint64_t program_hash;
+};
+
+/*
+ * purpose: a trace being recorded or replayed
+ * members: recording - true when recording, false when replaying
+ *
+ *          while recording:
+ *                   fd - the trace file
+ *              buffers - the two record buffers
+ *              current - the buffer records are appended to
+ *                 used - bytes used in it
+ *                  run - input bytes not yet written as a 'D' record
+ *             run_used - bytes in run
+ *      next_checkpoint - the instruction count to take the next one at
+ *               writer - the writer thread
+ *                 lock - protects the members below
+ *              changed - signalled when they change
+ *              pending - the buffer handed to the writer, or NULL
+ *         pending_size - bytes in it
+ *              closing - set when the writer should exit once idle
+ *
+ *          while replaying:
+ *                image - the mapped trace, and image_size its size
+ *                input - the next input record
+ *            run_left - bytes left in the current 'D' record
+ *           checkpoint - the next checkpoint or end record
+ *            diverged - what first differed from the recording, or NULL
+ */
+struct Trace {
+        bool recording;
+
+        int fd;
+        unsigned char *buffers[2];
+        unsigned char *current;
+        size_t used;
+        unsigned char run[MAX_RUN];
+        unsigned run_used;
+        uint64_t next_checkpoint;
+        pthread_t writer;
+        pthread_mutex_t lock;
+        pthread_cond_t changed;
+        unsigned char *pending;
+        size_t pending_size;
+        bool closing;
+
+        const unsigned char *image;
+        size_t image_size;
+        const unsigned char *input;
+        unsigned run_left;
+        const unsigned char *checkpoint;
+        char diverged[160];
+};
+
+/*
+ *      name: program_hash
+ *   purpose: hashes segment 0, to tell whether a trace belongs to a program
+ *    inputs: segments - the segmented memory
+ *   outputs: the FNV-1a hash of segment 0's words
+ *    errors: none
+ */
+static uint64_t program_hash(Segments_T segments)
+{
+        const uint32_t *words = segments->table[0];
+        uint32_t length = segment_length(words);
+        uint64_t hash = 14695981039346656037ULL;
+
+        for (uint32_t i = 0; i < length; i++) {
+                hash = (hash ^ words[i]) * 1099511628211ULL;
+        }
+        return hash;
+}
+
+/*
+ *      name: write_all
+ *   purpose: writes a block of records to the trace file
+ *    inputs:   fd - the trace file
+ *            data - the bytes
+ *            size - how many
+ *   outputs: none
+ *    errors: CRE if the write fails
+ */
+static void write_all(int fd, const unsigned char *data, size_t size)
+{
+        while (size > 0) {
+                ssize_t n = write(fd, data, size);
+                if (n < 0 && errno == EINTR) {
+                        continue;
+                }
+                assert(n > 0);
+                data += n;
+                size -= n;
+        }
+}
+
+/*
+ *      name: write_buffers
+ *   purpose: the writer thread: writes each buffer handed to it until the
+ *            trace is closed
+ *    inputs: arg - the trace
+ *   outputs: NULL
+ *    errors: CRE if a write fails
+ */
+static void *write_buffers(void *arg)
+{
+        Trace_T trace = arg;
+
+        pthread_mutex_lock(&trace->lock);
+        for (;;) {
+                while (trace->pending == NULL && !trace->closing) {
+                        pthread_cond_wait(&trace->changed, &trace->lock);
+                }
+                if (trace->pending == NULL) {
+                        break; /* closing, and everything is written */
+                }
+                unsigned char *buffer = trace->pending;
+                size_t size = trace->pending_size;
+                pthread_mutex_unlock(&trace->lock);
+
+                write_all(trace->fd, buffer, size);
+
+                pthread_mutex_lock(&trace->lock);
+                trace->pending = NULL;
+                pthread_cond_broadcast(&trace->changed);
+        }
+        pthread_mutex_unlock(&trace->lock);
+        return NULL;
+}
+
+/*
+ *      name: hand_off
+ *   purpose: gives the current buffer to the writer thread, waiting for it
+ *            to finish the previous one, and switches to the other buffer
+ *    inputs: trace - the trace being recorded
+ *   outputs: none
+ *    errors: none
+ */
+static void hand_off(Trace_T trace)
+{
+        pthread_mutex_lock(&trace->lock);
+        while (trace->pending != NULL) {
+                pthread_cond_wait(&trace->changed, &trace->lock);
+        }
+        trace->pending = trace->current;
+        trace->pending_size = trace->used;
+        pthread_cond_broadcast(&trace->changed);
+        pthread_mutex_unlock(&trace->lock);
+
+        trace->current = trace->current == trace->buffers[0]
+                       ? trace->buffers[1] : trace->buffers[0];
+        trace->used = 0;
+}
+
+/*
+ *      name: put_varint
+ *   purpose: appends a count to a record being built
+ *    inputs:  out - where to put it
+ *           value - the count
+ *   outputs: the byte after it
+ *    errors: none
+ */
+static unsigned char *put_varint(unsigned char *out, uint64_t value)
+{
+        while (value >= 0x80) {
+                *out++ = (value & 0x7f) | 0x80;
+                value >>= 7;
+        }
+        *out++ = value;
+        return out;
+}
+
+/*
+ *      name: get_varint
+ *   purpose: reads a count from a record
+ *    inputs:  next - the count's first byte, advanced past it
+ *              end - the end of the trace
+ *   outputs: the count
+ *    errors: CRE if the trace ends in the middle of it
+ */
+static uint64_t get_varint(const unsigned char **next,
+                           const unsigned char *end)
+{
+        uint64_t value = 0;
+        for (int shift = 0; ; shift += 7) {
+                assert(*next < end && shift < 64);
+                unsigned char byte = *(*next)++;
+                value |= (uint64_t)(byte & 0x7f) << shift;
+                if (byte < 0x80) {
+                        return value;
+                }
+        }
+}
+
+/*
+ *      name: append_record
+ *   purpose: appends a record to the current buffer, first writing out the
+ *            input bytes collected for a 'D' record
+ *    inputs:  trace - the trace being recorded
+ *            record - the record, or NULL with size 0 to only write out the
+ *                     input bytes
+ *              size - its size, at most MAX_RECORD + MAX_RUN + 2 bytes
+ *   outputs: none
+ *    errors: none
+ */
+static void append_record(Trace_T trace, const unsigned char *record,
+                          size_t size)
+{
+        if (trace->run_used > 0) {
+                unsigned n = trace->run_used;
+                trace->run_used = 0;
+                unsigned char data[MAX_RUN + 2] = { 'D', n };
+                memcpy(data + 2, trace->run, n);
+                append_record(trace, data, n + 2);
+        }
+        if (size == 0) {
+                return;
+        }
+        if (trace->used + size > TRACE_BUFFER) {
+                hand_off(trace);
+        }
+        memcpy(trace->current + trace->used, record, size);
+        trace->used += size;
+}
+
+/*
+ *      name: Trace_record
+ *   purpose: starts recording a machine's input and checkpoints
+ *    inputs:     path - the trace file to write
+ *            segments - the machine's memory, holding its program
+ *               steps - instructions it has already executed
+ *              inputs - input instructions it has already executed
+ *   outputs: the trace, to be finished with Trace_close
+ *    errors: CRE if any argument is NULL, or the file cannot be created or
+ *            the writer thread started
+ */
+Trace_T Trace_record(const char *path, Segments_T segments, uint64_t steps,
+                     uint64_t inputs)
+{
+        assert(path != NULL);
+        assert(segments != NULL);
+
+        Trace_T trace;
+        NEW0(trace);
+        trace->recording = true;
+        trace->fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0666);
+        assert(trace->fd >= 0);
+        trace->buffers[0] = ALLOC(TRACE_BUFFER);
+        trace->buffers[1] = ALLOC(TRACE_BUFFER);
+        trace->current = trace->buffers[0];
+        trace->next_checkpoint = steps + TRACE_CHECKPOINT_STEPS;
+
+        struct Trace_header header;
+        memset(&header, 0, sizeof(header));
+        memcpy(header.magic, TRACE_MAGIC, sizeof(header.magic));
+        header.version = TRACE_VERSION;
+        header.program_size = segment_length(segments->table[0]);
+        header.start_steps = steps;
+        header.start_inputs = inputs;
+        header.program_hash = program_hash(segments);
+        memcpy(trace->current, &header, sizeof(header));
+        trace->used = sizeof(header);
+
+        pthread_mutex_init(&trace->lock, NULL);
+        pthread_cond_init(&trace->changed, NULL);
+        int status = pthread_create(&trace->writer, NULL, write_buffers,
+                                    trace);
+        assert(status == 0);
+        return trace;
+}
+
+/*
+ *      name: Trace_record_input
+ *   purpose: records the value an input instruction returned
+ *    inputs: trace - the trace being recorded
+ *            value - a byte, or ~0 for end of input
+ *   outputs: none
+ *    errors: CRE if trace is NULL
+ */
+void Trace_record_input(Trace_T trace, uint32_t value)
+{
+        assert(trace != NULL && trace->recording);
+
+        if (value > 255) {
+                const unsigned char end_of_input = 'E';
+                append_record(trace, &end_of_input, 1);
+                return;
+        }
+        trace->run[trace->run_used++] = value;
+        if (trace->run_used == MAX_RUN) {
+                append_record(trace, NULL, 0);
+        }
+}
+
+/*
+ *      name: diverge
+ *   purpose: notes the first way a replay differs from its recording
+ *    inputs:   trace - the trace being replayed
+ *            message - what differed
+ *   outputs: none
+ *    errors: none
+ */
+static void diverge(Trace_T trace, const char *message)
+{
+        if (trace->diverged[0] == '\0') {
+                snprintf(trace->diverged, sizeof(trace->diverged), "%s",
+                         message);
+        }
+}
+
+/*
+ *      name: next_input_record
+ *   purpose: moves the input cursor to the next 'D' or 'E' record
+ *    inputs: trace - the trace being replayed
+ *   outputs: the record's tag, or 'H' if no input was recorded after this
+ *    errors: CRE if the trace is malformed
+ */
+static unsigned char next_input_record(Trace_T trace)
+{
+        const unsigned char *end = trace->image + trace->image_size;
+
+        while (trace->input < end) {
+                unsigned char tag = *trace->input++;
+                if (tag == 'D') {
+                        assert(trace->input < end);
+                        trace->run_left = *trace->input++;
+                        assert(trace->run_left > 0 &&
+                               (size_t)(end - trace->input) >=
+                               trace->run_left);
+                        return tag;
+                } else if (tag == 'E') {
+                        return tag;
+                } else if (tag == 'C') {
+                        get_varint(&trace->input, end);
+                        get_varint(&trace->input, end);
+                } else {
+                        assert(tag == 'H');
+                        get_varint(&trace->input, end);
+                }
+        }
+        return 'H';
+}
+
+/*
+ *      name: Trace_replay_input
+ *   purpose: plays back the value the next input instruction returned
+ *    inputs: trace - the trace being replayed
+ *   outputs: the recorded byte, or ~0 for end of input; ~0 also if the
+ *            program reads more input than was recorded, which counts as
+ *            a divergence
+ *    errors: CRE if trace is NULL or the trace is malformed
+ */
+uint32_t Trace_replay_input(Trace_T trace)
+{
+        assert(trace != NULL && !trace->recording);
+
+        if (trace->run_left == 0) {
+                unsigned char tag = next_input_record(trace);
+                if (tag == 'H') {
+                        diverge(trace, "the program read more input than "
+                                "was recorded");
+                        return ~(uint32_t)0;
+                } else if (tag == 'E') {
+                        return ~(uint32_t)0;
+                }
+        }
+        trace->run_left--;
+        return *trace->input++;
+}
+
+/*
+ *      name: Trace_replay
+ *   purpose: starts playing back a trace for a machine
+ *    inputs:     path - the trace file
+ *            segments - the machine's memory, holding its program
+ *               steps - instructions it has already executed (nonzero when
+ *                       it was resumed from a snapshot)
+ *              inputs - input instructions it has already executed
+ *   outputs: the trace, to be finished with Trace_close
+ *    errors: CRE if any argument is NULL, the file cannot be read or is not
+ *            a trace, or the machine is at a point before the recording
+ *            started or that the recording never reached; a machine that
+ *            starts where the recording did but runs a different program
+ *            counts as a divergence
+ */
+Trace_T Trace_replay(const char *path, Segments_T segments, uint64_t steps,
+                     uint64_t inputs)
+{
+        assert(path != NULL);
+        assert(segments != NULL);
+
+        int fd = open(path, O_RDONLY);
+        assert(fd >= 0);
+        struct stat st;
+        int status = fstat(fd, &st);
+        assert(status == 0);
+        assert((size_t)st.st_size >= sizeof(struct Trace_header));
+        void *image = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        assert(image != MAP_FAILED);
+        close(fd);
+        madvise(image, st.st_size, MADV_SEQUENTIAL);
+
+        struct Trace_header header;
+        memcpy(&header, image, sizeof(header));
+        assert(memcmp(header.magic, TRACE_MAGIC, sizeof(header.magic)) == 0);
+        assert(header.version == TRACE_VERSION);
+        assert(steps >= header.start_steps && inputs >= header.start_inputs);
+
+        Trace_T trace;
+        NEW0(trace);
+        trace->recording = false;
+        trace->image = image;
+        trace->image_size = st.st_size;
+        trace->input = trace->image + sizeof(header);
+        trace->checkpoint = trace->input;
+
+        if (steps == header.start_steps &&
+            (header.program_size != segment_length(segments->table[0]) ||
+             header.program_hash != program_hash(segments))) {
+                diverge(trace, "the trace was recorded from a different "
+                        "program");
+        }
+
+        /* skip what the machine did before it reached this point */
+        for (uint64_t i = header.start_inputs; i < inputs; i++) {
+                if (trace->run_left > 0) {
+                        trace->run_left--;
+                        trace->input++;
+                } else {
+                        assert(next_input_record(trace) != 'H');
+                        i -= trace->run_left > 0;
+                }
+        }
+        while (Trace_next_checkpoint(trace) <= steps) {
+                trace->checkpoint++;
+                get_varint(&trace->checkpoint, trace->image + st.st_size);
+                get_varint(&trace->checkpoint, trace->image + st.st_size);
+        }
+        return trace;
+}
+
+/*
+ *      name: Trace_next_checkpoint
+ *   purpose: tells when the machine should next pause for a checkpoint
+ *    inputs: trace - the trace
+ *   outputs: the instruction count to pause at: the next one due when
+ *            recording, the next one recorded when replaying, UINT64_MAX
+ *            if there are none left
+ *    errors: CRE if trace is NULL or the trace is malformed
+ */
+uint64_t Trace_next_checkpoint(Trace_T trace)
+{
+        assert(trace != NULL);
+        if (trace->recording) {
+                return trace->next_checkpoint;
+        }
+
+        const unsigned char *end = trace->image + trace->image_size;
+        while (trace->checkpoint < end) {
+                unsigned char tag = *trace->checkpoint;
+                const unsigned char *operands = trace->checkpoint + 1;
+                if (tag == 'C') {
+                        return get_varint(&operands, end);
+                } else if (tag == 'D') {
+                        assert(operands < end);
+                        trace->checkpoint = operands + 1 + *operands;
+                } else if (tag == 'E') {
+                        trace->checkpoint = operands;
+                } else {
+                        assert(tag == 'H');
+                        return UINT64_MAX;
+                }
+        }
+        return UINT64_MAX;
+}
+
+/*
+ *      name: Trace_checkpoint
+ *   purpose: records a checkpoint, or checks a replay against the recorded
+ *            one, once the machine has paused at or after the instruction
+ *            count Trace_next_checkpoint gave
+ *    inputs: trace - the trace
+ *            steps - instructions executed so far
+ *               pc - the offset in segment 0 the machine paused at
+ *   outputs: none
+ *    errors: CRE if trace is NULL or the trace is malformed
+ */
+void Trace_checkpoint(Trace_T trace, uint64_t steps, uint32_t pc)
+{
+        assert(trace != NULL);
+
+        if (trace->recording) {
+                unsigned char record[MAX_RECORD] = { 'C' };
+                unsigned char *end = put_varint(record + 1, steps);
+                end = put_varint(end, pc);
+                append_record(trace, record, end - record);
+                trace->next_checkpoint = steps + TRACE_CHECKPOINT_STEPS;
+                return;
+        }
+
+        const unsigned char *end = trace->image + trace->image_size;
+        if (Trace_next_checkpoint(trace) == UINT64_MAX) {
+                return;
+        }
+        trace->checkpoint++;
+        uint64_t recorded_steps = get_varint(&trace->checkpoint, end);
+        uint64_t recorded_pc = get_varint(&trace->checkpoint, end);
+        if (recorded_steps != steps || recorded_pc != pc) {
+                char message[sizeof(trace->diverged)];
+                snprintf(message, sizeof(message), "the recording paused "
+                         "at pc %llu after %llu instructions, the replay at "
+                         "pc %u after %llu",
+                         (unsigned long long)recorded_pc,
+                         (unsigned long long)recorded_steps, pc,
+                         (unsigned long long)steps);
+                diverge(trace, message);
+        }
+}
+
+/*
+ *      name: Trace_close
+ *   purpose: finishes a trace once the machine has stopped. A recording is
+ *            ended with the final instruction count and written out; a
+ *            replay is checked against that count.
+ *    inputs:  trace - pointer to the trace, set to NULL
+ *             steps - instructions executed in all
+ *            report - where to say how a replay diverged
+ *   outputs: false if a replay diverged from the recording, true otherwise
+ *    errors: CRE if trace, *trace or report is NULL, or the trace cannot be
+ *            written
+ */
+bool Trace_close(Trace_T *trace, uint64_t steps, FILE *report)
+{
+        assert(trace != NULL && *trace != NULL);
+        assert(report != NULL);
+        Trace_T t = *trace;
+        bool matched = true;
+
+        if (t->recording) {
+                unsigned char record[MAX_RECORD] = { 'H' };
+                unsigned char *end = put_varint(record + 1, steps);
+                append_record(t, record, end - record);
+                hand_off(t);
+
+                pthread_mutex_lock(&t->lock);
+                t->closing = true;
+                pthread_cond_broadcast(&t->changed);
+                pthread_mutex_unlock(&t->lock);
+                pthread_join(t->writer, NULL);
+                pthread_mutex_destroy(&t->lock);
+                pthread_cond_destroy(&t->changed);
+
+                int status = close(t->fd);
+                assert(status == 0);
+                FREE(t->buffers[0]);
+                FREE(t->buffers[1]);
+        } else {
+                const unsigned char *end = t->image + t->image_size;
+                while (Trace_next_checkpoint(t) != UINT64_MAX) {
+                        t->checkpoint++;
+                        get_varint(&t->checkpoint, end);
+                        get_varint(&t->checkpoint, end);
+                }
+                if (t->checkpoint < end) {
+                        const unsigned char *operands = t->checkpoint + 1;
+                        uint64_t recorded = get_varint(&operands, end);
+                        if (recorded != steps) {
+                                char message[sizeof(t->diverged)];
+                                snprintf(message, sizeof(message),
+                                         "the recording stopped after %llu "
+                                         "instructions, the replay after "
+                                         "%llu", (unsigned long long)recorded,
+                                         (unsigned long long)steps);
+                                diverge(t, message);
+                        }
+                }
+                if (t->diverged[0] != '\0') {
+                        fprintf(report, "replay diverged: %s\n",
+                                t->diverged);
+                        matched = false;
+                }
+                munmap((void *)t->image, t->image_size);
+        }
+
+        FREE(*trace);
+        return matched;
+}
@@ -0,0 +1,42 @@
+/* trace.h
+ * by Alyssa Williams (awilli36) and Olivia Byun (obyun01)
+ * 11/21/22
+ *
+ * This is the interface for our trace module, which records the one thing
+ * that makes a UM run nondeterministic, the values its input instructions
+ * return, so the run can be replayed exactly without its input. A trace
+ * also holds checkpoints: the program counter and instruction count every
+ * so often, which a replay checks to find where it stops matching the
+ * recording.
+ *
+ * Recording hands full buffers to a writer thread, so the machine does not
+ * wait for the disk.
+ */
+
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include "memory.h"
+
+/* instructions between the checkpoints a recording takes */
+#define TRACE_CHECKPOINT_STEPS ((uint64_t)1 << 26)
+
+typedef struct Trace *Trace_T;
+
+Trace_T Trace_record(const char *path, Segments_T segments, uint64_t steps,
+                     uint64_t inputs);
+Trace_T Trace_replay(const char *path, Segments_T segments, uint64_t steps,
+                     uint64_t inputs);
+
+void Trace_record_input(Trace_T trace, uint32_t value);
+uint32_t Trace_replay_input(Trace_T trace);
+
+uint64_t Trace_next_checkpoint(Trace_T trace);
+void Trace_checkpoint(Trace_T trace, uint64_t steps, uint32_t pc);
+
+bool Trace_close(Trace_T *trace, uint64_t steps, FILE *report);
+
+#endif
@@ -16,6 +16,7 @@
 
 #include <stdint.h>
 #include <stdio.h>
+#include <stdbool.h>
 #include <assert.h>
 #include <seq.h>
 #include <bitpack.h>
@@ -406,4 +407,667 @@ void build_loop_test(Seq_T stream)
         append(stream, three_register(CMOV, r4, r3, r2));  //if r[c] != 0 r[a] = r[b]
         append(stream, three_register(LOADP, r5, r5, r4)); // 9
         append(stream, halt());                            //10
-}
\ No newline at end of file
+}
+
+/* 
+ * Load program shares the loaded segment with segment 0 until one of them is
+ * written. The code at offsets 2-7 is copied into a new segment and loaded.
+ * It first writes into the new segment, which must not change the running
+ * segment 0, then reloads the segment, which must pick up the writes.
+ */
+void build_cow_test(Seq_T stream)
+{
+        /* jump over the code that gets copied */
+        append(stream, loadval(r3, 8));
+        append(stream, three_register(LOADP, r0, r0, r3));
+
+        /* offsets 2-7: run from the loaded segment, whose id is in r1 */
+        append(stream, three_register(SSTORE, r1, r4, r5)); /* m[r1][4] out */
+        append(stream, three_register(SSTORE, r1, r2, r6)); /* m[r1][2] halt */
+        append(stream, output(r7)); /* halts here if the store leaked */
+        append(stream, three_register(LOADP, r0, r1, r4));
+        append(stream, halt()); /* reached only if the reload was stale */
+        append(stream, halt());
+
+        /* copy offsets 2-7 into a new segment */
+        append(stream, loadval(r0, 0));
+        append(stream, loadval(r2, 6));
+        append(stream, three_register(ACTIVATE, r0, r1, r2));
+        for (unsigned i = 0; i < 6; i++) {
+                append(stream, loadval(r3, i + 2));
+                append(stream, three_register(SLOAD, r5, r0, r3));
+                append(stream, loadval(r4, i));
+                append(stream, three_register(SSTORE, r1, r4, r5));
+        }
+
+        /* r6 = halt instruction, r5 = output r7 instruction */
+        append(stream, loadval(r2, 16384));
+        append(stream, loadval(r6, 7));
+        append(stream, three_register(MUL, r6, r6, r2));
+        append(stream, three_register(MUL, r6, r6, r2));
+        append(stream, loadval(r5, 10));
+        append(stream, three_register(MUL, r5, r5, r2));
+        append(stream, three_register(MUL, r5, r5, r2));
+        append(stream, loadval(r3, 7));
+        append(stream, three_register(ADD, r5, r5, r3));
+
+        append(stream, loadval(r7, 'X'));
+        append(stream, loadval(r2, 2));
+        append(stream, loadval(r4, 4));
+        append(stream, loadval(r3, 0));
+        append(stream, three_register(LOADP, r0, r1, r3));
+}
+
+void build_selfmod_test(Seq_T stream)
+{
+        /* run the code at offset 13 once */
+        append(stream, loadval(r0, 0));
+        append(stream, loadval(r5, 13));
+        append(stream, loadval(r6, 4));
+        append(stream, three_register(LOADP, r0, r0, r5));
+
+        /* overwrite offset 13 with "load value r1 'Y'" and run it again */
+        append(stream, loadval(r2, 0xd200));
+        append(stream, loadval(r3, 65536));
+        append(stream, three_register(MUL, r2, r2, r3));
+        append(stream, loadval(r3, 'Y'));
+        append(stream, three_register(ADD, r2, r2, r3));
+        append(stream, three_register(SSTORE, r0, r5, r2));
+        append(stream, loadval(r6, 12));
+        append(stream, three_register(LOADP, r0, r0, r5));
+        append(stream, halt());
+
+        /* offset 13: print r1, then return to the offset in r6 */
+        append(stream, loadval(r1, 'X'));
+        append(stream, output(r1));
+        append(stream, three_register(LOADP, r0, r0, r6));
+}
+
+
+/*
+ * Overwrites a word that has run but is not part of any compiled block: the
+ * output at offset 14 is replaced with "load value r1 'B'", so the second
+ * call prints B where the first printed A.
+ */
+void build_selfmod_io_test(Seq_T stream)
+{
+        /* call offset 14 once */
+        append(stream, loadval(r0, 0));
+        append(stream, loadval(r1, 'A'));
+        append(stream, loadval(r5, 5));
+        append(stream, loadval(r6, 14));
+        append(stream, three_register(LOADP, r0, r0, r6));
+
+        /* overwrite offset 14 with "load value r1 'B'" and call it again */
+        append(stream, loadval(r2, 0xd200));
+        append(stream, loadval(r3, 65536));
+        append(stream, three_register(MUL, r2, r2, r3));
+        append(stream, loadval(r3, 'B'));
+        append(stream, three_register(ADD, r2, r2, r3));
+        append(stream, three_register(SSTORE, r0, r6, r2));
+        append(stream, loadval(r5, 13));
+        append(stream, three_register(LOADP, r0, r0, r6));
+        append(stream, halt());
+
+        /* offset 14: print r1, print it again, return to the offset in r5 */
+        append(stream, output(r1));
+        append(stream, output(r1));
+        append(stream, three_register(LOADP, r0, r0, r5));
+}
+
+/*
+ * A long run of segmented stores, which compiles to the longest blocks the
+ * JIT makes: every store has a side exit as well as its inline code.
+ */
+void build_store_run_test(Seq_T stream)
+{
+        append(stream, loadval(r0, 0));
+        append(stream, loadval(r2, 1));
+        append(stream, three_register(ACTIVATE, r0, r1, r2));
+        append(stream, loadval(r3, 0));
+        append(stream, loadval(r4, 'S'));
+        for (unsigned i = 0; i < 600; i++) {
+                append(stream, three_register(SSTORE, r1, r3, r4));
+        }
+        append(stream, three_register(SLOAD, r5, r1, r3));
+        append(stream, output(r5));
+        append(stream, halt());
+}
+
+/*
+ * Fault programs for the checked build (um-safe). Each stops the machine at
+ * the instruction before its halt, so um-safe must report that instruction
+ * and exit with status 1.
+ */
+
+/* a segmented load from segment 5, which was never mapped */
+void build_unmapped_fault(Seq_T stream)
+{
+        append(stream, loadval(r1, 5));
+        append(stream, three_register(SLOAD, r0, r1, r2));
+        append(stream, halt());
+}
+
+/* a segmented load from offset 5 of a mapped one-word segment */
+void build_bounds_fault(Seq_T stream)
+{
+        append(stream, loadval(r3, 1));
+        append(stream, three_register(ACTIVATE, r0, r1, r3));
+        append(stream, loadval(r2, 5));
+        append(stream, three_register(SLOAD, r0, r1, r2));
+        append(stream, halt());
+}
+
+/* 3 divided by 0 */
+void build_divide_fault(Seq_T stream)
+{
+        append(stream, loadval(r1, 3));
+        append(stream, three_register(DIV, r0, r1, r2));
+        append(stream, halt());
+}
+
+/* opcode 14, which the UM does not define */
+void build_opcode_fault(Seq_T stream)
+{
+        append(stream, loadval(r1, 3));
+        append(stream, three_register((Um_opcode)(LV + 1), r0, r0, r0));
+        append(stream, halt());
+}
+
+/* unmapping segment 0, which holds the running program */
+void build_unmap0_fault(Seq_T stream)
+{
+        append(stream, three_register(INACTIVATE, r0, r0, r0));
+        append(stream, halt());
+}
+
+/* 
+ * Microbenchmarks for the UM (see ../bench). Each runs long enough to time
+ * and prints a letter that depends on everything it computed, so the
+ * benchmark harness can tell a wrong answer from a fast one.
+ *
+ * The counted loops keep 0 in r0, ~0 in r5 and the iterations left in r7,
+ * and use r3 and r4 to jump back; the body may use r1, r2, r3, r4 and r6.
+ */
+
+#define ARITH_ITERATIONS 16000000
+#define MAP_ITERATIONS 4000000
+#define LOADP_ITERATIONS 2000000
+#define LARGE_ITERATIONS 8000000
+#define LARGE_WORDS (16 * 1024 * 1024) /* 64MB: 32 huge pages */
+
+/* sets up a loop that runs its body n times; returns the body's offset */
+static unsigned append_loop_start(Seq_T stream, unsigned n)
+{
+        append(stream, loadval(r0, 0));
+        append(stream, three_register(NAND, r5, r0, r0));
+        append(stream, loadval(r7, n));
+        return Seq_length(stream);
+}
+
+/* counts r7 down and jumps back to offset top until it reaches zero */
+static void append_loop_end(Seq_T stream, unsigned top)
+{
+        unsigned after = Seq_length(stream) + 5;
+
+        append(stream, three_register(ADD, r7, r7, r5));
+        append(stream, loadval(r4, after));
+        append(stream, loadval(r3, top));
+        append(stream, three_register(CMOV, r4, r3, r7));
+        append(stream, three_register(LOADP, r0, r0, r4));
+}
+
+/* rd = rx % ry, using rt (which must not be rx or ry); needs ~0 in r5 */
+static void append_mod(Seq_T stream, Um_register rd, Um_register rx,
+                       Um_register ry, Um_register rt)
+{
+        append(stream, three_register(DIV, rt, rx, ry));
+        append(stream, three_register(MUL, rt, rt, ry));
+        append(stream, three_register(ADD, rt, rt, r5));
+        append(stream, three_register(NAND, rt, rt, rt)); /* -(rx / ry * ry) */
+        append(stream, three_register(ADD, rd, rx, rt));
+}
+
+/* prints 'a' + rv % 26, using t1 and t2; needs ~0 in r5 */
+static void append_letter(Seq_T stream, Um_register rv, Um_register t1,
+                          Um_register t2)
+{
+        append(stream, loadval(t1, 26));
+        append_mod(stream, t2, rv, t1, t2);
+        append(stream, loadval(t1, 'a'));
+        append(stream, three_register(ADD, t2, t2, t1));
+        append(stream, output(t2));
+}
+
+/* prints 'a' + r1 % 26 and halts; uses r2 and r6 */
+static void append_letter_and_halt(Seq_T stream)
+{
+        append_letter(stream, r1, r6, r2);
+        append(stream, halt());
+}
+
+/* add, multiply, divide and NAND on a running value */
+void build_arith_bench(Seq_T stream)
+{
+        append(stream, loadval(r1, 1));
+        append(stream, loadval(r6, 69069));
+        unsigned top = append_loop_start(stream, ARITH_ITERATIONS);
+
+        append(stream, three_register(MUL, r1, r1, r6));
+        append(stream, three_register(ADD, r1, r1, r7));
+        append(stream, three_register(NAND, r2, r1, r7));
+        append(stream, three_register(DIV, r2, r2, r6));
+        append(stream, three_register(ADD, r1, r1, r2));
+        append_loop_end(stream, top);
+
+        append_letter_and_halt(stream);
+}
+
+/* maps two segments, stores into and loads from them, unmaps them */
+void build_map_bench(Seq_T stream)
+{
+        append(stream, loadval(r6, 0));
+        unsigned top = append_loop_start(stream, MAP_ITERATIONS);
+
+        append(stream, loadval(r3, 16));
+        append(stream, three_register(ACTIVATE, r0, r1, r3));
+        append(stream, loadval(r3, 1));
+        append(stream, three_register(ACTIVATE, r0, r2, r3));
+        append(stream, three_register(SSTORE, r1, r0, r7));
+        append(stream, three_register(SLOAD, r4, r1, r0));
+        append(stream, three_register(ADD, r6, r6, r4));
+        append(stream, three_register(SSTORE, r2, r0, r6));
+        append(stream, three_register(SLOAD, r4, r2, r0));
+        append(stream, three_register(ADD, r6, r6, r4));
+        append(stream, three_register(INACTIVATE, r0, r0, r2));
+        append(stream, three_register(INACTIVATE, r0, r0, r1));
+        append_loop_end(stream, top);
+
+        append(stream, three_register(CMOV, r1, r6, r5));
+        append_letter_and_halt(stream);
+}
+
+/*
+ * maps a 64MB segment and updates words of it at pseudo-random offsets (a
+ * linear congruential sequence, whose low 24 bits visit every offset), so
+ * nearly every access touches a different page: dominated by TLB misses
+ */
+void build_large_bench(Seq_T stream)
+{
+        append(stream, loadval(r2, LARGE_WORDS));
+        append(stream, three_register(ACTIVATE, r0, r1, r2));
+        append(stream, loadval(r6, LARGE_WORDS - 1));
+        unsigned top = append_loop_start(stream, LARGE_ITERATIONS);
+
+        append(stream, loadval(r3, 69069));
+        append(stream, three_register(MUL, r2, r2, r3));
+        append(stream, loadval(r3, 12345));
+        append(stream, three_register(ADD, r2, r2, r3));
+        append(stream, three_register(NAND, r4, r2, r6));
+        append(stream, three_register(NAND, r4, r4, r4)); /* r2 & mask */
+        append(stream, three_register(SLOAD, r3, r1, r4));
+        append(stream, three_register(ADD, r3, r3, r7));
+        append(stream, three_register(SSTORE, r1, r4, r3));
+        append_loop_end(stream, top);
+
+        append_letter_and_halt(stream); /* r1 is the segment, 1 */
+}
+
+/* 
+ * copies the program into two segments and loads them in turn, so every
+ * load program replaces segment 0 with different words
+ */
+void build_loadp_bench(Seq_T stream)
+{
+        /* copy segment 0 into r1 and r2; its length is filled in below */
+        unsigned copy = append_loop_start(stream, 0);
+        append(stream, three_register(ACTIVATE, r0, r1, r7));
+        append(stream, three_register(ACTIVATE, r0, r2, r7));
+        unsigned top = Seq_length(stream);
+        append(stream, three_register(ADD, r4, r7, r5));
+        append(stream, three_register(SLOAD, r3, r0, r4));
+        append(stream, three_register(SSTORE, r1, r4, r3));
+        append(stream, three_register(SSTORE, r2, r4, r3));
+        append_loop_end(stream, top);
+
+        append(stream, loadval(r7, LOADP_ITERATIONS));
+        top = Seq_length(stream);
+        append(stream, three_register(CMOV, r6, r1, r5));
+        append(stream, three_register(CMOV, r1, r2, r5));
+        append(stream, three_register(CMOV, r2, r6, r5));
+        append(stream, loadval(r4, Seq_length(stream) + 2));
+        append(stream, three_register(LOADP, r0, r1, r4));
+        append_loop_end(stream, top);
+
+        append_letter_and_halt(stream);
+        Seq_put(stream, copy - 1,
+                (void *)(uintptr_t)loadval(r7, Seq_length(stream)));
+}
+
+/* copies its input to its output a byte at a time */
+void build_io_bench(Seq_T stream)
+{
+        append(stream, loadval(r0, 0));
+        unsigned top = Seq_length(stream);
+        append(stream, three_register(IN, 0, 0, r1));
+        append(stream, three_register(NAND, r2, r1, r1)); /* 0 at EOF */
+        append(stream, loadval(r4, top + 9));
+        append(stream, loadval(r3, top + 6));
+        append(stream, three_register(CMOV, r4, r3, r2));
+        append(stream, three_register(LOADP, r0, r0, r4));
+        append(stream, output(r1));
+        append(stream, loadval(r3, top));
+        append(stream, three_register(LOADP, r0, r0, r3));
+        append(stream, halt());
+}
+
+
+/* 
+ * Stress programs: large workloads whose shape is set by parameters. Each
+ * generator writes the program into stream and the output it must produce
+ * into expected, which it works out by running the same computation in C.
+ * Every program ends by printing a checksum of its work as six letters and
+ * a newline; some also print a letter as they go.
+ */
+
+/* prints r1 as six base-26 letters, least significant first, and a newline;
+ * uses r2, r3 and r4 */
+static void append_checksum(Seq_T stream)
+{
+        for (int i = 0; i < 6; i++) {
+                append_letter(stream, r1, r2, r3);
+                append(stream, loadval(r2, 26));
+                append(stream, three_register(DIV, r1, r1, r2));
+        }
+        append(stream, loadval(r2, '\n'));
+        append(stream, output(r2));
+}
+
+static void expect_checksum(FILE *expected, uint32_t sum)
+{
+        for (int i = 0; i < 6; i++) {
+                fputc('a' + sum % 26, expected);
+                sum /= 26;
+        }
+        fputc('\n', expected);
+}
+
+static uint32_t nest_model(FILE *expected, unsigned level, unsigned depth,
+                           unsigned count, uint32_t sum)
+{
+        for (uint32_t c = count; c > 0; c--) {
+                if (level == depth - 1) {
+                        sum = sum * 3 + c;
+                } else {
+                        sum = nest_model(expected, level + 1, depth, count,
+                                         sum);
+                }
+                if (level == 0) {
+                        fputc('a' + sum % 26, expected);
+                }
+        }
+        return sum;
+}
+
+/* 
+ * params[0] loops nested in each other, each running params[1] times. The
+ * loop counters live in a segment. The innermost body multiplies the sum by
+ * 3 and adds its counter; each outermost iteration prints a letter.
+ */
+void build_nest_stress(Seq_T stream, FILE *expected, const unsigned *params)
+{
+        unsigned depth = params[0], count = params[1];
+        unsigned top[8];
+        assert(depth >= 1 && depth <= 8);
+        assert(count >= 1 && count < (1u << 25));
+
+        append(stream, loadval(r0, 0));
+        append(stream, three_register(NAND, r5, r0, r0));
+        append(stream, loadval(r1, 0));
+        append(stream, loadval(r3, depth));
+        append(stream, three_register(ACTIVATE, r0, r6, r3));
+        for (unsigned level = 0; level < depth; level++) {
+                append(stream, loadval(r3, level));
+                append(stream, loadval(r4, count));
+                append(stream, three_register(SSTORE, r6, r3, r4));
+                top[level] = Seq_length(stream);
+        }
+
+        append(stream, loadval(r3, depth - 1));
+        append(stream, three_register(SLOAD, r4, r6, r3));
+        append(stream, loadval(r2, 3));
+        append(stream, three_register(MUL, r1, r1, r2));
+        append(stream, three_register(ADD, r1, r1, r4));
+
+        for (int level = depth - 1; level >= 0; level--) {
+                if (level == 0) {
+                        append_letter(stream, r1, r2, r3);
+                }
+                append(stream, loadval(r3, level));
+                append(stream, three_register(SLOAD, r4, r6, r3));
+                append(stream, three_register(ADD, r4, r4, r5));
+                append(stream, three_register(SSTORE, r6, r3, r4));
+                append(stream, loadval(r3, Seq_length(stream) + 4));
+                append(stream, loadval(r2, top[level]));
+                append(stream, three_register(CMOV, r3, r2, r4));
+                append(stream, three_register(LOADP, r0, r0, r3));
+        }
+        append_checksum(stream);
+        append(stream, halt());
+
+        expect_checksum(expected, nest_model(expected, 0, depth, count, 0));
+}
+
+/* 
+ * params[0] allocations. params[2] segments are live at a time, kept in a
+ * ring: each step unmaps the oldest, maps a new one and writes and reads
+ * back its first and last words. Sizes run from 1 to params[1] words, drawn
+ * uniformly from a linear congruential generator, or skewed towards small
+ * segments (the square of a uniform draw) if params[3] is nonzero. The
+ * ring, the generator's state and the sum live in one segment.
+ */
+void build_segments_stress(Seq_T stream, FILE *expected,
+                           const unsigned *params)
+{
+        unsigned steps = params[0], max_size = params[1], live = params[2];
+        bool skew = params[3] != 0;
+        assert(steps >= 1 && steps < (1u << 25));
+        assert(max_size >= 1 && max_size <= 65536);
+        assert(live >= 1 && live + 2 < (1u << 25));
+
+        /* r6 = [ids of the live segments..., generator state, sum] */
+        append(stream, loadval(r3, live + 2));
+        append(stream, three_register(ACTIVATE, r0, r6, r3));
+
+        /* start with live one-word segments */
+        unsigned top = append_loop_start(stream, live);
+        append(stream, loadval(r3, 1));
+        append(stream, three_register(ACTIVATE, r0, r1, r3));
+        append(stream, three_register(ADD, r4, r7, r5));
+        append(stream, three_register(SSTORE, r6, r4, r1));
+        append_loop_end(stream, top);
+
+        append(stream, loadval(r7, steps));
+        top = Seq_length(stream);
+
+        /* r3 = the slot to replace; unmap its segment */
+        append(stream, loadval(r2, live));
+        append_mod(stream, r3, r7, r2, r4);
+        append(stream, three_register(SLOAD, r4, r6, r3));
+        append(stream, three_register(INACTIVATE, r0, r0, r4));
+
+        /* r4 = x = x * 69069 + 1 */
+        append(stream, loadval(r2, live));
+        append(stream, three_register(SLOAD, r4, r6, r2));
+        append(stream, loadval(r2, 69069));
+        append(stream, three_register(MUL, r4, r4, r2));
+        append(stream, loadval(r2, 1));
+        append(stream, three_register(ADD, r4, r4, r2));
+        append(stream, loadval(r2, live));
+        append(stream, three_register(SSTORE, r6, r2, r4));
+
+        /* r4 = the new segment's last offset */
+        append(stream, loadval(r2, 65536));
+        append(stream, three_register(DIV, r4, r4, r2));
+        append(stream, loadval(r2, max_size));
+        append_mod(stream, r4, r4, r2, r1);
+        if (skew) {
+                append(stream, three_register(MUL, r4, r4, r4));
+                append(stream, three_register(DIV, r4, r4, r2));
+        }
+        append(stream, loadval(r2, 1));
+        append(stream, three_register(ADD, r2, r4, r2));
+        append(stream, three_register(ACTIVATE, r0, r1, r2));
+        append(stream, three_register(SSTORE, r6, r3, r1));
+
+        /* write the counter into the last word; sum it, the first word and
+         * the last offset */
+        append(stream, three_register(SSTORE, r1, r4, r7));
+        append(stream, three_register(SLOAD, r2, r1, r4));
+        append(stream, three_register(SLOAD, r3, r1, r0));
+        append(stream, three_register(ADD, r2, r2, r3));
+        append(stream, three_register(ADD, r2, r2, r4));
+        append(stream, loadval(r4, live + 1));
+        append(stream, three_register(SLOAD, r1, r6, r4));
+        append(stream, three_register(ADD, r1, r1, r2));
+        append(stream, three_register(SSTORE, r6, r4, r1));
+        append_loop_end(stream, top);
+
+        append(stream, loadval(r4, live + 1));
+        append(stream, three_register(SLOAD, r1, r6, r4));
+        append_checksum(stream);
+        append(stream, halt());
+
+        uint32_t x = 0, sum = 0;
+        for (uint32_t c = steps; c > 0; c--) {
+                x = x * 69069 + 1;
+                uint32_t last = (x / 65536) % max_size;
+                if (skew) {
+                        last = last * last / max_size;
+                }
+                sum += c + (last == 0 ? c : 0) + last;
+        }
+        expect_checksum(expected, sum);
+}
+
+/* 
+ * params[0] iterations of rewriting params[1] load value instructions in
+ * segment 0 and running them. In iteration i the j-th loads i + j, and the
+ * instruction after it adds that to the sum, so every iteration has to run
+ * the code it just wrote.
+ */
+void build_selfmod_stress(Seq_T stream, FILE *expected,
+                          const unsigned *params)
+{
+        unsigned iterations = params[0], slots = params[1];
+        assert(iterations >= 1 && slots >= 1);
+        assert(iterations + slots < (1u << 25));
+
+        append(stream, loadval(r1, 0));
+        append(stream, loadval(r6, 0xd400)); /* r6 = load value into r2 */
+        append(stream, loadval(r2, 65536));
+        append(stream, three_register(MUL, r6, r6, r2));
+        unsigned top = append_loop_start(stream, iterations);
+        unsigned patch = top + 5 + 4 * (slots - 1);
+        unsigned back = patch + 2 * slots + 2;
+
+        /* write the instructions at offset patch, then jump there */
+        append(stream, three_register(ADD, r4, r6, r7));
+        append(stream, loadval(r3, patch));
+        append(stream, three_register(SSTORE, r0, r3, r4));
+        for (unsigned j = 1; j < slots; j++) {
+                append(stream, loadval(r2, j));
+                append(stream, three_register(ADD, r2, r4, r2));
+                append(stream, loadval(r3, patch + 2 * j));
+                append(stream, three_register(SSTORE, r0, r3, r2));
+        }
+        append(stream, loadval(r3, patch));
+        append(stream, three_register(LOADP, r0, r0, r3));
+
+        assert((unsigned)Seq_length(stream) == patch);
+        for (unsigned j = 0; j < slots; j++) {
+                append(stream, halt()); /* rewritten before it runs */
+                append(stream, three_register(ADD, r1, r1, r2));
+        }
+        append(stream, loadval(r3, back));
+        append(stream, three_register(LOADP, r0, r0, r3));
+
+        assert((unsigned)Seq_length(stream) == back);
+        append_loop_end(stream, top);
+        append_checksum(stream);
+        append(stream, halt());
+
+        uint32_t sum = 0;
+        for (uint32_t i = iterations; i > 0; i--) {
+                for (uint32_t j = 0; j < slots; j++) {
+                        sum += i + j;
+                }
+        }
+        expect_checksum(expected, sum);
+}
+
+/* 
+ * params[0] calls through a table of params[1] handlers: each call draws a
+ * handler from a linear congruential generator, loads its offset from the
+ * table and jumps there with load program. Handler k multiplies the sum by
+ * 5 and adds 7k + 1, then jumps back.
+ */
+void build_dispatch_stress(Seq_T stream, FILE *expected,
+                           const unsigned *params)
+{
+        unsigned calls = params[0], entries = params[1];
+        unsigned fill[1024];
+        assert(calls >= 1 && calls < (1u << 25));
+        assert(entries >= 1 && entries <= 1024);
+
+        /* r6 = [handler offsets..., generator state] */
+        append(stream, loadval(r3, entries + 1));
+        append(stream, three_register(ACTIVATE, r0, r6, r3));
+        for (unsigned k = 0; k < entries; k++) {
+                append(stream, loadval(r3, k));
+                fill[k] = Seq_length(stream);
+                append(stream, loadval(r4, 0)); /* handler k's offset */
+                append(stream, three_register(SSTORE, r6, r3, r4));
+        }
+        append(stream, loadval(r1, 0));
+        unsigned top = append_loop_start(stream, calls);
+
+        /* r2 = x = x * 69069 + 1 */
+        append(stream, loadval(r3, entries));
+        append(stream, three_register(SLOAD, r2, r6, r3));
+        append(stream, loadval(r4, 69069));
+        append(stream, three_register(MUL, r2, r2, r4));
+        append(stream, loadval(r4, 1));
+        append(stream, three_register(ADD, r2, r2, r4));
+        append(stream, three_register(SSTORE, r6, r3, r2));
+
+        /* call handler (x / 65536) % entries */
+        append(stream, loadval(r4, 65536));
+        append(stream, three_register(DIV, r2, r2, r4));
+        append_mod(stream, r2, r2, r3, r4);
+        append(stream, three_register(SLOAD, r3, r6, r2));
+        append(stream, three_register(LOADP, r0, r0, r3));
+
+        unsigned back = Seq_length(stream);
+        append_loop_end(stream, top);
+        append_checksum(stream);
+        append(stream, halt());
+
+        for (unsigned k = 0; k < entries; k++) {
+                Seq_put(stream, fill[k], (void *)(uintptr_t)
+                        loadval(r4, Seq_length(stream)));
+                append(stream, loadval(r3, 5));
+                append(stream, three_register(MUL, r1, r1, r3));
+                append(stream, loadval(r3, 7 * k + 1));
+                append(stream, three_register(ADD, r1, r1, r3));
+                append(stream, loadval(r3, back));
+                append(stream, three_register(LOADP, r0, r0, r3));
+        }
+
+        uint32_t x = 0, sum = 0;
+        for (uint32_t c = calls; c > 0; c--) {
+                x = x * 69069 + 1;
+                sum = sum * 5 + 7 * ((x / 65536) % entries) + 1;
+        }
+        expect_checksum(expected, sum);
+}
@@ -27,6 +27,27 @@ void build_loadp2_test(Seq_T stream);
 void build_load_test(Seq_T stream);
 void build_loop_test(Seq_T stream);
 void build_loadp3_test(Seq_T stream);
+void build_cow_test(Seq_T stream);
+void build_selfmod_test(Seq_T stream);
+void build_selfmod_io_test(Seq_T stream);
+void build_store_run_test(Seq_T stream);
+void build_unmapped_fault(Seq_T stream);
+void build_bounds_fault(Seq_T stream);
+void build_divide_fault(Seq_T stream);
+void build_opcode_fault(Seq_T stream);
+void build_unmap0_fault(Seq_T stream);
+void build_arith_bench(Seq_T stream);
+void build_map_bench(Seq_T stream);
+void build_loadp_bench(Seq_T stream);
+void build_io_bench(Seq_T stream);
+void build_large_bench(Seq_T stream);
+void build_nest_stress(Seq_T stream, FILE *expected, const unsigned *params);
+void build_segments_stress(Seq_T stream, FILE *expected,
+                           const unsigned *params);
+void build_selfmod_stress(Seq_T stream, FILE *expected,
+                          const unsigned *params);
+void build_dispatch_stress(Seq_T stream, FILE *expected,
+                           const unsigned *params);
 
 
 /* The array `tests` contains all unit tests. */
@@ -55,12 +76,95 @@ static struct test_info {
         { "loadp-test", NULL, "D", build_loadp_test},
         { "loadp2-test", NULL, "D", build_loadp2_test},
         { "loadp3-test", NULL, "F", build_loadp3_test},
-        { "loop-test", NULL, "", build_loop_test}
+        { "loop-test", NULL, "", build_loop_test},
+        { "cow-test", NULL, "XX", build_cow_test},
+        { "selfmod-test", NULL, "XY", build_selfmod_test},
+        { "selfmod-io-test", NULL, "AAB", build_selfmod_io_test},
+        { "store-run-test", NULL, "S", build_store_run_test}
 };
 
   
 #define NTESTS (sizeof(tests)/sizeof(tests[0]))
 
+/*
+ * The array `faults` contains the fault programs, which ../run_tests.sh runs
+ * under um-safe. Their expected output is the fault report on stderr, which
+ * is written to a .fault file; they print nothing on stdout.
+ */
+static struct test_info faults[] = {
+        { "fault-unmapped", NULL,
+          "um: fault at pc 1 (sload, opcode 1): segment 5 is not mapped\n"
+          "um: r0=0x00000000 r1=0x00000005 r2=0x00000000 r3=0x00000000 "
+          "r4=0x00000000 r5=0x00000000 r6=0x00000000 r7=0x00000000\n",
+          build_unmapped_fault },
+        { "fault-bounds", NULL,
+          "um: fault at pc 3 (sload, opcode 1): offset 5 is out of "
+          "bounds of segment 1\n"
+          "um: r0=0x00000000 r1=0x00000001 r2=0x00000005 r3=0x00000001 "
+          "r4=0x00000000 r5=0x00000000 r6=0x00000000 r7=0x00000000\n",
+          build_bounds_fault },
+        { "fault-divide", NULL,
+          "um: fault at pc 1 (div, opcode 5): division by zero\n"
+          "um: r0=0x00000000 r1=0x00000003 r2=0x00000000 r3=0x00000000 "
+          "r4=0x00000000 r5=0x00000000 r6=0x00000000 r7=0x00000000\n",
+          build_divide_fault },
+        { "fault-opcode", NULL,
+          "um: fault at pc 1 (inv14, opcode 14): invalid opcode\n"
+          "um: r0=0x00000000 r1=0x00000003 r2=0x00000000 r3=0x00000000 "
+          "r4=0x00000000 r5=0x00000000 r6=0x00000000 r7=0x00000000\n",
+          build_opcode_fault },
+        { "fault-unmap0", NULL,
+          "um: fault at pc 0 (unmap, opcode 9): segment 0 cannot be unmapped\n"
+          "um: r0=0x00000000 r1=0x00000000 r2=0x00000000 r3=0x00000000 "
+          "r4=0x00000000 r5=0x00000000 r6=0x00000000 r7=0x00000000\n",
+          build_unmap0_fault }
+};
+
+#define NFAULTS (sizeof(faults)/sizeof(faults[0]))
+
+/* 
+ * The array `benchmarks` contains the microbenchmarks run by ../bench. They
+ * take too long to be unit tests, so they are only written when named on
+ * the command line. bench-io copies its input, which the harness supplies.
+ */
+static struct test_info benchmarks[] = {
+        { "bench-arith", NULL, "i", build_arith_bench },
+        { "bench-map",   NULL, "c", build_map_bench },
+        { "bench-loadp", NULL, "b", build_loadp_bench },
+        { "bench-io",    NULL, "", build_io_bench },
+        { "bench-large", NULL, "b", build_large_bench }
+};
+
+#define NBENCHMARKS (sizeof(benchmarks)/sizeof(benchmarks[0]))
+
+/* 
+ * The array `stress` contains the stress program generators. Their
+ * parameters can be given after the name on the command line, e.g.
+ * "writetests stress-nest 4 50"; the defaults are small enough for the stress
+ * programs to run as unit tests. The generator writes the expected output.
+ */
+#define MAX_PARAMS 4
+
+static struct stress_info {
+        const char *name;
+        unsigned num_params;
+        unsigned params[MAX_PARAMS];
+        /* writes instructions into sequence, expected output into file */
+        void (*build_stress)(Seq_T stream, FILE *expected,
+                             const unsigned *params);
+} stress[] = {
+        /* depth, iterations per loop */
+        { "stress-nest",     2, { 3, 20 }, build_nest_stress },
+        /* allocations, largest size, live segments, skew towards small */
+        { "stress-segments", 4, { 20000, 64, 16, 1 }, build_segments_stress },
+        /* iterations, instructions rewritten per iteration */
+        { "stress-selfmod",  2, { 2000, 8 }, build_selfmod_stress },
+        /* calls, handlers */
+        { "stress-dispatch", 2, { 20000, 16 }, build_dispatch_stress }
+};
+
+#define NSTRESS (sizeof(stress)/sizeof(stress[0]))
+
 /*
  * open file 'path' for writing, then free the pathname;
  * if anything fails, checked runtime error
@@ -74,17 +178,30 @@ static FILE *open_and_free_pathname(char *path);
 static void write_or_remove_file(char *path, const char *contents);
 
 static void write_test_files(struct test_info *test);
+static void write_fault_files(struct test_info *fault);
+static void write_stress_files(const struct stress_info *info,
+                               const unsigned *params);
+static int write_stress_args(const struct stress_info *info, int argc,
+                             char *argv[]);
 
 
 int main (int argc, char *argv[])
 {
         bool failed = false;
-        if (argc == 1)
+        if (argc == 1) {
                 for (unsigned i = 0; i < NTESTS; i++) {
                         printf("***** Writing test '%s'.\n", tests[i].name);
                         write_test_files(&tests[i]);
                 }
-        else
+                for (unsigned i = 0; i < NFAULTS; i++) {
+                        printf("***** Writing test '%s'.\n", faults[i].name);
+                        write_fault_files(&faults[i]);
+                }
+                for (unsigned i = 0; i < NSTRESS; i++) {
+                        printf("***** Writing test '%s'.\n", stress[i].name);
+                        write_stress_files(&stress[i], stress[i].params);
+                }
+        } else
                 for (int j = 1; j < argc; j++) {
                         bool tested = false;
                         for (unsigned i = 0; i < NTESTS; i++)
@@ -92,6 +209,23 @@ int main (int argc, char *argv[])
                                         tested = true;
                                         write_test_files(&tests[i]);
                                 }
+                        for (unsigned i = 0; i < NFAULTS; i++)
+                                if (!strcmp(faults[i].name, argv[j])) {
+                                        tested = true;
+                                        write_fault_files(&faults[i]);
+                                }
+                        for (unsigned i = 0; i < NBENCHMARKS; i++)
+                                if (!strcmp(benchmarks[i].name, argv[j])) {
+                                        tested = true;
+                                        write_test_files(&benchmarks[i]);
+                                }
+                        for (unsigned i = 0; i < NSTRESS && !tested; i++)
+                                if (!strcmp(stress[i].name, argv[j])) {
+                                        tested = true;
+                                        j += write_stress_args(&stress[i],
+                                                               argc - j - 1,
+                                                               &argv[j + 1]);
+                                }
                         if (!tested) {
                                 failed = true;
                                 fprintf(stderr,
@@ -103,6 +237,29 @@ int main (int argc, char *argv[])
 }
 
 
+/*
+ * write a stress program, taking its parameters from the numbers that
+ * follow its name on the command line (up to one per parameter) and the
+ * rest from the defaults; returns how many arguments were used
+ */
+static int write_stress_args(const struct stress_info *info, int argc,
+                             char *argv[])
+{
+        unsigned params[MAX_PARAMS];
+        int used = 0;
+
+        memcpy(params, info->params, sizeof(params));
+        while (used < argc && (unsigned)used < info->num_params &&
+               argv[used][0] != '\0' &&
+               strspn(argv[used], "0123456789") == strlen(argv[used])) {
+                params[used] = strtoul(argv[used], NULL, 10);
+                used++;
+        }
+        write_stress_files(info, params);
+        return used;
+}
+
+
 static void write_test_files(struct test_info *test)
 {
         FILE *binary = open_and_free_pathname(Fmt_string("%s.um", test->name));
@@ -119,6 +276,37 @@ static void write_test_files(struct test_info *test)
 }
 
 
+static void write_fault_files(struct test_info *fault)
+{
+        FILE *binary = open_and_free_pathname(Fmt_string("%s.um",
+                                                         fault->name));
+        Seq_T instructions = Seq_new(0);
+        fault->build_test(instructions);
+        Um_write_sequence(binary, instructions);
+        Seq_free(&instructions);
+        fclose(binary);
+
+        write_or_remove_file(Fmt_string("%s.fault", fault->name),
+                             fault->expected_output);
+}
+
+
+static void write_stress_files(const struct stress_info *info,
+                               const unsigned *params)
+{
+        FILE *binary = open_and_free_pathname(Fmt_string("%s.um",
+                                                         info->name));
+        FILE *expected = open_and_free_pathname(Fmt_string("%s.1",
+                                                           info->name));
+        Seq_T instructions = Seq_new(0);
+        info->build_stress(instructions, expected, params);
+        Um_write_sequence(binary, instructions);
+        Seq_free(&instructions);
+        fclose(binary);
+        fclose(expected);
+}
+
+
 static void write_or_remove_file(char *path, const char *contents)
 {
         if (contents == NULL || *contents == '\0') {
@@ -12,211 +12,380 @@
  * execution of each instruction. 
  */
 
-#include "calculate.h"
+#include "batch.h"
+#include "dispatch.h"
+#include "fault.h"
+#include "jit.h"
+#include "loader.h"
 #include "memory.h"
 #include "perform_io.h"
-#include "mem.h"
-#include "seq.h"
+#include "profile.h"
+#include "snapshot.h"
+#include "trace.h"
 #include "assert.h"
-#include "uarray.h"
 #include <stdlib.h>
 #include <stdint.h>
 #include <stdio.h>
-#include "bitpack.h"
+#include <string.h>
 #include <stdbool.h>
-#include <sys/stat.h>
+#include <signal.h>
+#include <sys/resource.h>
+#include <unistd.h>
 
-typedef enum Um_opcode {
-        CMOV = 0, SLOAD, SSTORE, ADD, MUL, DIV, NAND, HALT, ACTIVATE, 
-        INACTIVATE, OUT, IN, LOADP, LV
-} Um_opcode;
+/* the execution engines run_program can use */
+enum Engine { THREADED, LOOP, JIT };
+
+/*
+ * purpose: the command-line options
+ * members:        engine - the execution engine to run the program with
+ *          report_memory - true to print allocator statistics to stderr
+ *                          when the machine halts
+ *          report_fusion - true to print how many instructions ran as fused
+ *                          pairs to stderr when the machine halts
+ *          snapshot_path - where to write snapshots, or NULL for none
+ *            snapshot_at - the instruction count to take a snapshot at
+ *                          (UINT64_MAX for none)
+ *            resume_path - the snapshot to resume from, or NULL to run a
+ *                          program from the start
+ *             batch_path - the manifest of programs to run, or NULL to run
+ *                          a single program
+ *            num_threads - how many of the batch to run at once (0 for one
+ *                          per processor)
+ *            record_path - the trace to record input to, or NULL for none
+ *            replay_path - the trace to replay input from, or NULL to read
+ *                          standard input
+ *                   numa - true to place huge segments on the NUMA node
+ *                          the machine is running on
+ */
+struct Options {
+        enum Engine engine;
+        bool report_memory;
+        bool report_fusion;
+        const char *snapshot_path;
+        uint64_t snapshot_at;
+        const char *resume_path;
+        const char *batch_path;
+        unsigned num_threads;
+        const char *record_path;
+        const char *replay_path;
+        bool numa;
+};
 
 /* 
  *      name: free_all
  *   purpose: frees all of the data structures stored on the heap
- *    inputs:        registers - pointer to the array of registers
- *                    segments - pointer to the sequence of segments 
- *           unmapped_segments - pointer to the sequence of unmapped segments 
+ *    inputs: segments - the segmented memory, including every segment
+ *                       still mapped
  *   outputs: none
- *    errors: CRE if registers, segments, or unmapped_segments is NULL
+ *    errors: CRE if segments is NULL
  */
-void free_all(uint64_t *registers, Seq_T segments, Seq_T unmapped_segments)
+void free_all(Segments_T segments)
 {
-        assert(registers != NULL);
         assert(segments != NULL);
-        assert(unmapped_segments != NULL);
-        
-        /* free registers and unmapped segments */
-        FREE(registers);
-        Seq_free(&unmapped_segments);
         
-        int count = 1;
-        /* free each individual segment if not yet freed */
-        while (Seq_length(segments) != 0) {
-                UArray_T seg = Seq_remlo(segments);
-                if (seg != NULL) {
-                        UArray_free(&seg);
-                }
-                count++;
-        }
-        
-        /* free segments */
-        Seq_free(&segments);
+        Segments_free(&segments);
 }
 
-/* 
- *      name: setup_seg0
- *   purpose: reads from the file and stores all of the instructions in memory
- *    inputs:        fp - the file pointer to read from
- *            num_words - the number of instructions in the file
+/*
+ *      name: request_snapshot
+ *   purpose: SIGUSR1 handler; asks the engine to pause at its next load
+ *            program so a snapshot can be taken
+ *    inputs: signum - the signal number (unused)
  *   outputs: none
- *    errors: throws a CRE if the file pointer or segments are NULL
+ *    errors: none
  */
-UArray_T setup_seg0(FILE *fp, int num_words)
+static void request_snapshot(int signum)
 {
-        assert(fp != NULL);
-        
-        /* allocate space for segment 0 */
-        UArray_T seg0 = UArray_new(num_words, sizeof(uint64_t));
-
-        uint64_t word = 0;
-        uint64_t character;
-
-        /* loop through segment 0 */
-        for (int i = 0; i < num_words; i++) {
-                /* initialize each word from input file */
-                for (int j = 0; j < 4; j++) {
-                        character = getc(fp);
-                        word = Bitpack_newu(word, 8, 24 - (j * 8), character);
-                }
-                *(uint64_t *)UArray_at(seg0, i) = word;
+        (void)signum;
+        pause_requested = 1;
+}
+
+/*
+ *      name: engine_function
+ *   purpose: finds the function that runs a chosen execution engine
+ *    inputs: engine - the execution engine
+ *   outputs: the engine's function
+ *    errors: none
+ */
+static Um_engine engine_function(enum Engine engine)
+{
+        if (engine == JIT) {
+                return dispatch_jit;
+        } else if (engine == LOOP) {
+                return dispatch_loop;
+        } else {
+                return dispatch_threaded;
         }
+}
 
-        return seg0;
+/*
+ *      name: report_usage
+ *   purpose: prints the process's peak resident set size and page faults,
+ *            which show what huge pages save on programs with big segments
+ *    inputs: fp - the stream to print to
+ *   outputs: none
+ *    errors: none
+ */
+static void report_usage(FILE *fp)
+{
+        struct rusage usage;
+        if (getrusage(RUSAGE_SELF, &usage) != 0) {
+                return;
+        }
+        fprintf(fp, "rusage: %ld KB peak resident, %ld minor and %ld major "
+                "page faults\n", usage.ru_maxrss, usage.ru_minflt,
+                usage.ru_majflt);
 }
 
 /* 
  *      name: run_program
- *   purpose: executes the program
- *    inputs: seg0 - segment 0 in memory, which contains the program code to
- *                   be executed (type UArray_T)
- *   outputs: none
+ *   purpose: executes the program, taking snapshots and recording or
+ *            replaying a trace along the way if asked to, then frees the
+ *            machine
+ *    inputs:  segments - the segmented memory, with the program code to
+ *                        be executed in segment 0
+ *            registers - the eight registers
+ *                  run - where to start (pc and instruction count)
+ *               inputs - input instructions executed before the start
+ *              options - the command-line options
+ *   outputs: EXIT_SUCCESS if the machine halted, EXIT_FAILURE if the checked
+ *            build stopped it at a fault or a replay diverged from its
+ *            trace (either reported on stderr)
  *    errors: unchecked runtime error if program counter points to a word that
- *            doesn't code for a valid instruction, or if the program counter
- *            points out of bounds of $m[0]
- *            CRE if seg0 is NULL
+ *            doesn't code for a valid instruction
+ *            CRE if any argument is NULL or a snapshot or trace cannot be
+ *            written
  */
-void run_program(UArray_T seg0)
+int run_program(Segments_T segments, uint32_t *registers, struct Um_run *run,
+                uint64_t inputs, const struct Options *options)
 {
-        assert(seg0 != NULL);
-        
-        /* create and initialize registers */
-        uint64_t *registers = (uint64_t *)ALLOC(sizeof(uint64_t) * 8);
-        for (int i = 0; i < 8; i++) {
-                registers[i] = 0;
+        assert(segments != NULL);
+        assert(registers != NULL);
+        assert(run != NULL);
+        assert(options != NULL);
+
+        uint64_t snapshot_at = UINT64_MAX;
+        if (options->snapshot_path != NULL) {
+                snapshot_at = options->snapshot_at;
+                struct sigaction action;
+                memset(&action, 0, sizeof(action));
+                action.sa_handler = request_snapshot;
+                sigemptyset(&action.sa_mask);
+                action.sa_flags = SA_RESTART;
+                sigaction(SIGUSR1, &action, NULL);
         }
 
-        /* initialize segments and unmapped segments */
-        Seq_T segments = Seq_new(20); 
-        Seq_T unmapped_segments = Seq_new(20);
-        Seq_addhi(segments, seg0);
+        uint64_t first_step = run->steps;
+        uint64_t first_fused = run->fused_steps;
 
-        bool halted = false;
-        int next_seg = 1; /* keep track of next available segment */
-        int program_idx = 0; /* current index in segment 0 */
-        
-        while (!halted) {
-                /* get segment 0 */
-                UArray_T segment0 = (UArray_T)Seq_get(segments, 0);
-                assert(segment0 != NULL);
-
-                /* get current word in segment 0 and increment program index */
-                uint64_t word = *(uint64_t *)UArray_at(segment0, program_idx);
-                program_idx++;
-
-                /* unpack op code and registers from word */
-                unsigned op = Bitpack_getu(word, 4, 28);
-                unsigned ra = Bitpack_getu(word, 3, 6);
-                unsigned rb = Bitpack_getu(word, 3, 3);
-                unsigned rc = Bitpack_getu(word, 3, 0);
-
-                if (op == HALT) {
-                        halted = true;
-                } else if (op == CMOV) {
-                        conditional_move(ra, rb, rc, registers);
-                } else if (op == SLOAD) {
-                        segmented_load(ra, registers[rb], registers[rc], 
-                                       registers, segments);
-                } else if (op == SSTORE) {
-                        segmented_store(registers[ra], registers[rb], 
-                                        registers[rc], segments);
-                } else if (op == ADD) {
-                        add(ra, rb, rc, registers);
-                } else if (op == MUL) {
-                        multiply(ra, rb, rc, registers);
-                } else if (op == DIV) {
-                        divide(ra, rb, rc, registers);
-                } else if (op == NAND) {
-                        bitwise_NAND(ra, rb, rc, registers);
-                } else if (op == ACTIVATE) {
-                        map_segment(rb, registers[rc], registers, segments, 
-                                    unmapped_segments, &next_seg);
-                        /* Make sure memory resources haven't been exhausted */
-                        uint32_t limit = ~0;
-                        if ((uint32_t)next_seg >= limit) {
-                                halted = true;
+        Um_engine execute = engine_function(options->engine);
+        Pool_set_numa(segments->pool, options->numa);
+        Io_T io = Io_new(STDIN_FILENO, STDOUT_FILENO);
+        Trace_T trace = NULL;
+        if (options->record_path != NULL) {
+                trace = Trace_record(options->record_path, segments,
+                                     run->steps, inputs);
+                Io_record(io, trace);
+        } else if (options->replay_path != NULL) {
+                trace = Trace_replay(options->replay_path, segments,
+                                     run->steps, inputs);
+                Io_replay(io, trace);
+        }
+
+        PROFILE_START(segment_length(segments->table[0]));
+        for (;;) {
+                uint64_t checkpoint_at = trace == NULL ? UINT64_MAX
+                                       : Trace_next_checkpoint(trace);
+                run->pause_at = checkpoint_at < snapshot_at ? checkpoint_at
+                                                            : snapshot_at;
+                execute(registers, segments, io, run);
+                if (!run->paused) {
+                        break;
+                }
+
+                /* paused at a load program: checkpoint, snapshot, carry on */
+                if (run->steps >= checkpoint_at) {
+                        Trace_checkpoint(trace, run->steps, run->pc);
+                }
+                if (pause_requested || run->steps >= snapshot_at) {
+                        flush_output(io);
+                        write_snapshot(options->snapshot_path, registers,
+                                       segments, run,
+                                       inputs + Io_inputs(io));
+                        pause_requested = 0;
+                        if (run->steps >= snapshot_at) {
+                                snapshot_at = UINT64_MAX;
                         }
-                } else if (op == INACTIVATE) {
-                        unmap_segment(registers[rc], segments, 
-                                      unmapped_segments);
-                } else if (op == OUT) {
-                        output(registers[rc]);
-                } else if (op == IN) {
-                        input(rc, registers);
-                } else if (op == LOADP) {
-                        load_program(registers[rb], segments);
-                        program_idx = registers[rc];
-                } else if (op == LV) {
-                        ra = Bitpack_getu(word, 3, 25);
-                        unsigned val = Bitpack_getu(word, 25, 0);
-                        load_value(ra, val, registers);
-                } else {
-                        halted = true;
                 }
         }
-        free_all(registers, segments, unmapped_segments); /* free memory */
+        Io_free(&io); /* write any output still buffered */
+        PROFILE_REPORT(stderr, segments->table[0]);
+
+        bool replayed = true;
+        if (trace != NULL) {
+                replayed = Trace_close(&trace, run->steps, stderr);
+        }
+        if (options->report_memory) {
+                Pool_report(segments->pool, stderr);
+                report_usage(stderr);
+        }
+        if (options->report_fusion) {
+                uint64_t steps = run->steps - first_step;
+                uint64_t fused = run->fused_steps - first_fused;
+                fprintf(stderr, "fusion: %llu of %llu instructions ran as "
+                        "fused pairs (%.1f%%)\n", (unsigned long long)fused,
+                        (unsigned long long)steps,
+                        steps == 0 ? 0.0 : 100.0 * fused / steps);
+        }
+        free_all(segments); /* free memory */
+
+        if (run->fault.kind != FAULT_NONE) {
+                Um_fault_report(stderr, "um", &run->fault, registers);
+                return EXIT_FAILURE;
+        }
+        return replayed ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+/*
+ *      name: usage
+ *   purpose: prints how to run the program
+ *    inputs: program - the name the program was run as
+ *   outputs: EXIT_FAILURE
+ *    errors: none
+ */
+static int usage(const char *program)
+{
+        fprintf(stderr, "Usage: %s [-s | -j] [-m] [-f] [-n] "
+                "[-S snapshot [-N count]] [-T trace | -P trace]\n"
+                "          {program.um | -R snapshot}\n"
+                "       %s [-s] [-n] -b manifest [-t threads]\n", program,
+                program);
+        return EXIT_FAILURE;
 }
 
 /* 
  *      name: main
  *   purpose: reads in a provided file and starts the program
  *    inputs: argc - the number of command line arguments (integer)
- *            argv - array of the command line arguments
- *   outputs: EXIT_FAILURE if command line arguments is not 2, EXIT_SUCCESS
- *            otherwise
+ *            argv - array of the command line arguments: options
+ *                   followed by the .um file ("-" reads the program from
+ *                   standard input). -s runs the plain
+ *                   fetch/decode loop instead of the threaded engine, -j
+ *                   compiles the program to machine code as it runs, and
+ *                   -m prints segment allocator statistics, peak RSS
+ *                   and page faults at halt, -n places huge segments on
+ *                   the machine's NUMA node, and
+ *                   -f prints how much of the program ran as fused
+ *                   instruction pairs (threaded engine only).
+ *                   -S file writes a snapshot of the machine to file on
+ *                   SIGUSR1, and -N count also writes one once count
+ *                   instructions have run. -R file resumes from a snapshot
+ *                   instead of starting a .um file. -T file records
+ *                   the program's input and periodic checkpoints to a
+ *                   trace, and -P file replays one, taking the input from
+ *                   it and failing if the run diverges. -b manifest runs
+ *                   every program listed in the manifest (see batch.h)
+ *                   on threads instead, -t threads at a time, and
+ *                   reports each program's instructions and wall time.
+ *   outputs: EXIT_FAILURE if the command line is malformed, a program
+ *            of a batch could not be run, or a replay diverged
  *            EXIT_SUCCESS if program runs without errors
  *    errors: none
  */
 int main(int argc, char *argv[]) 
 {
-        /* make sure one file is provided to the program */
-        if(argc != 2) {
-                fprintf(stderr, "ERROR: incorrect format\n");
-                return EXIT_FAILURE;
-        }
+        struct Options options = { THREADED, false, false, NULL, UINT64_MAX,
+                                   NULL, NULL, 0, NULL, NULL, false };
+        int i;
 
-        /* determine length of input file and calculate number of words */
-        struct stat st;
-        assert(stat(argv[1], &st) == 0);
-        uint64_t size = st.st_size;
-        int num_words = size / 4;
+        for (i = 1; i < argc && argv[i][0] == '-' && argv[i][1] != '\0';
+             i++) {
+                bool has_value = i + 1 < argc;
 
-        FILE *fp = fopen(argv[1], "r"); /* open file */
-        assert(fp != NULL);
+                if (strcmp(argv[i], "-s") == 0) {
+                        options.engine = LOOP;
+                } else if (strcmp(argv[i], "-j") == 0) {
+                        options.engine = JIT;
+                } else if (strcmp(argv[i], "-m") == 0) {
+                        options.report_memory = true;
+                } else if (strcmp(argv[i], "-f") == 0) {
+                        options.report_fusion = true;
+                } else if (strcmp(argv[i], "-n") == 0) {
+                        options.numa = true;
+                } else if (strcmp(argv[i], "-S") == 0 && has_value) {
+                        options.snapshot_path = argv[++i];
+                } else if (strcmp(argv[i], "-R") == 0 && has_value) {
+                        options.resume_path = argv[++i];
+                } else if (strcmp(argv[i], "-N") == 0 && has_value) {
+                        char *end;
+                        options.snapshot_at = strtoull(argv[++i], &end, 10);
+                        if (*end != '\0' || argv[i][0] == '\0') {
+                                return usage(argv[0]);
+                        }
+                } else if (strcmp(argv[i], "-T") == 0 && has_value) {
+                        options.record_path = argv[++i];
+                } else if (strcmp(argv[i], "-P") == 0 && has_value) {
+                        options.replay_path = argv[++i];
+                } else if (strcmp(argv[i], "-b") == 0 && has_value) {
+                        options.batch_path = argv[++i];
+                } else if (strcmp(argv[i], "-t") == 0 && has_value) {
+                        char *end;
+                        options.num_threads = strtoul(argv[++i], &end, 10);
+                        if (*end != '\0' || options.num_threads == 0) {
+                                return usage(argv[0]);
+                        }
+                } else {
+                        fprintf(stderr, "%s: unknown option '%s'\n",
+                                argv[0], argv[i]);
+                        return EXIT_FAILURE;
+                }
+        }
 
-        UArray_T segment0 = setup_seg0(fp, num_words); /* set up segment 0 */
-        run_program(segment0); /* run command loop */
-        fclose(fp); /* close file */
+        if (options.batch_path != NULL) {
+                /* a batch reports instruction counts, which -j cannot */
+                if (argc != i || options.engine == JIT ||
+                    options.report_memory || options.report_fusion ||
+                    options.snapshot_path != NULL ||
+                    options.resume_path != NULL ||
+                    options.record_path != NULL ||
+                    options.replay_path != NULL) {
+                        return usage(argv[0]);
+                }
+                return run_batch(options.batch_path, options.num_threads,
+                                 engine_function(options.engine),
+                                 options.numa, stdout);
+        }
 
-        return EXIT_SUCCESS;
-}
\ No newline at end of file
+        /* one program, or a snapshot to resume; -N needs somewhere to go */
+        bool resuming = options.resume_path != NULL;
+        if (argc - i != (resuming ? 0 : 1) || options.num_threads != 0 ||
+            (options.snapshot_at != UINT64_MAX &&
+             options.snapshot_path == NULL) ||
+            (options.record_path != NULL && options.replay_path != NULL)) {
+                return usage(argv[0]);
+        }
+        if (options.engine == JIT && options.snapshot_path != NULL) {
+                fprintf(stderr, "%s: -j cannot take snapshots\n", argv[0]);
+                return EXIT_FAILURE;
+        }
+        if (options.engine == JIT && (options.record_path != NULL ||
+                                      options.replay_path != NULL)) {
+                /* traces need checkpoints, which need a pausable engine */
+                fprintf(stderr, "%s: -j cannot record or replay traces\n",
+                        argv[0]);
+                return EXIT_FAILURE;
+        }
+
+        uint32_t registers[8] = { 0 };
+        struct Um_run run = { 0, 0, UINT64_MAX, false, 0, { FAULT_NONE },
+                              NULL };
+        uint64_t inputs = 0;
+        Segments_T segments;
+        if (resuming) {
+                segments = read_snapshot(options.resume_path, registers,
+                                         &run, &inputs);
+        } else {
+                segments = read_program(argv[i]); /* set up segment 0 */
+        }
+        return run_program(segments, registers, &run, inputs, &options);
+}
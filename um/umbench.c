@@ -0,0 +1,526 @@
+/* umbench.c
+ * by Alyssa Williams (awilli36) and Olivia Byun (obyun01)
+ * 11/21/22
+ *
+ * This program is our benchmark harness. It runs every benchmark listed in
+ * a suite file on one UM binary, or on two to compare them, and prints one
+ * tab-separated line per benchmark and binary: the instructions executed,
+ * the median wall and CPU time over the runs, millions of instructions per
+ * CPU second, the peak resident set size, the median number of page faults
+ * (minor and major), and whether the output was right.
+ * When comparing, a second table follows with each benchmark's change in
+ * CPU time against the baseline and whether it is a regression ("failed",
+ * with a change of nan, if either binary went wrong). Both tables
+ * start with a header line beginning with '#'.
+ *
+ * A suite lists one benchmark per line: a name, the .um file, the file its
+ * input comes from and the file holding its expected output ("-" for no
+ * input, or for output that is not checked). Paths are relative to the
+ * suite's directory. Blank lines and lines starting with '#' are ignored.
+ *
+ * Instruction counts come from running each benchmark once with um -f,
+ * which prints them when the machine halts. The counts only depend on the
+ * program and its input, so both binaries are credited with them. Timed
+ * runs of the two binaries alternate so that a change in the machine's load
+ * affects both alike. Comparisons use CPU time (user plus system), which is
+ * steadier than wall time on a shared machine; a benchmark that takes more
+ * than the threshold longer on the new binary is flagged as a regression.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <math.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <time.h>
+#include <sys/resource.h>
+#include <sys/time.h>
+#include <sys/wait.h>
+
+#define MAX_RUNS 99      /* timed runs per benchmark and binary */
+#define MAX_UM_ARGS 16   /* options passed on to um */
+
+/*
+ * purpose: one benchmark of a suite
+ * members:     name - what to call it in the report
+ *           program - the .um file
+ *             input - the file to read input from, or NULL for none
+ *          expected - the file holding the expected output, or NULL
+ */
+struct Benchmark {
+        char *name;
+        char *program;
+        char *input;
+        char *expected;
+};
+
+/*
+ * purpose: how one binary did on one benchmark
+ * members:  wall - wall time of each run, in seconds
+ *            cpu - user plus system time of each run, in seconds
+ *        max_rss - the largest peak resident set size of any run, in KB
+ *         faults - page faults (minor plus major) of each run
+ *         status - "ok", or how the first failing run went wrong
+ */
+struct Result {
+        double wall[MAX_RUNS];
+        double cpu[MAX_RUNS];
+        long max_rss;
+        double faults[MAX_RUNS];
+        char status[32];
+};
+
+/*
+ * purpose: what to run and how
+ * members:    um - the binaries: the new one, then the baseline if any
+ *          num_um - how many binaries there are
+ *         um_args - options passed to um before the program
+ *        num_args - how many options there are
+ *            runs - timed runs per benchmark and binary
+ *       threshold - the slowdown, in percent, that counts as a regression
+ *      output_path - where runs write their output
+ */
+struct Bench {
+        const char *um[2];
+        int num_um;
+        const char *um_args[MAX_UM_ARGS];
+        int num_args;
+        int runs;
+        double threshold;
+        char output_path[64];
+};
+
+/*
+ *      name: relative_to
+ *   purpose: makes a path from the suite relative to the suite's directory
+ *    inputs: suite - the suite's path
+ *             path - the path as written in the suite, or "-"
+ *   outputs: a path to be freed with free, or NULL if path is "-"
+ *    errors: exits if memory runs out
+ */
+static char *relative_to(const char *suite, const char *path)
+{
+        if (strcmp(path, "-") == 0) {
+                return NULL;
+        }
+        const char *slash = strrchr(suite, '/');
+        int dir_length = path[0] == '/' || slash == NULL ? 0
+                       : (int)(slash - suite) + 1;
+        char *result = malloc(dir_length + strlen(path) + 1);
+        if (result == NULL) {
+                perror("umbench");
+                exit(EXIT_FAILURE);
+        }
+        sprintf(result, "%.*s%s", dir_length, suite, path);
+        return result;
+}
+
+/*
+ *      name: read_suite
+ *   purpose: reads the benchmarks listed in a suite
+ *    inputs: path - the suite file
+ *             num - where to store how many benchmarks there are
+ *   outputs: the benchmarks, to be freed by the caller
+ *    errors: exits if the suite cannot be read or a line is malformed
+ */
+static struct Benchmark *read_suite(const char *path, int *num)
+{
+        FILE *fp = fopen(path, "r");
+        if (fp == NULL) {
+                perror(path);
+                exit(EXIT_FAILURE);
+        }
+
+        struct Benchmark *benchmarks = NULL;
+        int count = 0;
+        char *line = NULL;
+        size_t capacity = 0;
+        for (int line_num = 1; getline(&line, &capacity, fp) != -1;
+             line_num++) {
+                char *fields[4];
+                char *save = NULL;
+                int n = 0;
+                for (char *field = strtok_r(line, " \t\n", &save);
+                     field != NULL && n < 5;
+                     field = strtok_r(NULL, " \t\n", &save)) {
+                        if (n == 0 && field[0] == '#') {
+                                break;
+                        }
+                        if (n < 4) {
+                                fields[n] = field;
+                        }
+                        n++;
+                }
+                if (n == 0) {
+                        continue;
+                }
+                if (n != 4) {
+                        fprintf(stderr, "%s:%d: expected name, program, "
+                                "input and output\n", path, line_num);
+                        exit(EXIT_FAILURE);
+                }
+
+                benchmarks = realloc(benchmarks,
+                                     (count + 1) * sizeof(*benchmarks));
+                if (benchmarks == NULL) {
+                        perror("umbench");
+                        exit(EXIT_FAILURE);
+                }
+                benchmarks[count].name = strdup(fields[0]);
+                benchmarks[count].program = relative_to(path, fields[1]);
+                benchmarks[count].input = relative_to(path, fields[2]);
+                benchmarks[count].expected = relative_to(path, fields[3]);
+                count++;
+        }
+        free(line);
+        fclose(fp);
+
+        *num = count;
+        return benchmarks;
+}
+
+/*
+ *      name: run_um
+ *   purpose: runs a UM binary on a benchmark and waits for it
+ *    inputs:       bench - the harness's options
+ *                     um - the binary
+ *              benchmark - the benchmark
+ *                 option - the only option to pass, or NULL to pass the
+ *                          -a options
+ *            errors_path - where to send the binary's stderr, or NULL for
+ *                          /dev/null
+ *                   wall - where to store the wall time, in seconds
+ *                  usage - where to store the resources it used
+ *   outputs: its status, as returned by wait4
+ *    errors: exits if the process cannot be started
+ */
+static int run_um(const struct Bench *bench, const char *um,
+                  const struct Benchmark *benchmark, const char *option,
+                  const char *errors_path, double *wall, struct rusage *usage)
+{
+        const char *argv[MAX_UM_ARGS + 4];
+        int argc = 0;
+        argv[argc++] = um;
+        if (option != NULL) {
+                argv[argc++] = option;
+        } else {
+                for (int i = 0; i < bench->num_args; i++) {
+                        argv[argc++] = bench->um_args[i];
+                }
+        }
+        argv[argc++] = benchmark->program;
+        argv[argc] = NULL;
+
+        struct timespec start, end;
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        pid_t pid = fork();
+        if (pid < 0) {
+                perror("umbench: fork");
+                exit(EXIT_FAILURE);
+        }
+        if (pid == 0) {
+                const char *in = benchmark->input != NULL ? benchmark->input
+                                                          : "/dev/null";
+                const char *err = errors_path != NULL ? errors_path
+                                                      : "/dev/null";
+                int in_fd = open(in, O_RDONLY);
+                int out_fd = open(bench->output_path,
+                                  O_WRONLY | O_CREAT | O_TRUNC, 0600);
+                int err_fd = open(err, O_WRONLY | O_CREAT | O_TRUNC, 0600);
+                if (in_fd < 0 || out_fd < 0 || err_fd < 0) {
+                        perror(in_fd < 0 ? in : "umbench");
+                        _exit(127);
+                }
+                dup2(in_fd, STDIN_FILENO);
+                dup2(out_fd, STDOUT_FILENO);
+                dup2(err_fd, STDERR_FILENO);
+                execv(um, (char *const *)argv);
+                _exit(127);
+        }
+
+        int status;
+        if (wait4(pid, &status, 0, usage) < 0) {
+                perror("umbench: wait4");
+                exit(EXIT_FAILURE);
+        }
+        clock_gettime(CLOCK_MONOTONIC, &end);
+        *wall = (end.tv_sec - start.tv_sec) +
+                (end.tv_nsec - start.tv_nsec) / 1e9;
+        return status;
+}
+
+/*
+ *      name: same_contents
+ *   purpose: tells whether two files hold the same bytes
+ *    inputs: path1, path2 - the files
+ *   outputs: true if both can be read and are equal, false otherwise
+ *    errors: none
+ */
+static bool same_contents(const char *path1, const char *path2)
+{
+        FILE *fp1 = fopen(path1, "rb");
+        FILE *fp2 = fopen(path2, "rb");
+        bool same = fp1 != NULL && fp2 != NULL;
+        while (same) {
+                char buf1[65536], buf2[65536];
+                size_t n1 = fread(buf1, 1, sizeof(buf1), fp1);
+                size_t n2 = fread(buf2, 1, sizeof(buf2), fp2);
+                same = n1 == n2 && memcmp(buf1, buf2, n1) == 0;
+                if (n1 < sizeof(buf1)) {
+                        break;
+                }
+        }
+        if (fp1 != NULL) {
+                fclose(fp1);
+        }
+        if (fp2 != NULL) {
+                fclose(fp2);
+        }
+        return same;
+}
+
+/*
+ *      name: count_instructions
+ *   purpose: finds how many instructions a benchmark executes by running it
+ *            once with um -f
+ *    inputs:     bench - the harness's options
+ *            benchmark - the benchmark
+ *   outputs: the instruction count, or 0 if um did not report one
+ *    errors: exits if the process cannot be started
+ */
+static unsigned long long count_instructions(const struct Bench *bench,
+                                             const struct Benchmark *benchmark)
+{
+        char errors_path[80];
+        snprintf(errors_path, sizeof(errors_path), "%s.err",
+                 bench->output_path);
+
+        double wall;
+        struct rusage usage;
+        run_um(bench, bench->um[0], benchmark, "-f", errors_path, &wall,
+               &usage);
+
+        unsigned long long fused, steps = 0;
+        FILE *fp = fopen(errors_path, "r");
+        if (fp != NULL) {
+                char line[256];
+                while (fgets(line, sizeof(line), fp) != NULL) {
+                        if (sscanf(line, "fusion: %llu of %llu", &fused,
+                                   &steps) == 2) {
+                                break;
+                        }
+                }
+                fclose(fp);
+        }
+        remove(errors_path);
+        return steps;
+}
+
+/*
+ *      name: time_run
+ *   purpose: times one run of a binary on a benchmark and checks its output
+ *    inputs:     bench - the harness's options
+ *                   um - the binary
+ *            benchmark - the benchmark
+ *               result - where to record the run
+ *                  run - which run this is
+ *   outputs: none
+ *    errors: exits if the process cannot be started
+ */
+static void time_run(const struct Bench *bench, const char *um,
+                     const struct Benchmark *benchmark, struct Result *result,
+                     int run)
+{
+        struct rusage usage;
+        int status = run_um(bench, um, benchmark, NULL, NULL,
+                            &result->wall[run], &usage);
+        result->cpu[run] = usage.ru_utime.tv_sec + usage.ru_stime.tv_sec +
+                           (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec)
+                           / 1e6;
+        if (usage.ru_maxrss > result->max_rss) {
+                result->max_rss = usage.ru_maxrss;
+        }
+        result->faults[run] = usage.ru_minflt + usage.ru_majflt;
+
+        if (strcmp(result->status, "ok") != 0) {
+                return; /* keep the first failure */
+        }
+        if (WIFSIGNALED(status)) {
+                snprintf(result->status, sizeof(result->status),
+                         "signal-%d", WTERMSIG(status));
+        } else if (WEXITSTATUS(status) != 0) {
+                snprintf(result->status, sizeof(result->status), "exit-%d",
+                         WEXITSTATUS(status));
+        } else if (benchmark->expected != NULL &&
+                   !same_contents(benchmark->expected, bench->output_path)) {
+                snprintf(result->status, sizeof(result->status),
+                         "wrong-output");
+        }
+}
+
+/*
+ *      name: median
+ *   purpose: finds the median of some times
+ *    inputs: times - the times; reordered
+ *                n - how many there are (at least 1)
+ *   outputs: the median
+ *    errors: none
+ */
+static double median(double *times, int n)
+{
+        /* insertion sort: there are only a few */
+        for (int i = 1; i < n; i++) {
+                double t = times[i];
+                int j = i;
+                for (; j > 0 && times[j - 1] > t; j--) {
+                        times[j] = times[j - 1];
+                }
+                times[j] = t;
+        }
+        return n % 2 == 1 ? times[n / 2]
+                          : (times[n / 2 - 1] + times[n / 2]) / 2;
+}
+
+/*
+ *      name: usage
+ *   purpose: prints how to run the program
+ *    inputs: program - the name the program was run as
+ *   outputs: EXIT_FAILURE
+ *    errors: none
+ */
+static int usage(const char *program)
+{
+        fprintf(stderr, "Usage: %s [-n runs] [-p percent] [-a um-option]... "
+                "suite um [baseline-um]\n", program);
+        return EXIT_FAILURE;
+}
+
+/*
+ *      name: main
+ *   purpose: runs a suite on one binary, or on two to compare them
+ *    inputs: argc - the number of command line arguments
+ *            argv - options, then the suite, the binary and optionally the
+ *                   baseline binary. -n runs sets the number of timed runs
+ *                   (default 3), -p percent the slowdown flagged as a
+ *                   regression (default 10), and each -a option is passed
+ *                   to um (e.g. -a -s to time the loop engine).
+ *   outputs: EXIT_SUCCESS if every benchmark ran correctly and none
+ *            regressed, EXIT_FAILURE otherwise
+ *    errors: exits if the suite cannot be read or a process cannot be
+ *            started
+ */
+int main(int argc, char *argv[])
+{
+        struct Bench bench = { { NULL, NULL }, 0, { NULL }, 0, 3, 10.0, "" };
+        int i;
+
+        for (i = 1; i < argc && argv[i][0] == '-'; i++) {
+                if (i + 1 == argc) {
+                        return usage(argv[0]);
+                }
+                char *end;
+                if (strcmp(argv[i], "-n") == 0) {
+                        bench.runs = strtol(argv[++i], &end, 10);
+                        if (*end != '\0' || bench.runs < 1 ||
+                            bench.runs > MAX_RUNS) {
+                                return usage(argv[0]);
+                        }
+                } else if (strcmp(argv[i], "-p") == 0) {
+                        bench.threshold = strtod(argv[++i], &end);
+                        if (*end != '\0' || bench.threshold < 0) {
+                                return usage(argv[0]);
+                        }
+                } else if (strcmp(argv[i], "-a") == 0 &&
+                           bench.num_args < MAX_UM_ARGS) {
+                        bench.um_args[bench.num_args++] = argv[++i];
+                } else {
+                        return usage(argv[0]);
+                }
+        }
+        if (argc - i != 2 && argc - i != 3) {
+                return usage(argv[0]);
+        }
+        const char *suite = argv[i];
+        bench.num_um = argc - i - 1;
+        bench.um[0] = argv[i + 1];
+        bench.um[1] = bench.num_um == 2 ? argv[i + 2] : NULL;
+
+        snprintf(bench.output_path, sizeof(bench.output_path),
+                 "/tmp/umbench.%d", (int)getpid());
+
+        int num_benchmarks;
+        struct Benchmark *benchmarks = read_suite(suite, &num_benchmarks);
+
+        bool failed = false;
+        double *changes = calloc(num_benchmarks + 1, sizeof(*changes));
+        if (changes == NULL) {
+                perror("umbench");
+                exit(EXIT_FAILURE);
+        }
+        printf("# benchmark\tbinary\tinstructions\twall_s\tcpu_s\tmips"
+               "\tmax_rss_kb\tpage_faults\tstatus\n");
+        for (int b = 0; b < num_benchmarks; b++) {
+                const struct Benchmark *benchmark = &benchmarks[b];
+                unsigned long long steps = count_instructions(&bench,
+                                                              benchmark);
+                struct Result results[2];
+                double cpu[2];
+                for (int u = 0; u < bench.num_um; u++) {
+                        memset(&results[u], 0, sizeof(results[u]));
+                        strcpy(results[u].status, "ok");
+                }
+                for (int run = 0; run < bench.runs; run++) {
+                        for (int u = 0; u < bench.num_um; u++) {
+                                time_run(&bench, bench.um[u], benchmark,
+                                         &results[u], run);
+                        }
+                }
+
+                for (int u = 0; u < bench.num_um; u++) {
+                        double wall = median(results[u].wall, bench.runs);
+                        cpu[u] = median(results[u].cpu, bench.runs);
+                        double faults = median(results[u].faults,
+                                               bench.runs);
+                        printf("%s\t%s\t%llu\t%.3f\t%.3f\t%.1f\t%ld\t%.0f"
+                               "\t%s\n", benchmark->name, bench.um[u], steps,
+                               wall, cpu[u],
+                               cpu[u] > 0 ? steps / cpu[u] / 1e6 : 0,
+                               results[u].max_rss, faults, results[u].status);
+                        failed |= strcmp(results[u].status, "ok") != 0;
+                }
+                if (bench.num_um == 2 && cpu[1] > 0) {
+                        changes[b] = 100.0 * (cpu[0] - cpu[1]) / cpu[1];
+                }
+                if (strcmp(results[0].status, "ok") != 0 ||
+                    (bench.num_um == 2 &&
+                     strcmp(results[1].status, "ok") != 0)) {
+                        changes[b] = NAN; /* nothing to compare */
+                }
+                fflush(stdout);
+        }
+
+        if (bench.num_um == 2) {
+                printf("# benchmark\tcpu_change_pct\tverdict\n");
+                for (int b = 0; b < num_benchmarks; b++) {
+                        bool regressed = changes[b] > bench.threshold;
+                        printf("%s\t%+.1f\t%s\n", benchmarks[b].name,
+                               changes[b], isnan(changes[b]) ? "failed"
+                               : regressed ? "REGRESSION" : "ok");
+                        failed |= regressed;
+                }
+        }
+
+        remove(bench.output_path);
+        for (int b = 0; b < num_benchmarks; b++) {
+                free(benchmarks[b].name);
+                free(benchmarks[b].program);
+                free(benchmarks[b].input);
+                free(benchmarks[b].expected);
+        }
+        free(benchmarks);
+        free(changes);
+        return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
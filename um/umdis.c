@@ -0,0 +1,860 @@
+/* umdis.c
+ * by Alyssa Williams (awilli36) and Olivia Byun (obyun01)
+ * 11/21/22
+ *
+ * This program is our disassembler and static analyser for UM program
+ * images. It maps a .um or .umz file, decodes every word as an instruction,
+ * splits the program into basic blocks, and follows the control flow from
+ * word 0 to build a control-flow graph. It prints a summary: the opcode mix
+ * of the whole image and of the code reachable from word 0, how the load
+ * programs transfer control, the sizes of the reachable blocks, and the
+ * opcode pairs that occur most often inside them, which are the candidates
+ * for fusion. "-d" also prints a listing of every word, and "-g" prints the
+ * graph in Graphviz dot format instead of the summary.
+ *
+ * Load program is the only instruction that jumps, and its target is a
+ * register, so the targets are found by tracking the values the registers
+ * can hold. Each register is either one of a few known constants or
+ * anything. Registers start at zero at word 0, load value sets a constant,
+ * the arithmetic instructions combine constants, and a conditional move
+ * whose condition is not known leaves its destination holding either
+ * value, which is how the usual "load value, load value, conditional move,
+ * load program" sequence turns into a two-way branch. The values flow
+ * along the edges of the graph until they stop changing. A load program
+ * whose target is not known is indirect; if reachable code has one, every
+ * block not yet reached is analysed as well, starting from registers that
+ * could hold anything, so its jumps still appear in the graph. A jump into
+ * the middle of a block splits it, and the analysis starts again with the
+ * new block boundaries.
+ *
+ * Words that are never reached may be data, so the reachable counts are
+ * the ones to trust for optimisation decisions.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <fcntl.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#define MAX_CONSTS 4   /* constants a register can be tracked as */
+#define ANY 0xff       /* Value.n of a register that could hold anything */
+#define TOP_PAIRS 10   /* opcode pairs listed in the summary */
+#define NUM_SIZES 8    /* block size buckets: 1, 2, 3-4, ..., 65 and up */
+
+enum { CMOV = 0, SLOAD, SSTORE, ADD, MUL, DIV, NAND, HALT, MAP, UNMAP, OUT,
+       IN, LOADP, LV };
+
+/* mnemonics indexed by opcode */
+static const char *const op_names[16] = {
+        "cmov", "sload", "sstore", "add", "mul", "div", "nand", "halt",
+        "map", "unmap", "out", "in", "loadp", "lv", "inv14", "inv15"
+};
+
+/*
+ * purpose: how control leaves a basic block
+ */
+enum Exit {
+        EXIT_FALL,     /* into the next block, which starts a jump target */
+        EXIT_JUMP,     /* load program within segment 0 to known offsets */
+        EXIT_INDIRECT, /* load program within segment 0, offset not known */
+        EXIT_LOAD,     /* load program that may replace segment 0 */
+        EXIT_HALT,     /* halt */
+        EXIT_INVALID,  /* an invalid opcode */
+        EXIT_END       /* runs off the end of the program */
+};
+
+/*
+ * purpose: what a register is known to hold
+ * members: n - how many constants it could be, or ANY
+ *          v - the constants
+ */
+struct Value {
+        uint8_t n;
+        uint32_t v[MAX_CONSTS];
+};
+
+/*
+ * purpose: a basic block
+ * members:       start - the offset of its first word
+ *                  end - the offset just past its last word
+ *                 exit - how control leaves it
+ *          num_targets - for EXIT_JUMP, how many offsets it can jump to
+ *              targets - those offsets; offsets past the end of the
+ *                        program are not kept
+ *              reached - true once a state has flowed into it
+ *            reachable - true if it can be reached from word 0 by known
+ *                        jumps
+ *                preds - the number of edges into it
+ *          code_stores - segmented stores that write segment 0
+ *         maybe_stores - segmented stores that may write segment 0
+ *                   in - what the registers hold when it starts
+ */
+struct Block {
+        uint32_t start;
+        uint32_t end;
+        enum Exit exit;
+        unsigned num_targets;
+        uint32_t targets[MAX_CONSTS];
+        bool reached;
+        bool reachable;
+        unsigned preds;
+        unsigned code_stores;
+        unsigned maybe_stores;
+        struct Value in[8];
+};
+
+/*
+ * purpose: the program and what is known about it
+ * members:     words - the program, in host order
+ *                  n - its length in words
+ *             leader - for each offset, true if a block starts there
+ *           block_at - for each offset that starts a block, its index
+ *             blocks - the blocks in order of offset, and num_blocks
+ *               work - the worklist of blocks whose state changed
+ *           num_work - how many there are
+ *            queued - for each block, true if it is on the worklist
+ *        new_leader - set when a jump lands inside a block
+ */
+struct Program {
+        uint32_t *words;
+        uint32_t n;
+        bool *leader;
+        uint32_t *block_at;
+        struct Block *blocks;
+        uint32_t num_blocks;
+        uint32_t *work;
+        uint32_t num_work;
+        bool *queued;
+        bool new_leader;
+};
+
+/*
+ *      name: checked_alloc
+ *   purpose: calloc that exits on failure
+ *    inputs: count, size - as for calloc
+ *   outputs: the zeroed memory
+ *    errors: exits if the memory cannot be allocated
+ */
+static void *checked_alloc(size_t count, size_t size)
+{
+        void *p = calloc(count + 1, size);
+        if (p == NULL) {
+                perror("umdis");
+                exit(EXIT_FAILURE);
+        }
+        return p;
+}
+
+/*
+ *      name: read_program
+ *   purpose: maps a program image and converts its big-endian words
+ *    inputs: path - the image
+ *               n - set to the number of words
+ *   outputs: the words, in host order
+ *    errors: exits if the file cannot be read
+ */
+static uint32_t *read_program(const char *path, uint32_t *n)
+{
+        int fd = open(path, O_RDONLY);
+        struct stat st;
+        if (fd < 0 || fstat(fd, &st) != 0) {
+                perror(path);
+                exit(EXIT_FAILURE);
+        }
+
+        *n = st.st_size / 4;
+        uint32_t *words = checked_alloc(*n, sizeof(uint32_t));
+        if (*n > 0) {
+                const uint32_t *image = mmap(NULL, st.st_size, PROT_READ,
+                                             MAP_PRIVATE, fd, 0);
+                if (image == MAP_FAILED) {
+                        perror(path);
+                        exit(EXIT_FAILURE);
+                }
+                for (uint32_t i = 0; i < *n; i++) {
+                        words[i] = __builtin_bswap32(image[i]);
+                }
+                munmap((void *)image, st.st_size);
+        }
+        close(fd);
+        return words;
+}
+
+/*
+ *      name: add_const
+ *   purpose: adds a constant to the ones a register could hold, giving up
+ *            on it if there are too many
+ *    inputs: value - the register
+ *                c - the constant
+ *   outputs: none
+ *    errors: none
+ */
+static void add_const(struct Value *value, uint32_t c)
+{
+        if (value->n == ANY) {
+                return;
+        }
+        for (unsigned i = 0; i < value->n; i++) {
+                if (value->v[i] == c) {
+                        return;
+                }
+        }
+        if (value->n == MAX_CONSTS) {
+                value->n = ANY;
+        } else {
+                value->v[value->n++] = c;
+        }
+}
+
+/*
+ *      name: join
+ *   purpose: widens a register to also cover the values of another
+ *    inputs: into - the register to widen
+ *            from - the values to cover
+ *   outputs: true if into changed
+ *    errors: none
+ */
+static bool join(struct Value *into, const struct Value *from)
+{
+        if (into->n == ANY) {
+                return false;
+        }
+        if (from->n == ANY) {
+                into->n = ANY;
+                return true;
+        }
+        uint8_t before = into->n;
+        for (unsigned i = 0; i < from->n; i++) {
+                add_const(into, from->v[i]);
+        }
+        return into->n != before;
+}
+
+/*
+ *      name: combine
+ *   purpose: works out what an arithmetic instruction can produce from the
+ *            values of its operands
+ *    inputs: op - ADD, MUL, DIV or NAND
+ *            b, c - the operands
+ *   outputs: the values of the result
+ *    errors: none
+ */
+static struct Value combine(unsigned op, const struct Value *b,
+                            const struct Value *c)
+{
+        struct Value result = { ANY, { 0 } };
+        if (b->n == ANY || c->n == ANY) {
+                return result;
+        }
+
+        result.n = 0;
+        for (unsigned i = 0; i < b->n; i++) {
+                for (unsigned j = 0; j < c->n; j++) {
+                        uint32_t x = b->v[i], y = c->v[j];
+                        if (op == DIV && y == 0) {
+                                continue; /* the machine fails */
+                        }
+                        add_const(&result, op == ADD ? x + y
+                                           : op == MUL ? x * y
+                                           : op == DIV ? x / y
+                                           : ~(x & y));
+                }
+        }
+        if (result.n == 0) {
+                result.n = ANY;
+        }
+        return result;
+}
+
+/*
+ *      name: find_leaders
+ *   purpose: marks the offsets that start a block without any analysis:
+ *            word 0 and each word after one that ends a block
+ *    inputs: prog - the program
+ *   outputs: none
+ *    errors: none
+ */
+static void find_leaders(struct Program *prog)
+{
+        prog->leader[0] = true;
+        for (uint32_t i = 0; i < prog->n; i++) {
+                unsigned op = prog->words[i] >> 28;
+                if (op == HALT || op == LOADP || op > LV) {
+                        prog->leader[i + 1] = true;
+                }
+        }
+}
+
+/*
+ *      name: make_blocks
+ *   purpose: splits the program into blocks at its leaders
+ *    inputs: prog - the program
+ *   outputs: none
+ *    errors: none
+ */
+static void make_blocks(struct Program *prog)
+{
+        free(prog->blocks);
+        free(prog->queued);
+
+        uint32_t count = 0;
+        for (uint32_t i = 0; i < prog->n; i++) {
+                count += prog->leader[i];
+        }
+        prog->blocks = checked_alloc(count, sizeof(struct Block));
+        prog->queued = checked_alloc(count, sizeof(bool));
+        prog->num_blocks = 0;
+        for (uint32_t i = 0; i < prog->n; i++) {
+                if (prog->leader[i]) {
+                        if (prog->num_blocks > 0) {
+                                prog->blocks[prog->num_blocks - 1].end = i;
+                        }
+                        prog->block_at[i] = prog->num_blocks;
+                        prog->blocks[prog->num_blocks++].start = i;
+                }
+        }
+        if (prog->num_blocks > 0) {
+                prog->blocks[prog->num_blocks - 1].end = prog->n;
+        }
+        prog->num_work = 0;
+}
+
+/*
+ *      name: flow
+ *   purpose: passes a block's registers along an edge, queueing the block
+ *            at the other end if what it knows changes
+ *    inputs: prog - the program
+ *            to - the offset the edge leads to
+ *            out - the registers at the end of the block
+ *   outputs: none
+ *    errors: none
+ */
+static void flow(struct Program *prog, uint32_t to, const struct Value *out)
+{
+        if (!prog->leader[to]) {
+                prog->leader[to] = true;
+                prog->new_leader = true;
+                return;
+        }
+
+        uint32_t b = prog->block_at[to];
+        struct Block *block = &prog->blocks[b];
+        bool changed = !block->reached;
+        if (!block->reached) {
+                memcpy(block->in, out, sizeof(block->in));
+                block->reached = true;
+        } else {
+                for (int r = 0; r < 8; r++) {
+                        changed |= join(&block->in[r], &out[r]);
+                }
+        }
+        if (changed && !prog->queued[b]) {
+                prog->queued[b] = true;
+                prog->work[prog->num_work++] = b;
+        }
+}
+
+/*
+ *      name: analyse_block
+ *   purpose: runs a block on what its registers are known to hold, finds
+ *            how it exits, and passes the registers on to its successors
+ *    inputs: prog - the program
+ *               b - the block's index
+ *   outputs: none
+ *    errors: none
+ */
+static void analyse_block(struct Program *prog, uint32_t b)
+{
+        struct Block *block = &prog->blocks[b];
+        struct Value reg[8];
+        memcpy(reg, block->in, sizeof(reg));
+
+        block->exit = block->end == prog->n ? EXIT_END : EXIT_FALL;
+        block->num_targets = 0;
+        block->code_stores = block->maybe_stores = 0;
+        for (uint32_t i = block->start; i < block->end; i++) {
+                uint32_t word = prog->words[i];
+                unsigned op = word >> 28;
+                unsigned a = (word >> 6) & 7, rb = (word >> 3) & 7,
+                         rc = word & 7;
+
+                switch (op) {
+                case CMOV:
+                        if (reg[rc].n == ANY) {
+                                join(&reg[a], &reg[rb]);
+                                break;
+                        }
+                        bool zero = false, nonzero = false;
+                        for (unsigned k = 0; k < reg[rc].n; k++) {
+                                zero |= reg[rc].v[k] == 0;
+                                nonzero |= reg[rc].v[k] != 0;
+                        }
+                        if (zero && nonzero) {
+                                join(&reg[a], &reg[rb]);
+                        } else if (nonzero) {
+                                reg[a] = reg[rb];
+                        }
+                        break;
+                case SLOAD:
+                        reg[a].n = ANY;
+                        break;
+                case ADD: case MUL: case DIV: case NAND:
+                        reg[a] = combine(op, &reg[rb], &reg[rc]);
+                        break;
+                case MAP:
+                        reg[rb].n = ANY;
+                        break;
+                case IN:
+                        reg[rc].n = ANY;
+                        break;
+                case LV:
+                        reg[(word >> 25) & 7].n = 1;
+                        reg[(word >> 25) & 7].v[0] = word & 0x1ffffff;
+                        break;
+                case HALT:
+                        block->exit = EXIT_HALT;
+                        break;
+                case LOADP:
+                        if (reg[rb].n != 1 || reg[rb].v[0] != 0) {
+                                block->exit = EXIT_LOAD;
+                        } else if (reg[rc].n == ANY) {
+                                block->exit = EXIT_INDIRECT;
+                        } else {
+                                block->exit = EXIT_JUMP;
+                                for (unsigned k = 0; k < reg[rc].n; k++) {
+                                        if (reg[rc].v[k] < prog->n) {
+                                                block->targets[
+                                                        block->num_targets++]
+                                                        = reg[rc].v[k];
+                                        }
+                                }
+                        }
+                        break;
+                case SSTORE:
+                        if (reg[a].n == 1 && reg[a].v[0] == 0) {
+                                block->code_stores++;
+                                break;
+                        }
+                        bool maybe = reg[a].n == ANY;
+                        for (unsigned k = 0; !maybe && k < reg[a].n; k++) {
+                                maybe = reg[a].v[k] == 0;
+                        }
+                        block->maybe_stores += maybe;
+                        break;
+                case UNMAP: case OUT:
+                        break;
+                default:
+                        block->exit = EXIT_INVALID;
+                        break;
+                }
+        }
+
+        if (block->exit == EXIT_FALL) {
+                flow(prog, block->end, reg);
+        } else if (block->exit == EXIT_JUMP) {
+                for (unsigned k = 0; k < block->num_targets; k++) {
+                        flow(prog, block->targets[k], reg);
+                }
+        }
+}
+
+/*
+ *      name: run_worklist
+ *   purpose: analyses queued blocks until nothing changes or a jump lands
+ *            inside a block
+ *    inputs: prog - the program
+ *   outputs: none
+ *    errors: none
+ */
+static void run_worklist(struct Program *prog)
+{
+        while (prog->num_work > 0 && !prog->new_leader) {
+                uint32_t b = prog->work[--prog->num_work];
+                prog->queued[b] = false;
+                analyse_block(prog, b);
+        }
+}
+
+/*
+ *      name: analyse
+ *   purpose: finds the blocks and the graph: first from word 0, then, if
+ *            reachable code jumps somewhere not known, from every block
+ *            not yet reached. Starts again whenever a jump splits a block.
+ *    inputs: prog - the program
+ *   outputs: none
+ *    errors: none
+ */
+static void analyse(struct Program *prog)
+{
+        if (prog->n == 0) {
+                return;
+        }
+        find_leaders(prog);
+        do {
+                prog->new_leader = false;
+                make_blocks(prog);
+
+                struct Value zeros[8];
+                memset(zeros, 0, sizeof(zeros));
+                for (int r = 0; r < 8; r++) {
+                        zeros[r].n = 1;
+                }
+                flow(prog, 0, zeros);
+                run_worklist(prog);
+                if (prog->new_leader) {
+                        continue;
+                }
+
+                bool indirect = false;
+                for (uint32_t b = 0; b < prog->num_blocks; b++) {
+                        struct Block *block = &prog->blocks[b];
+                        block->reachable = block->reached;
+                        indirect |= block->reached &&
+                                    block->exit == EXIT_INDIRECT;
+                }
+                if (!indirect) {
+                        continue;
+                }
+
+                struct Value any[8];
+                for (int r = 0; r < 8; r++) {
+                        any[r].n = ANY;
+                }
+                for (uint32_t b = 0; b < prog->num_blocks; b++) {
+                        if (!prog->blocks[b].reached) {
+                                flow(prog, prog->blocks[b].start, any);
+                        }
+                }
+                run_worklist(prog);
+        } while (prog->new_leader);
+
+        for (uint32_t b = 0; b < prog->num_blocks; b++) {
+                struct Block *block = &prog->blocks[b];
+                if (!block->reached) {
+                        continue;
+                }
+                if (block->exit == EXIT_FALL) {
+                        prog->blocks[b + 1].preds++;
+                }
+                for (unsigned k = 0; k < block->num_targets; k++) {
+                        prog->blocks[prog->block_at[block->targets[k]]]
+                                .preds++;
+                }
+        }
+}
+
+/*
+ *      name: print_instruction
+ *   purpose: prints one word as an instruction
+ *    inputs: fp - the stream to print to
+ *            word - the word
+ *   outputs: none
+ *    errors: none
+ */
+static void print_instruction(FILE *fp, uint32_t word)
+{
+        unsigned op = word >> 28;
+        unsigned a = (word >> 6) & 7, b = (word >> 3) & 7, c = word & 7;
+
+        fprintf(fp, "%-6s ", op_names[op]);
+        switch (op) {
+        case HALT:
+                break;
+        case MAP: case LOADP:
+                fprintf(fp, "r%u, r%u", b, c);
+                break;
+        case UNMAP: case OUT: case IN:
+                fprintf(fp, "r%u", c);
+                break;
+        case LV:
+                fprintf(fp, "r%u, %u", (word >> 25) & 7, word & 0x1ffffff);
+                break;
+        default:
+                if (op <= NAND) {
+                        fprintf(fp, "r%u, r%u, r%u", a, b, c);
+                }
+                break;
+        }
+}
+
+/*
+ *      name: print_listing
+ *   purpose: prints every word of the program, with a line before each
+ *            block saying where it can be entered from and how it exits
+ *    inputs: prog - the analysed program
+ *   outputs: none
+ *    errors: none
+ */
+static void print_listing(const struct Program *prog)
+{
+        static const char *const exits[] = {
+                "falls through", "jumps", "jumps indirectly",
+                "loads a program", "halts", "hits an invalid opcode",
+                "runs off the end"
+        };
+
+        for (uint32_t b = 0; b < prog->num_blocks; b++) {
+                const struct Block *block = &prog->blocks[b];
+                printf("\n; block %u-%u, ", block->start, block->end - 1);
+                if (!block->reached) {
+                        printf("not reached\n");
+                } else {
+                        printf("%s%u predecessor%s, %s\n",
+                               block->reachable ? "" : "not reachable from "
+                               "word 0, ", block->preds,
+                               block->preds == 1 ? "" : "s",
+                               exits[block->exit]);
+                }
+
+                for (uint32_t i = block->start; i < block->end; i++) {
+                        printf("%10u  %08x  ", i, prog->words[i]);
+                        print_instruction(stdout, prog->words[i]);
+                        if (i + 1 == block->end &&
+                            block->exit == EXIT_JUMP) {
+                                printf("  ; ->");
+                                for (unsigned k = 0; k < block->num_targets;
+                                     k++) {
+                                        printf(" %u", block->targets[k]);
+                                }
+                        }
+                        printf("\n");
+                }
+        }
+}
+
+/*
+ *      name: print_graph
+ *   purpose: prints the graph of the reached blocks in Graphviz dot format
+ *    inputs: prog - the analysed program
+ *            name - what to call the graph
+ *   outputs: none
+ *    errors: none
+ */
+static void print_graph(const struct Program *prog, const char *name)
+{
+        printf("digraph \"%s\" {\n        node [shape=box];\n", name);
+        printf("        indirect [shape=ellipse]; load [shape=ellipse];\n");
+        for (uint32_t b = 0; b < prog->num_blocks; b++) {
+                const struct Block *block = &prog->blocks[b];
+                if (!block->reached) {
+                        continue;
+                }
+                printf("        b%u [label=\"%u-%u\"%s];\n", block->start,
+                       block->start, block->end - 1,
+                       block->reachable ? "" : " style=dashed");
+                if (block->exit == EXIT_FALL) {
+                        printf("        b%u -> b%u;\n", block->start,
+                               block->end);
+                } else if (block->exit == EXIT_INDIRECT) {
+                        printf("        b%u -> indirect;\n", block->start);
+                } else if (block->exit == EXIT_LOAD) {
+                        printf("        b%u -> load;\n", block->start);
+                }
+                for (unsigned k = 0; k < block->num_targets; k++) {
+                        printf("        b%u -> b%u;\n", block->start,
+                               block->targets[k]);
+                }
+        }
+        printf("}\n");
+}
+
+/*
+ *      name: print_summary
+ *   purpose: prints the opcode mix, how control is transferred, the block
+ *            sizes and the commonest opcode pairs
+ *    inputs: prog - the analysed program
+ *            seconds - how long reading and analysing took
+ *   outputs: none
+ *    errors: none
+ */
+static void print_summary(const struct Program *prog, double seconds)
+{
+        uint64_t all[16] = { 0 }, reachable[16] = { 0 };
+        uint64_t pairs[16][16] = { { 0 } };
+        uint64_t sizes[NUM_SIZES] = { 0 };
+        uint64_t exits[EXIT_END + 1] = { 0 };
+        uint64_t num_reachable = 0, reachable_words = 0, max_size = 0;
+        uint64_t two_way = 0, code_stores = 0, maybe_stores = 0;
+
+        for (uint32_t i = 0; i < prog->n; i++) {
+                all[prog->words[i] >> 28]++;
+        }
+        for (uint32_t b = 0; b < prog->num_blocks; b++) {
+                const struct Block *block = &prog->blocks[b];
+                if (!block->reachable) {
+                        continue;
+                }
+                uint32_t size = block->end - block->start;
+                num_reachable++;
+                reachable_words += size;
+                max_size = size > max_size ? size : max_size;
+                unsigned bucket = 0;
+                while (bucket + 1 < NUM_SIZES &&
+                       size > (1u << bucket)) {
+                        bucket++;
+                }
+                sizes[bucket]++;
+                exits[block->exit]++;
+                two_way += block->num_targets > 1;
+                code_stores += block->code_stores;
+                maybe_stores += block->maybe_stores;
+
+                for (uint32_t i = block->start; i < block->end; i++) {
+                        unsigned op = prog->words[i] >> 28;
+                        reachable[op]++;
+                        if (i + 1 < block->end) {
+                                pairs[op][prog->words[i + 1] >> 28]++;
+                        }
+                }
+        }
+
+        printf("umdis: %u words, %u blocks, %llu reachable from word 0 "
+               "(%llu words)\n", prog->n, prog->num_blocks,
+               (unsigned long long)num_reachable,
+               (unsigned long long)reachable_words);
+        printf("umdis: reachable blocks end in %llu jumps (%llu two-way or "
+               "more), %llu indirect jumps, %llu loads of another program, "
+               "%llu halts, %llu fall-throughs, %llu invalid opcodes\n",
+               (unsigned long long)exits[EXIT_JUMP],
+               (unsigned long long)two_way,
+               (unsigned long long)exits[EXIT_INDIRECT],
+               (unsigned long long)exits[EXIT_LOAD],
+               (unsigned long long)exits[EXIT_HALT],
+               (unsigned long long)exits[EXIT_FALL],
+               (unsigned long long)exits[EXIT_INVALID]);
+        printf("umdis: %llu reachable segmented stores write segment 0, "
+               "%llu more may\n", (unsigned long long)code_stores,
+               (unsigned long long)maybe_stores);
+
+        printf("umdis: opcode mix           all words         reachable\n");
+        for (int op = 0; op < 16; op++) {
+                if (all[op] == 0) {
+                        continue;
+                }
+                printf("  %-6s %12llu %5.1f%% %12llu %5.1f%%\n",
+                       op_names[op], (unsigned long long)all[op],
+                       100.0 * all[op] / prog->n,
+                       (unsigned long long)reachable[op],
+                       reachable_words > 0 ? 100.0 * reachable[op] /
+                                             reachable_words : 0.0);
+        }
+
+        printf("umdis: reachable block sizes (mean %.1f, max %llu words)\n",
+               num_reachable > 0 ? (double)reachable_words / num_reachable
+                                 : 0.0, (unsigned long long)max_size);
+        for (unsigned bucket = 0; bucket < NUM_SIZES; bucket++) {
+                unsigned low = bucket < 2 ? bucket + 1
+                                          : (1u << (bucket - 1)) + 1;
+                char range[32];
+                if (bucket + 1 == NUM_SIZES) {
+                        snprintf(range, sizeof(range), "%u+", low);
+                } else if (low == 1u << bucket) {
+                        snprintf(range, sizeof(range), "%u", low);
+                } else {
+                        snprintf(range, sizeof(range), "%u-%u", low,
+                                 1u << bucket);
+                }
+                printf("  %-8s %12llu\n", range,
+                       (unsigned long long)sizes[bucket]);
+        }
+
+        printf("umdis: commonest opcode pairs within reachable blocks\n");
+        for (int k = 0; k < TOP_PAIRS; k++) {
+                int best = -1;
+                for (int p = 0; p < 256; p++) {
+                        if (pairs[p / 16][p % 16] > 0 &&
+                            (best < 0 || pairs[p / 16][p % 16] >
+                                         pairs[best / 16][best % 16])) {
+                                best = p;
+                        }
+                }
+                if (best < 0) {
+                        break;
+                }
+                printf("  %-6s %-6s %12llu\n", op_names[best / 16],
+                       op_names[best % 16],
+                       (unsigned long long)pairs[best / 16][best % 16]);
+                pairs[best / 16][best % 16] = 0;
+        }
+        printf("umdis: read and analysed in %.3f s\n", seconds);
+}
+
+/*
+ *      name: usage
+ *   purpose: prints how to run the program
+ *    inputs: program - the name it was run as
+ *   outputs: EXIT_FAILURE
+ *    errors: none
+ */
+static int usage(const char *program)
+{
+        fprintf(stderr, "usage: %s [-d | -g] program.um\n"
+                "  -d  print a listing of every word after the summary\n"
+                "  -g  print the control-flow graph in dot format only\n",
+                program);
+        return EXIT_FAILURE;
+}
+
+/*
+ *      name: main
+ *   purpose: reads and analyses a program and prints what was asked for
+ *    inputs: argc, argv - "umdis [-d | -g] program.um"
+ *   outputs: EXIT_SUCCESS, or EXIT_FAILURE on a usage error
+ *    errors: exits if the program cannot be read
+ */
+int main(int argc, char *argv[])
+{
+        bool listing = false, graph = false;
+        int i;
+
+        for (i = 1; i < argc && argv[i][0] == '-'; i++) {
+                if (strcmp(argv[i], "-d") == 0) {
+                        listing = true;
+                } else if (strcmp(argv[i], "-g") == 0) {
+                        graph = true;
+                } else {
+                        return usage(argv[0]);
+                }
+        }
+        if (argc - i != 1 || (listing && graph)) {
+                return usage(argv[0]);
+        }
+
+        struct timespec start, end;
+        clock_gettime(CLOCK_MONOTONIC, &start);
+
+        struct Program prog;
+        memset(&prog, 0, sizeof(prog));
+        prog.words = read_program(argv[i], &prog.n);
+        prog.leader = checked_alloc(prog.n + 1, sizeof(bool));
+        prog.block_at = checked_alloc(prog.n + 1, sizeof(uint32_t));
+        prog.work = checked_alloc(prog.n + 1, sizeof(uint32_t));
+        analyse(&prog);
+
+        clock_gettime(CLOCK_MONOTONIC, &end);
+        double seconds = (end.tv_sec - start.tv_sec) +
+                         (end.tv_nsec - start.tv_nsec) / 1e9;
+
+        if (graph) {
+                print_graph(&prog, argv[i]);
+        } else {
+                print_summary(&prog, seconds);
+                if (listing) {
+                        print_listing(&prog);
+                }
+        }
+
+        free(prog.words);
+        free(prog.leader);
+        free(prog.block_at);
+        free(prog.blocks);
+        free(prog.queued);
+        free(prog.work);
+        return EXIT_SUCCESS;
+}